@@ -0,0 +1,403 @@
+#ifndef COMPACTFIBHEAP_H_
+#define COMPACTFIBHEAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "HeapValue.h"
+#include "Instrumentation.h"
+
+/* CompactFibHeap
+ ******************************************************************************
+ *
+ * a Fibonacci heap with the same operations and amortized bounds as FibHeap,
+ * stored compactly: every node lives in one contiguous vector and links to
+ * its neighbours by 32-bit index instead of by pointer, and its mark and
+ * degree are packed into a single word. the key and the four links, which
+ * ExtractMin and Consolidate touch on every visit, sit together at the front
+ * of the node; the payload follows them. for a double key without a payload
+ * a node is 32 bytes, against 56 for a FibonacciNode plus its pool slot.
+ *
+ * the heap holds at most 2^32 - 1 nodes. indices never change, so handles
+ * stay valid while the vector grows, but references returned by key() and
+ * value() are invalidated by the next insertion.
+ *
+ * a removed node's slot goes on a free list and is reused by a later
+ * insertion, which assigns the new key and payload over the old ones. the
+ * old key is moved out on extraction, so its resources are released then;
+ * T and Value must be move-assignable.
+ *
+ * Operations:
+ *
+ * -    insert(key), insert(key, value), emplace(key, args...):
+ *          O(1). emplace constructs the payload from args
+ *
+ * -    top(), min(), key(h), value(h):
+ *          O(1)
+ *
+ * -    extractMin(), extractMin(value), erase(h):
+ *          O(log n) amortized
+ *
+ * -    decrease_key(h, key):
+ *          O(1) amortized. throws KeyIncrease
+ *
+ * -    reserve(n), memory():
+ *          reserves room for n nodes / reports the bytes held by the node
+ *          array
+ *
+ */
+
+template <class T, class Value = void, class Compare = std::less<T> >
+class CompactFibHeap {
+
+public:
+    typedef T key_type;
+    typedef typename HeapValue<Value>::type value_type;
+    typedef Compare key_compare;
+    typedef std::uint32_t index_type;
+
+    // EXCEPTIONS
+    // thrown by decrease_key when the new key comes after the old one
+    class KeyIncrease {};
+    // thrown by an insertion when every index is in use
+    class Full {};
+
+    // names a node of the heap. it stays valid until the node is extracted
+    // or erased
+    class handle {
+    private:
+        index_type index;
+        friend class CompactFibHeap;
+        explicit handle(index_type i) : index(i) {}
+    public:
+        handle() : index(NIL) {}
+        bool operator==(const handle &h) const { return index == h.index; }
+        bool operator!=(const handle &h) const { return index != h.index; }
+    };
+
+private:
+    static const index_type NIL = 0xffffffffu;
+    // the largest degree of a heap of 2^32 nodes is below log_phi(2^32) < 47
+    static const int MAX_DEGREE = 64;
+
+    struct Node {
+        T key;
+        index_type left;
+        index_type right;
+        index_type parent;
+        index_type child;
+        // degree << 1 | mark
+        std::uint32_t state;
+        value_type value;
+
+        template <class K, class... Args>
+        Node(K&& k, Args&&... args) :
+            key(std::forward<K>(k)), left(NIL), right(NIL), parent(NIL),
+            child(NIL), state(0), value(std::forward<Args>(args)...) {}
+    };
+
+    // VARIABLES
+    Compare compare;
+    std::vector<Node> nodes;
+    index_type min_root;
+    index_type free_list;
+    size_t n;
+    // degree table of Consolidate, all NIL between calls
+    index_type A[MAX_DEGREE];
+
+    // FUNCTIONS
+    unsigned int degree(index_type x) const { return nodes[x].state >> 1; }
+    bool marked(index_type x) const { return nodes[x].state & 1; }
+
+    // takes a slot for a new node, from the free list if possible
+    template <class K, class... Args>
+    index_type allocate(K&& k, Args&&... args) {
+        index_type x;
+        if ( free_list != NIL ) {
+            x = free_list;
+            free_list = nodes[x].right;
+            nodes[x].key = std::forward<K>(k);
+            ReplaceValue(nodes[x].value, std::forward<Args>(args)...);
+            nodes[x].state = 0;
+            nodes[x].parent = nodes[x].child = NIL;
+        }
+        else {
+            if ( nodes.size() >= NIL ) {
+                throw Full();
+            }
+            x = static_cast<index_type>(nodes.size());
+            nodes.emplace_back(std::forward<K>(k), std::forward<Args>(args)...);
+        }
+        nodes[x].left = nodes[x].right = x;
+        return x;
+    }
+
+    // releases the payload's resources now rather than when reused
+    void deallocate(index_type x) {
+        ReleaseValue(nodes[x].value);
+        nodes[x].right = free_list;
+        free_list = x;
+    }
+
+    // takes x out of its circular list, leaving it in a list of its own
+    void unlink(index_type x) {
+        Node &node = nodes[x];
+        nodes[node.left].right = node.right;
+        nodes[node.right].left = node.left;
+        node.left = node.right = x;
+    }
+
+    // places the single node x to the right of y
+    void splice(index_type x, index_type y) {
+        nodes[x].left = y;
+        nodes[x].right = nodes[y].right;
+        nodes[nodes[y].right].left = x;
+        nodes[y].right = x;
+    }
+
+    void Insert(index_type x) {
+        if ( min_root == NIL ) {
+            min_root = x;
+        }
+        else {
+            splice(x, min_root);
+            if ( compare(nodes[x].key, nodes[min_root].key) ) {
+                min_root = x;
+            }
+        }
+        n++;
+        INSTRUMENT_COUNT(HEAP_INSERTS, 1);
+    }
+
+    // removes the minimum from the heap and returns its index. the slot is
+    // not yet freed
+    index_type ExtractMin() {
+        index_type z = min_root;
+        index_type c = nodes[z].child;
+        if ( c != NIL ) {
+            // every child becomes a root, then the child list joins the
+            // root list in one splice
+            index_type x = c;
+            do {
+                nodes[x].parent = NIL;
+                x = nodes[x].right;
+            } while ( x != c );
+            index_type zr = nodes[z].right;
+            index_type cl = nodes[c].left;
+            nodes[z].right = c;
+            nodes[c].left = z;
+            nodes[cl].right = zr;
+            nodes[zr].left = cl;
+            nodes[z].child = NIL;
+        }
+        if ( nodes[z].right == z ) {
+            min_root = NIL;
+        }
+        else {
+            min_root = nodes[z].right;
+            unlink(z);
+            Consolidate();
+        }
+        n--;
+        INSTRUMENT_COUNT(HEAP_EXTRACTS, 1);
+        return z;
+    }
+
+    void Consolidate() {
+        INSTRUMENT_COUNT(CONSOLIDATE_PASSES, 1);
+        size_t roots = 0;
+        index_type w = min_root;
+        do {
+            roots++;
+            w = nodes[w].right;
+        } while ( w != min_root );
+
+        unsigned int top = 0;
+        for ( size_t k = 0; k < roots; k++ ) {
+            index_type x = w;
+            w = nodes[w].right;
+            unsigned int d = degree(x);
+            while ( A[d] != NIL ) {
+                index_type y = A[d];
+                if ( compare(nodes[y].key, nodes[x].key) ) {
+                    std::swap(x, y);
+                }
+                Link(y, x);
+                A[d] = NIL;
+                d++;
+            }
+            A[d] = x;
+            if ( d > top ) {
+                top = d;
+            }
+        }
+
+        min_root = NIL;
+        for ( unsigned int i = 0; i <= top; i++ ) {
+            if ( A[i] != NIL ) {
+                if ( min_root == NIL ||
+                     compare(nodes[A[i]].key, nodes[min_root].key) ) {
+                    min_root = A[i];
+                }
+                A[i] = NIL;
+            }
+        }
+    }
+
+    // makes the root y a child of the root x
+    void Link(index_type y, index_type x) {
+        INSTRUMENT_COUNT(LINKS, 1);
+        unlink(y);
+        if ( nodes[x].child == NIL ) {
+            nodes[x].child = y;
+        }
+        else {
+            splice(y, nodes[x].child);
+        }
+        nodes[y].parent = x;
+        nodes[y].state &= ~1u;
+        nodes[x].state += 2;
+    }
+
+    void DecreaseKey(index_type x, const T &k) {
+        if ( compare(nodes[x].key, k) ) {
+            throw KeyIncrease();
+        }
+        nodes[x].key = k;
+        index_type y = nodes[x].parent;
+        if ( y != NIL && compare(nodes[x].key, nodes[y].key) ) {
+            Cut(x, y);
+            CascadingCut(y);
+        }
+        if ( compare(nodes[x].key, nodes[min_root].key) ) {
+            min_root = x;
+        }
+    }
+
+    // moves x from the child list of y to the root list
+    void Cut(index_type x, index_type y) {
+        INSTRUMENT_COUNT(CUTS, 1);
+        if ( nodes[y].child == x ) {
+            if ( nodes[x].right == x ) {
+                nodes[y].child = NIL;
+            }
+            else {
+                nodes[y].child = nodes[x].right;
+            }
+        }
+        unlink(x);
+        nodes[y].state -= 2;
+        splice(x, min_root);
+        nodes[x].parent = NIL;
+        nodes[x].state &= ~1u;
+    }
+
+    void CascadingCut(index_type y) {
+        index_type z = nodes[y].parent;
+        while ( z != NIL ) {
+            if ( !marked(y) ) {
+                nodes[y].state |= 1;
+                return;
+            }
+            Cut(y, z);
+            y = z;
+            z = nodes[y].parent;
+        }
+    }
+
+public:
+    // CONSTRUCTORS
+    explicit CompactFibHeap(const Compare &cmp = Compare()) :
+        compare(cmp), min_root(NIL), free_list(NIL), n(0) {
+        for ( int i = 0; i < MAX_DEGREE; i++ ) {
+            A[i] = NIL;
+        }
+    }
+
+    // FUNCTIONS
+    size_t size() const { return n; }
+
+    bool empty() const { return n == 0; }
+
+    // reserves room for count nodes, so that no insertion up to that size
+    // moves the array
+    void reserve(size_t count) { nodes.reserve(count); }
+
+    // bytes held by the node array, including free and reserved slots
+    size_t memory() const { return nodes.capacity() * sizeof(Node); }
+
+    // places a new node in the heap and returns its handle
+    handle insert(const T &key) {
+        return emplace(key);
+    }
+
+    handle insert(const T &key, const value_type &value) {
+        return emplace(key, value);
+    }
+
+    // constructs the key from k and the payload from args in a new node
+    template <class K, class... Args>
+    handle emplace(K&& k, Args&&... args) {
+        index_type x = allocate(std::forward<K>(k), std::forward<Args>(args)...);
+        Insert(x);
+        return handle(x);
+    }
+
+    // the node holding the minimum, or a null handle when the heap is empty
+    handle top() const { return handle(min_root); }
+
+    // the key and payload of a node in the heap
+    const T& key(handle h) const { return nodes[h.index].key; }
+    value_type& value(handle h) { return nodes[h.index].value; }
+
+    // moves a node's key towards the minimum in O(1) amortized time.
+    // throws KeyIncrease exception
+    void decrease_key(handle h, const T &key) {
+        DecreaseKey(h.index, key);
+    }
+
+    // removes a node from the heap in O(log n) amortized time
+    void erase(handle h) {
+        index_type x = h.index;
+        index_type y = nodes[x].parent;
+        if ( y != NIL ) {
+            Cut(x, y);
+            CascadingCut(y);
+        }
+        min_root = x;
+        x = ExtractMin();
+        // releases the key's resources now rather than when the slot is reused
+        T discarded(std::move(nodes[x].key));
+        (void)discarded;
+        deallocate(x);
+    }
+
+    // the minimum value still in the heap
+    T min() const {
+        return n ?
+               nodes[min_root].key :
+               std::numeric_limits<T>::lowest();
+    }
+
+    // extracts the minimum value and frees the node that contained it
+    T extractMin() {
+        index_type x = ExtractMin();
+        T key = std::move(nodes[x].key);
+        deallocate(x);
+        return key;
+    }
+
+    // extracts the minimum value and moves its payload into value
+    T extractMin(value_type &value) {
+        index_type x = ExtractMin();
+        T key = std::move(nodes[x].key);
+        value = std::move(nodes[x].value);
+        deallocate(x);
+        return key;
+    }
+};
+
+#endif
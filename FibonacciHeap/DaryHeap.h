@@ -0,0 +1,407 @@
+#ifndef DARYHEAP_H_
+#define DARYHEAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "HeapValue.h"
+#include "Instrumentation.h"
+
+/* DaryHeap
+ ******************************************************************************
+ *
+ * an implicit d-ary heap with the interface of FibHeap, for heaps small
+ * enough that the pointer chasing of a Fibonacci heap costs more than its
+ * amortized bounds save. node i has children D*i+1 to D*i+D in one
+ * contiguous array of keys, so a sift-down step compares D adjacent keys -
+ * a single cache line for D = 8 and 8-byte keys.
+ *
+ * handles name slots, not array positions: a slot holds the node's payload
+ * and its current position in the array, and each position records the slot
+ * that owns it, so decrease_key and erase find a node in O(1). freed slots
+ * are reused by later insertions. unlike FibHeap, merging moves the nodes of
+ * the other heap into new slots, so its handles become invalid, and
+ * references returned by key() and value() are invalidated by any
+ * insertion.
+ *
+ * Operations:
+ *
+ * -    insert, emplace, decrease_key:
+ *          O(log_D n)
+ *
+ * -    extractMin, erase:
+ *          O(D log_D n)
+ *
+ * -    insert_range, range constructor:
+ *          O(# keys) when the range is at least as large as the heap, which
+ *          is then rebuilt bottom-up; O(# keys log_D n) otherwise
+ *
+ * -    merge:
+ *          as insert_range over the other heap's nodes
+ *
+ */
+
+template <class T, unsigned int D = 4, class Value = void,
+          class Compare = std::less<T>, class Allocator = std::allocator<T> >
+class DaryHeap {
+    static_assert(D >= 2, "a d-ary heap needs at least two children per node");
+
+public:
+    typedef T key_type;
+    typedef typename HeapValue<Value>::type value_type;
+    typedef Compare key_compare;
+    typedef std::uint32_t index_type;
+
+    // EXCEPTIONS
+    // thrown by decrease_key when the new key comes after the old one
+    class KeyIncrease {};
+    // thrown by an insertion when every slot is in use
+    class Full {};
+
+    // HANDLES
+    // names the slot of a node for as long as the node stays in the heap
+    class handle {
+        friend class DaryHeap;
+        index_type slot;
+        explicit handle(index_type s) : slot(s) {}
+    public:
+        handle() : slot(NIL) {}
+        bool operator==(const handle &h) const { return slot == h.slot; }
+        bool operator!=(const handle &h) const { return slot != h.slot; }
+    };
+
+private:
+    static const index_type NIL = 0xffffffffu;
+
+    template <class U>
+    struct Vector {
+        typedef std::vector<U, typename std::allocator_traits<Allocator>::
+            template rebind_alloc<U> > type;
+    };
+
+    // VARIABLES
+    Compare compare;
+    // the heap in array order, and the slot owning each position
+    typename Vector<T>::type keys;
+    typename Vector<index_type>::type owner;
+    // the position of each slot in use; a free slot holds the next free one
+    typename Vector<index_type>::type position;
+    typename Vector<value_type>::type values;
+    index_type free_slot;
+
+    // FUNCTIONS
+    template <class... Args>
+    index_type allocate(Args&&... args) {
+        index_type slot;
+        if ( free_slot != NIL ) {
+            slot = free_slot;
+            ReplaceValue(values[slot], std::forward<Args>(args)...);
+            free_slot = position[slot];
+        }
+        else {
+            if ( position.size() >= NIL ) {
+                throw Full();
+            }
+            slot = static_cast<index_type>(position.size());
+            values.emplace_back(std::forward<Args>(args)...);
+            position.push_back(NIL);
+        }
+        return slot;
+    }
+
+    // releases the payload's resources now rather than when reused
+    void deallocate(index_type slot) {
+        ReleaseValue(values[slot]);
+        position[slot] = free_slot;
+        free_slot = slot;
+    }
+
+    // the first of count children starting at first in key order. a full
+    // family has a constant trip count, which the compiler unrolls into a
+    // branch-free selection
+    size_t SmallestChild(size_t first, size_t count) const {
+        size_t best = first;
+        if ( count == D ) {
+            for ( size_t c = first + 1; c < first + D; c++ ) {
+                best = compare(keys[c], keys[best]) ? c : best;
+            }
+        }
+        else {
+            for ( size_t c = first + 1; c < first + count; c++ ) {
+                best = compare(keys[c], keys[best]) ? c : best;
+            }
+        }
+        return best;
+    }
+
+    // moves the node at i up until its parent comes first, shifting the
+    // nodes it passes down one level
+    void SiftUp(size_t i) {
+        T key = std::move(keys[i]);
+        index_type slot = owner[i];
+        while ( i > 0 ) {
+            size_t parent = (i - 1) / D;
+            if ( !compare(key, keys[parent]) ) {
+                break;
+            }
+            keys[i] = std::move(keys[parent]);
+            owner[i] = owner[parent];
+            position[owner[i]] = static_cast<index_type>(i);
+            i = parent;
+        }
+        keys[i] = std::move(key);
+        owner[i] = slot;
+        position[slot] = static_cast<index_type>(i);
+    }
+
+    // moves the node at i down until no child comes before it
+    void SiftDown(size_t i) {
+        size_t n = keys.size();
+        T key = std::move(keys[i]);
+        index_type slot = owner[i];
+        for ( ;; ) {
+            size_t first = D * i + 1;
+            if ( first >= n ) {
+                break;
+            }
+            size_t best = SmallestChild(first, n - first < D ? n - first : D);
+            if ( !compare(keys[best], key) ) {
+                break;
+            }
+            keys[i] = std::move(keys[best]);
+            owner[i] = owner[best];
+            position[owner[i]] = static_cast<index_type>(i);
+            i = best;
+        }
+        keys[i] = std::move(key);
+        owner[i] = slot;
+        position[slot] = static_cast<index_type>(i);
+    }
+
+    // removes the node at position i and returns its slot
+    index_type Remove(size_t i) {
+        index_type slot = owner[i];
+        size_t last = keys.size() - 1;
+        if ( i != last ) {
+            keys[i] = std::move(keys[last]);
+            owner[i] = owner[last];
+            position[owner[i]] = static_cast<index_type>(i);
+        }
+        keys.pop_back();
+        owner.pop_back();
+        if ( i < keys.size() ) {
+            if ( i > 0 && compare(keys[i], keys[(i - 1) / D]) ) {
+                SiftUp(i);
+            }
+            else {
+                SiftDown(i);
+            }
+        }
+        return slot;
+    }
+
+    // restores heap order over the whole array bottom-up, in O(n)
+    void Heapify() {
+        size_t n = keys.size();
+        if ( n < 2 ) {
+            return;
+        }
+        for ( size_t i = (n - 2) / D + 1; i-- > 0; ) {
+            SiftDown(i);
+        }
+    }
+
+    template <class InputIterator>
+    void reserve(InputIterator, InputIterator, std::input_iterator_tag) {}
+
+    template <class ForwardIterator>
+    void reserve(ForwardIterator first, ForwardIterator last,
+                 std::forward_iterator_tag) {
+        size_t count = keys.size() + std::distance(first, last);
+        keys.reserve(count);
+        owner.reserve(count);
+    }
+
+public:
+    // CONSTRUCTORS
+    explicit DaryHeap(const Compare &cmp = Compare(),
+                      const Allocator &alloc = Allocator()) :
+        compare(cmp), keys(alloc), owner(alloc), position(alloc),
+        values(alloc), free_slot(NIL) {}
+
+    template <class InputIterator>
+    DaryHeap(InputIterator first, InputIterator last,
+             const Compare &cmp = Compare(), const Allocator &alloc = Allocator()) :
+        compare(cmp), keys(alloc), owner(alloc), position(alloc),
+        values(alloc), free_slot(NIL) {
+        insert_range(first, last);
+    }
+
+    // FUNCTIONS
+    void swap(DaryHeap &H) {
+        std::swap(compare, H.compare);
+        keys.swap(H.keys);
+        owner.swap(H.owner);
+        position.swap(H.position);
+        values.swap(H.values);
+        std::swap(free_slot, H.free_slot);
+    }
+
+    size_t size() const { return keys.size(); }
+
+    bool empty() const { return keys.empty(); }
+
+    // reserves room for count nodes
+    void reserve(size_t count) {
+        keys.reserve(count);
+        owner.reserve(count);
+        position.reserve(count);
+        values.reserve(count);
+    }
+
+    // places a new node in the heap and returns its handle
+    handle insert(const T &key) {
+        return emplace(key);
+    }
+
+    handle insert(const T &key, const value_type &value) {
+        return emplace(key, value);
+    }
+
+    // constructs the key from k and the payload from args in a new node
+    template <class K, class... Args>
+    handle emplace(K&& k, Args&&... args) {
+        index_type slot = allocate(std::forward<Args>(args)...);
+        try {
+            keys.push_back(std::forward<K>(k));
+            try {
+                owner.push_back(slot);
+            }
+            catch ( ... ) {
+                keys.pop_back();
+                throw;
+            }
+        }
+        catch ( ... ) {
+            deallocate(slot);
+            throw;
+        }
+        INSTRUMENT_COUNT(HEAP_INSERTS, 1);
+        SiftUp(keys.size() - 1);
+        return handle(slot);
+    }
+
+    // inserts every key of [first, last). a range at least as large as the
+    // heap is appended as it is and the heap rebuilt bottom-up
+    template <class InputIterator>
+    void insert_range(InputIterator first, InputIterator last) {
+        reserve(first, last,
+                typename std::iterator_traits<InputIterator>::iterator_category());
+        size_t old = keys.size();
+        for ( ; first != last; ++first ) {
+            index_type slot = allocate();
+            keys.push_back(*first);
+            owner.push_back(slot);
+            position[slot] = static_cast<index_type>(keys.size() - 1);
+        }
+        INSTRUMENT_COUNT(HEAP_INSERTS, keys.size() - old);
+        if ( keys.size() - old >= old ) {
+            Heapify();
+        }
+        else {
+            for ( size_t i = old; i < keys.size(); i++ ) {
+                SiftUp(i);
+            }
+        }
+    }
+
+    // the node holding the minimum, or a null handle when the heap is empty
+    handle top() const {
+        if ( keys.empty() ) {
+            return handle();
+        }
+        return handle(owner[0]);
+    }
+
+    // the key and payload of a node in the heap
+    const T& key(handle h) const { return keys[position[h.slot]]; }
+    value_type& value(handle h) { return values[h.slot]; }
+
+    // moves a node's key towards the minimum in O(log_D n) time.
+    // throws KeyIncrease exception
+    void decrease_key(handle h, const T &key) {
+        size_t i = position[h.slot];
+        if ( compare(keys[i], key) ) {
+            throw KeyIncrease();
+        }
+        keys[i] = key;
+        SiftUp(i);
+    }
+
+    // removes a node from the heap
+    void erase(handle h) {
+        deallocate(Remove(position[h.slot]));
+    }
+
+    // moves every node of other into this heap, which leaves other empty and
+    // its handles invalid
+    void merge(DaryHeap &&other) {
+        if ( &other == this ) {
+            return;
+        }
+        size_t old = keys.size();
+        reserve(old + other.keys.size());
+        for ( size_t i = 0; i < other.keys.size(); i++ ) {
+            index_type slot = allocate(std::move(other.values[other.owner[i]]));
+            keys.push_back(std::move(other.keys[i]));
+            owner.push_back(slot);
+            position[slot] = static_cast<index_type>(keys.size() - 1);
+        }
+        if ( keys.size() - old >= old ) {
+            Heapify();
+        }
+        else {
+            for ( size_t i = old; i < keys.size(); i++ ) {
+                SiftUp(i);
+            }
+        }
+        DaryHeap empty(other.compare);
+        other.swap(empty);
+    }
+
+    // the minimum value still in the heap
+    T min() const {
+        return keys.empty() ?
+               std::numeric_limits<T>::lowest() :
+               keys[0];
+    }
+
+    // extracts the minimum value and frees the node that contained it
+    T extractMin() {
+        T key = std::move(keys[0]);
+        deallocate(Remove(0));
+        INSTRUMENT_COUNT(HEAP_EXTRACTS, 1);
+        return key;
+    }
+
+    // extracts the minimum value and moves its payload into value
+    T extractMin(value_type &value) {
+        T key = std::move(keys[0]);
+        index_type slot = Remove(0);
+        value = std::move(values[slot]);
+        deallocate(slot);
+        INSTRUMENT_COUNT(HEAP_EXTRACTS, 1);
+        return key;
+    }
+};
+
+template <class T, unsigned int D, class Value, class Compare, class Allocator>
+const typename DaryHeap<T, D, Value, Compare, Allocator>::index_type
+    DaryHeap<T, D, Value, Compare, Allocator>::NIL;
+
+#endif
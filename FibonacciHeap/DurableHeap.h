@@ -0,0 +1,396 @@
+#ifndef DURABLEHEAP_H_
+#define DURABLEHEAP_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "FibHeap.h"
+#include "HeapValue.h"
+#include "IOError.h"
+
+/* DurableHeap
+ ******************************************************************************
+ *
+ * a FibHeap kept on disk, for a scheduler that must come back with its
+ * pending items after a restart. items are named by ids that stay the same
+ * across restarts, where FibHeap handles are addresses that do not; the id
+ * of an item travels in its payload, so restoring the heap also restores
+ * the table from ids to handles.
+ *
+ * the state lives in two files next to each other. prefix.snapshot holds
+ * the whole heap as FibHeap::save wrote it at the last checkpoint, forest
+ * shape and marks included, and prefix.journal every insert, decrease_key,
+ * erase and extraction since, as one fixed-size record each. opening a
+ * DurableHeap restores the snapshot in O(n) and replays the journal; a
+ * record cut short by a crash is dropped. checkpoint writes a new snapshot
+ * beside the old one, renames it over it and starts an empty journal, so
+ * its cost is one sequential write of the heap however long the journal
+ * had grown. both files carry the number of the checkpoint they belong to,
+ * and a journal older than its snapshot is ignored.
+ *
+ * journal records go through the buffer of the C library: they reach the
+ * operating system on sync(), checkpoint() and destruction, or when the
+ * buffer fills. keys and payloads must be trivially copyable, and are
+ * written in the byte order of the machine. every failure to open, read or
+ * write a file throws IOError naming it.
+ *
+ * Operations:
+ *
+ * -    insert(key), insert(key, value):
+ *          O(1) amortized; returns the id of the new item
+ *
+ * -    decrease_key(id, key), erase(id), extractMin():
+ *          as on FibHeap, plus one journal record
+ *
+ * -    checkpoint():
+ *          O(n) sequential write; empties the journal
+ *
+ * -    DurableHeap(prefix):
+ *          O(n + # journal records) to reopen a heap saved under prefix
+ *
+ */
+
+template <class T, class Value = void, class Compare = std::less<T> >
+class DurableHeap {
+
+public:
+    typedef T key_type;
+    typedef typename HeapValue<Value>::type value_type;
+    typedef Compare key_compare;
+    typedef std::uint64_t id_type;
+
+    static const id_type NONE = ~static_cast<id_type>(0);
+
+private:
+    // the payload of a FibHeap node: the item's id, then its own payload
+    struct Entry {
+        id_type id;
+        value_type value;
+    };
+
+    typedef FibHeap<T, Entry, Compare> Heap;
+
+    enum Operation {
+        INSERT = 1,
+        DECREASE = 2,
+        ERASE = 3
+    };
+
+    struct Record {
+        std::uint64_t operation;
+        id_type id;
+        T key;
+        value_type value;
+    };
+
+    // the first word of each file, "DurHeap1" in little-endian order
+    static const std::uint64_t MAGIC = 0x3170616548727544ull;
+
+    // VARIABLES
+    std::string prefix;
+    Heap heap;
+    // the node of every id in use, and the ids free for reuse
+    std::vector<typename Heap::handle> handles;
+    std::vector<id_type> free;
+    size_t n;
+    std::FILE* journal;
+    std::uint64_t sequence;
+    size_t records;
+
+    // FUNCTIONS
+    std::string SnapshotPath() const { return prefix + ".snapshot"; }
+    std::string JournalPath() const { return prefix + ".journal"; }
+
+    bool Used(id_type id) const {
+        return id < handles.size() && handles[id] != typename Heap::handle();
+    }
+
+    void Log(Operation operation, id_type id, const T &key,
+             const value_type &value = value_type()) {
+        if ( journal == NULL ) {
+            throw IOError(JournalPath());
+        }
+        Record record = Record();
+        record.operation = operation;
+        record.id = id;
+        record.key = key;
+        record.value = value;
+        if ( std::fwrite(&record, sizeof(record), 1, journal) != 1 ) {
+            throw IOError(JournalPath());
+        }
+        records++;
+    }
+
+    void Place(id_type id, const T &key, const value_type &value) {
+        if ( id >= handles.size() ) {
+            handles.resize(id + 1);
+        }
+        Entry entry = { id, value };
+        handles[id] = heap.insert(key, entry);
+        n++;
+    }
+
+    void Remove(id_type id) {
+        heap.erase(handles[id]);
+        handles[id] = typename Heap::handle();
+        free.push_back(id);
+        n--;
+    }
+
+    // reads the snapshot, if there is one, and returns its sequence number
+    std::uint64_t Load() {
+        std::FILE* file = std::fopen(SnapshotPath().c_str(), "rb");
+        if ( file == NULL ) {
+            return 0;
+        }
+        std::uint64_t header[3];
+        std::vector<typename Heap::handle> restored;
+        bool valid = std::fread(header, sizeof(header), 1, file) == 1 &&
+                     header[0] == MAGIC;
+        if ( valid ) {
+            try {
+                heap.restore(file, std::back_inserter(restored));
+            }
+            catch ( typename Heap::SnapshotError& ) {
+                valid = false;
+            }
+        }
+        std::fclose(file);
+        // checkpoint drops trailing free ids, so the slot count is one past
+        // the greatest id restored, which bounds it by the file's contents
+        id_type slots = 0;
+        for ( size_t i = 0; valid && i < restored.size(); i++ ) {
+            id_type id = heap.value(restored[i]).id;
+            if ( id >= header[2] ) {
+                valid = false;
+            }
+            else if ( id >= slots ) {
+                slots = id + 1;
+            }
+        }
+        if ( !valid || header[2] != slots ) {
+            throw IOError(SnapshotPath());
+        }
+        handles.resize(slots);
+        for ( size_t i = 0; i < restored.size(); i++ ) {
+            id_type id = heap.value(restored[i]).id;
+            if ( Used(id) ) {
+                throw IOError(SnapshotPath());
+            }
+            handles[id] = restored[i];
+        }
+        n = restored.size();
+        return header[1];
+    }
+
+    // applies the journal written since the snapshot and leaves it open
+    // after its last whole record, or starts a new one
+    void Replay() {
+        journal = std::fopen(JournalPath().c_str(), "r+b");
+        std::uint64_t header[2];
+        if ( journal == NULL ||
+             std::fread(header, sizeof(header), 1, journal) != 1 ||
+             header[0] != MAGIC || header[1] != sequence ) {
+            if ( journal != NULL ) {
+                std::fclose(journal);
+            }
+            Restart();
+            return;
+        }
+        Record record;
+        long end = static_cast<long>(sizeof(header));
+        while ( std::fread(&record, sizeof(record), 1, journal) == 1 ) {
+            bool valid = record.operation == INSERT ? record.id <= handles.size() && !Used(record.id) :
+                         record.operation == DECREASE || record.operation == ERASE ?
+                         Used(record.id) : false;
+            if ( valid && record.operation == DECREASE ) {
+                try {
+                    heap.decrease_key(handles[record.id], record.key);
+                }
+                catch ( typename Heap::KeyIncrease& ) {
+                    valid = false;
+                }
+            }
+            if ( !valid ) {
+                std::fclose(journal);
+                journal = NULL;
+                throw IOError(JournalPath());
+            }
+            if ( record.operation == INSERT ) {
+                Place(record.id, record.key, record.value);
+            }
+            else if ( record.operation == ERASE ) {
+                Remove(record.id);
+            }
+            records++;
+            end += static_cast<long>(sizeof(record));
+        }
+        // the next record overwrites any partial one left by a crash
+        if ( std::ferror(journal) || std::fseek(journal, end, SEEK_SET) != 0 ) {
+            std::fclose(journal);
+            journal = NULL;
+            throw IOError(JournalPath());
+        }
+    }
+
+    // opens an empty journal for the current sequence number
+    void Restart() {
+        journal = std::fopen(JournalPath().c_str(), "wb");
+        std::uint64_t header[2] = { MAGIC, sequence };
+        if ( journal == NULL ) {
+            throw IOError(JournalPath());
+        }
+        if ( std::fwrite(header, sizeof(header), 1, journal) != 1 ) {
+            std::fclose(journal);
+            journal = NULL;
+            throw IOError(JournalPath());
+        }
+        records = 0;
+    }
+
+public:
+    // CONSTRUCTORS
+    // opens the heap saved under prefix, or an empty one if there is none
+    explicit DurableHeap(const std::string &path_prefix,
+                         const Compare &cmp = Compare()) :
+        prefix(path_prefix), heap(cmp), n(0), journal(NULL), sequence(0),
+        records(0) {
+        static_assert(std::is_trivially_copyable<T>::value &&
+                      std::is_trivially_copyable<value_type>::value,
+                      "keys and payloads must be trivially copyable");
+        sequence = Load();
+        Replay();
+        free.clear();
+        for ( id_type id = handles.size(); id-- > 0; ) {
+            if ( !Used(id) ) {
+                free.push_back(id);
+            }
+        }
+    }
+
+    DurableHeap(const DurableHeap&) = delete;
+    DurableHeap& operator=(const DurableHeap&) = delete;
+
+    // DESTRUCTOR
+    // flushes the journal; the heap stays on disk
+    ~DurableHeap() {
+        if ( journal != NULL ) {
+            std::fclose(journal);
+        }
+    }
+
+    // FUNCTIONS
+    size_t size() const { return n; }
+
+    bool empty() const { return n == 0; }
+
+    // the number of journal records a checkpoint would fold into the
+    // snapshot
+    size_t journaled() const { return records; }
+
+    bool contains(id_type id) const { return Used(id); }
+
+    // the key and payload of an item in the heap
+    const T& key(id_type id) { return heap.key(handles[id]); }
+    const value_type& value(id_type id) { return heap.value(handles[id]).value; }
+
+    // the id of an item of least key, or NONE when the heap is empty
+    id_type top() { return n == 0 ? NONE : heap.value(heap.top()).id; }
+
+    id_type insert(const T &key) { return insert(key, value_type()); }
+
+    id_type insert(const T &key, const value_type &value) {
+        bool reused = !free.empty();
+        id_type id = reused ? free.back() : handles.size();
+        Log(INSERT, id, key, value);
+        Place(id, key, value);
+        if ( reused ) {
+            free.pop_back();
+        }
+        return id;
+    }
+
+    // throws FibHeap's KeyIncrease before logging anything
+    void decrease_key(id_type id, const T &key) {
+        heap.decrease_key(handles[id], key);
+        Log(DECREASE, id, key);
+    }
+
+    void erase(id_type id) {
+        Log(ERASE, id, heap.key(handles[id]));
+        Remove(id);
+    }
+
+    T extractMin() {
+        value_type value;
+        return extractMin(value);
+    }
+
+    // extracts an item of least key, copying its payload into value
+    T extractMin(value_type &value) {
+        id_type id = top();
+        T key = heap.key(handles[id]);
+        value = heap.value(handles[id]).value;
+        erase(id);
+        return key;
+    }
+
+    // passes the journal to the operating system
+    void sync() {
+        if ( journal == NULL || std::fflush(journal) != 0 ) {
+            throw IOError(JournalPath());
+        }
+    }
+
+    // writes the heap to a new snapshot that replaces the old one, and
+    // empties the journal
+    void checkpoint() {
+        // drops the free ids past the greatest one in use, which Load
+        // relies on
+        while ( !handles.empty() && handles.back() == typename Heap::handle() ) {
+            handles.pop_back();
+        }
+        free.erase(std::remove_if(free.begin(), free.end(),
+                                  [this](id_type id) { return id >= handles.size(); }),
+                   free.end());
+        std::string temporary = SnapshotPath() + ".tmp";
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        if ( file == NULL ) {
+            throw IOError(temporary);
+        }
+        std::uint64_t header[3] = { MAGIC, sequence + 1, handles.size() };
+        bool written = std::fwrite(header, sizeof(header), 1, file) == 1;
+        if ( written ) {
+            try {
+                heap.save(file);
+            }
+            catch ( typename Heap::SnapshotError& ) {
+                written = false;
+            }
+        }
+        written = std::fclose(file) == 0 && written;
+        if ( !written || std::rename(temporary.c_str(), SnapshotPath().c_str()) != 0 ) {
+            std::remove(temporary.c_str());
+            throw IOError(SnapshotPath());
+        }
+        sequence++;
+        std::fclose(journal);
+        journal = NULL;
+        Restart();
+    }
+};
+
+template <class T, class Value, class Compare>
+const typename DurableHeap<T, Value, Compare>::id_type
+    DurableHeap<T, Value, Compare>::NONE;
+
+template <class T, class Value, class Compare>
+const std::uint64_t DurableHeap<T, Value, Compare>::MAGIC;
+
+#endif
@@ -0,0 +1,413 @@
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "FibHeap.h"
+
+/* LatencyHistogram
+ ******************************************************************************
+ *
+ * a histogram of durations in power-of-two buckets of nanoseconds: bucket 0
+ * counts durations under 1 ns and bucket b those in [2^(b-1), 2^b). the
+ * last bucket also takes everything longer. counters are relaxed atomics, so
+ * any thread may record while another reads.
+ *
+ * Operations:
+ *
+ * -    record(duration):
+ *          O(1)
+ *
+ * -    count(), count(b), bound(b):
+ *          the number of durations recorded, in total or in bucket b, and
+ *          the exclusive upper bound of bucket b in nanoseconds
+ *
+ * -    percentile(q):
+ *          the upper bound of the bucket holding the q-th quantile
+ *
+ * -    dump(out):
+ *          writes the non-empty buckets as a single JSON object
+ *
+ */
+
+class LatencyHistogram {
+public:
+    static const int BUCKETS = 48;
+
+    LatencyHistogram() { reset(); }
+
+    void record(std::chrono::nanoseconds elapsed) {
+        long long ns = elapsed.count();
+        int b = 0;
+        while ( b < BUCKETS - 1 && ns >= (1LL << b) ) {
+            b++;
+        }
+        counts[b].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    unsigned long long count(int bucket) const {
+        return counts[bucket].load(std::memory_order_relaxed);
+    }
+
+    unsigned long long count() const {
+        unsigned long long total = 0;
+        for ( int b = 0; b < BUCKETS; b++ ) {
+            total += count(b);
+        }
+        return total;
+    }
+
+    static unsigned long long bound(int bucket) { return 1ULL << bucket; }
+
+    unsigned long long percentile(double q) const {
+        unsigned long long total = count(), seen = 0;
+        for ( int b = 0; b < BUCKETS; b++ ) {
+            seen += count(b);
+            if ( seen > 0 && seen >= q * total ) {
+                return bound(b);
+            }
+        }
+        return bound(BUCKETS - 1);
+    }
+
+    void reset() {
+        for ( int b = 0; b < BUCKETS; b++ ) {
+            counts[b].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void dump(std::ostream &out) const {
+        out << "{\"count\":" << count() << ",\"p50_ns\":" << percentile(0.5)
+            << ",\"p99_ns\":" << percentile(0.99) << ",\"buckets\":{";
+        bool first = true;
+        for ( int b = 0; b < BUCKETS; b++ ) {
+            if ( count(b) ) {
+                out << (first ? "" : ",") << "\"" << bound(b) << "\":"
+                    << count(b);
+                first = false;
+            }
+        }
+        out << "}}";
+    }
+
+private:
+    std::atomic<unsigned long long> counts[BUCKETS];
+};
+
+/* Executor
+ ******************************************************************************
+ *
+ * a pool of worker threads that runs submitted tasks in priority order. each
+ * worker has its own FibHeap of queued tasks, keyed by priority, and always
+ * runs the first task of its own heap; a worker whose heap is empty steals
+ * the first task of another worker's heap. order is therefore strict within
+ * a worker and approximate across workers. for earliest-deadline-first
+ * scheduling, use the deadline as the priority, e.g. a
+ * std::chrono::steady_clock::time_point.
+ *
+ * a task submitted from a worker goes to that worker's heap, any other to
+ * the workers in turn. the task handle returned by submit names the heap
+ * node of the task, so it can be cancelled or given a new priority while it
+ * is queued. a task is stolen only to be run, so it never moves between
+ * heaps while queued.
+ *
+ * the time from submission to the start of every task is recorded in a
+ * LatencyHistogram. an exception thrown by a task is kept in its handle. the
+ * destructor runs every task still queued, then joins the workers; no task
+ * may be submitted once the destructor has started.
+ *
+ * Operations:
+ *
+ * -    submit(work, priority):
+ *          O(1)
+ *
+ * -    reprioritize(task, priority):
+ *          O(1) amortized towards the front, O(log n) amortized away from
+ *          it. false if the task is no longer queued
+ *
+ * -    cancel(task):
+ *          O(log n) amortized. false if the task is no longer queued
+ *
+ * -    wait():
+ *          blocks until every queued task has run
+ *
+ * -    latency(), steals(), pending():
+ *          the scheduling latency histogram, the number of tasks stolen,
+ *          and the number of tasks queued or running
+ *
+ */
+
+template <class Priority = double, class Compare = std::less<Priority> >
+class Executor {
+
+public:
+    enum Status {
+        QUEUED,
+        RUNNING,
+        DONE,
+        FAILED,
+        CANCELLED
+    };
+
+private:
+    struct Record;
+    typedef FibHeap<Priority, std::shared_ptr<Record>, Compare> Heap;
+    typedef std::chrono::steady_clock Clock;
+
+    struct Record {
+        std::function<void()> work;
+        // the worker whose heap holds the task, fixed at submission
+        unsigned int worker;
+        // the node of the task, guarded by the lock of its worker
+        typename Heap::handle node;
+        std::atomic<int> status;
+        Clock::time_point submitted;
+        std::exception_ptr error;
+
+        Record(std::function<void()> &&w, unsigned int i) :
+            work(std::move(w)), worker(i), status(QUEUED),
+            submitted(Clock::now()) {}
+    };
+
+    struct Worker {
+        std::mutex lock;
+        Heap heap;
+        // keeps neighbouring workers off each other's cache lines
+        char padding[64];
+    };
+
+    // the executor and index of the worker running on this thread
+    struct Current {
+        const Executor* executor;
+        unsigned int index;
+    };
+
+public:
+    // HANDLES
+    // names a submitted task for as long as the handle exists
+    class task {
+        friend class Executor;
+        std::shared_ptr<Record> record;
+        explicit task(const std::shared_ptr<Record> &r) : record(r) {}
+    public:
+        task() {}
+        Status status() const {
+            return static_cast<Status>(record->status.load());
+        }
+        // the exception thrown by a FAILED task
+        std::exception_ptr error() const { return record->error; }
+        bool operator==(const task &t) const { return record == t.record; }
+        bool operator!=(const task &t) const { return record != t.record; }
+    };
+
+private:
+    // VARIABLES
+    Compare compare;
+    std::vector<Worker> workers;
+    std::vector<std::thread> threads;
+    LatencyHistogram histogram;
+    std::atomic<unsigned int> next;
+    std::atomic<unsigned long long> stolen;
+    // tasks counted from submission until they have run or are cancelled
+    std::atomic<size_t> queued;
+    std::atomic<size_t> running;
+    std::mutex sleep;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool stopping;
+
+    // FUNCTIONS
+    static Current& current() {
+        static thread_local Current instance = { NULL, 0 };
+        return instance;
+    }
+
+    // moves the first task of worker i to record, if it has one. with
+    // block false, gives up when the lock is taken
+    bool Take(unsigned int i, std::shared_ptr<Record> &record, bool block) {
+        std::unique_lock<std::mutex> guard(workers[i].lock, std::defer_lock);
+        if ( block ) {
+            guard.lock();
+        }
+        else if ( !guard.try_lock() ) {
+            return false;
+        }
+        if ( workers[i].heap.empty() ) {
+            return false;
+        }
+        workers[i].heap.extractMin(record);
+        record->status = RUNNING;
+        running++;
+        queued--;
+        return true;
+    }
+
+    // takes the first task of some other worker, starting after self
+    bool Steal(unsigned int self, std::shared_ptr<Record> &record) {
+        for ( size_t k = 1; k < workers.size(); k++ ) {
+            if ( Take((self + k) % workers.size(), record, false) ) {
+                stolen++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Run(std::shared_ptr<Record> &record) {
+        histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - record->submitted));
+        try {
+            record->work();
+            record->status = DONE;
+        }
+        catch ( ... ) {
+            record->error = std::current_exception();
+            record->status = FAILED;
+        }
+        // releases whatever the task captured before reporting it done
+        record->work = nullptr;
+        record.reset();
+        Finish();
+    }
+
+    // leaves the count of running tasks and wakes wait() when nothing is left
+    void Finish() {
+        if ( --running == 0 && queued == 0 ) {
+            std::lock_guard<std::mutex> guard(sleep);
+            idle.notify_all();
+        }
+    }
+
+    void Work(unsigned int self) {
+        Current c = { this, self };
+        current() = c;
+        std::shared_ptr<Record> record;
+        for ( ;; ) {
+            if ( Take(self, record, true) || Steal(self, record) ) {
+                Run(record);
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleep);
+            if ( queued == 0 ) {
+                if ( stopping ) {
+                    return;
+                }
+                wake.wait(guard);
+            }
+        }
+    }
+
+public:
+    // CONSTRUCTORS
+    // starts the given number of workers, and at least one
+    explicit Executor(unsigned int count = std::thread::hardware_concurrency()) :
+        workers(count ? count : 1), next(0), stolen(0), queued(0), running(0),
+        stopping(false) {
+        for ( unsigned int i = 0; i < workers.size(); i++ ) {
+            threads.push_back(std::thread(&Executor::Work, this, i));
+        }
+    }
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    // DESTRUCTOR
+    // runs every queued task, then joins the workers
+    ~Executor() {
+        {
+            std::lock_guard<std::mutex> guard(sleep);
+            stopping = true;
+            wake.notify_all();
+        }
+        for ( size_t i = 0; i < threads.size(); i++ ) {
+            threads[i].join();
+        }
+    }
+
+    // FUNCTIONS
+    // queues work to run at the given priority
+    task submit(std::function<void()> work, const Priority &priority) {
+        Current &c = current();
+        unsigned int i = c.executor == this ?
+                         c.index : next++ % workers.size();
+        std::shared_ptr<Record> record =
+            std::make_shared<Record>(std::move(work), i);
+        queued++;
+        {
+            std::lock_guard<std::mutex> guard(workers[i].lock);
+            record->node = workers[i].heap.insert(priority, record);
+        }
+        std::lock_guard<std::mutex> guard(sleep);
+        wake.notify_one();
+        return task(record);
+    }
+
+    // gives a queued task a new priority
+    bool reprioritize(const task &t, const Priority &priority) {
+        Record* record = t.record.get();
+        Worker &w = workers[record->worker];
+        std::lock_guard<std::mutex> guard(w.lock);
+        if ( record->status != QUEUED ) {
+            return false;
+        }
+        if ( !compare(w.heap.key(record->node), priority) ) {
+            w.heap.decrease_key(record->node, priority);
+        }
+        else {
+            w.heap.erase(record->node);
+            record->node = w.heap.insert(priority, t.record);
+        }
+        return true;
+    }
+
+    // takes a queued task out of its heap, so that it never runs
+    bool cancel(const task &t) {
+        Record* record = t.record.get();
+        Worker &w = workers[record->worker];
+        {
+            std::lock_guard<std::mutex> guard(w.lock);
+            if ( record->status != QUEUED ) {
+                return false;
+            }
+            w.heap.erase(record->node);
+            record->status = CANCELLED;
+            record->work = nullptr;
+        }
+        if ( --queued == 0 && running == 0 ) {
+            std::lock_guard<std::mutex> guard(sleep);
+            idle.notify_all();
+        }
+        return true;
+    }
+
+    // blocks until no task is queued or running. must not be called from a
+    // task
+    void wait() {
+        std::unique_lock<std::mutex> guard(sleep);
+        while ( queued != 0 || running != 0 ) {
+            idle.wait(guard);
+        }
+    }
+
+    size_t pending() const { return queued + running; }
+
+    size_t worker_count() const { return workers.size(); }
+
+    unsigned long long steals() const { return stolen; }
+
+    const LatencyHistogram& latency() const { return histogram; }
+
+    LatencyHistogram& latency() { return histogram; }
+};
+
+#endif
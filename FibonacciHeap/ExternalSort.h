@@ -0,0 +1,345 @@
+#ifndef EXTERNALSORT_H_
+#define EXTERNALSORT_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "DaryHeap.h"
+#include "FibHeap.h"
+#include "IOError.h"
+
+/* RunReader, RunWriter
+ ******************************************************************************
+ *
+ * streams of fixed-size binary records of a trivially copyable T, read and
+ * written through buffers of a given number of records.
+ *
+ * a RunWriter fills one buffer while the other is being written: a full
+ * buffer is handed to a write on another thread, and the next flush waits
+ * for it. close() writes what is left and reports any failure; the
+ * destructor closes without reporting.
+ *
+ * both throw IOError, naming the file, when it cannot be opened, read or
+ * written in full.
+ *
+ */
+
+template <class T>
+class RunReader {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "records must be trivially copyable");
+
+private:
+    std::string path;
+    std::FILE* file;
+    std::vector<T> buffer;
+    size_t position;
+    size_t filled;
+
+    bool Fill() {
+        filled = std::fread(buffer.data(), sizeof(T), buffer.size(), file);
+        position = 0;
+        if ( filled < buffer.size() && std::ferror(file) ) {
+            throw IOError(path);
+        }
+        return filled != 0;
+    }
+
+public:
+    RunReader(const std::string &p, size_t records) :
+        path(p), file(std::fopen(p.c_str(), "rb")),
+        buffer(records ? records : 1), position(0), filled(0) {
+        if ( file == NULL ) {
+            throw IOError(path);
+        }
+        std::setvbuf(file, NULL, _IONBF, 0);
+    }
+
+    RunReader(const RunReader&) = delete;
+    RunReader& operator=(const RunReader&) = delete;
+
+    ~RunReader() { std::fclose(file); }
+
+    // the next record, or NULL at the end of the file. the pointer is valid
+    // until the following call
+    const T* next() {
+        if ( position == filled && !Fill() ) {
+            return NULL;
+        }
+        return &buffer[position++];
+    }
+};
+
+template <class T>
+class RunWriter {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "records must be trivially copyable");
+
+private:
+    std::string path;
+    std::FILE* file;
+    std::vector<T> filling;
+    std::vector<T> writing;
+    size_t used;
+    // the write of the other buffer, and whether it wrote everything
+    std::future<bool> pending;
+
+    void Wait() {
+        if ( pending.valid() && !pending.get() ) {
+            throw IOError(path);
+        }
+    }
+
+    void Flush() {
+        Wait();
+        filling.swap(writing);
+        std::FILE* f = file;
+        const T* data = writing.data();
+        size_t count = used;
+        pending = std::async(std::launch::async, [f, data, count]() {
+            return std::fwrite(data, sizeof(T), count, f) == count;
+        });
+        used = 0;
+    }
+
+public:
+    RunWriter(const std::string &p, size_t records) :
+        path(p), file(std::fopen(p.c_str(), "wb")),
+        filling(records ? records : 1), writing(filling.size()), used(0) {
+        if ( file == NULL ) {
+            throw IOError(path);
+        }
+        std::setvbuf(file, NULL, _IONBF, 0);
+    }
+
+    RunWriter(const RunWriter&) = delete;
+    RunWriter& operator=(const RunWriter&) = delete;
+
+    ~RunWriter() {
+        try {
+            close();
+        }
+        catch ( ... ) {
+        }
+    }
+
+    void write(const T &record) {
+        if ( used == filling.size() ) {
+            Flush();
+        }
+        filling[used++] = record;
+    }
+
+    // writes every buffered record and closes the file
+    void close() {
+        if ( file == NULL ) {
+            return;
+        }
+        bool written;
+        try {
+            if ( used != 0 ) {
+                Flush();
+            }
+            Wait();
+            written = true;
+        }
+        catch ( ... ) {
+            written = false;
+        }
+        written = std::fclose(file) == 0 && written;
+        file = NULL;
+        if ( !written ) {
+            throw IOError(path);
+        }
+    }
+};
+
+/* ExternalSort
+ ******************************************************************************
+ *
+ * sorts a file of fixed-size binary records of T that does not fit in
+ * memory, in two phases.
+ *
+ * runs() cuts the input into sorted runs by replacement selection: a
+ * DaryHeap of memory records, each tagged with the run it belongs to, always
+ * yields the next record of the current run; a record read that comes
+ * before the one just written is tagged for the next run. on random input
+ * the runs are twice the memory on average, and already sorted input gives
+ * a single run.
+ *
+ * merge() streams k runs into one output through a heap holding one cursor
+ * per run, keyed by the run's next record, so each record costs one
+ * extractMin and one insert on a heap of k. Heap may be any engine in this
+ * directory; the default is a 4-ary DaryHeap, which keeps the k cursors in
+ * a few cache lines. when there are more runs than fan_in, merge() first
+ * merges groups of fan_in into intermediate runs.
+ *
+ * every file goes through a RunReader or RunWriter of buffer records, so
+ * reads and writes are few and large, and each output is written by another
+ * thread while the next buffer fills. temporary runs are named after prefix
+ * and removed once merged.
+ *
+ * Operations:
+ *
+ * -    runs(input):
+ *          O(N log M) time for N records and memory M; returns the run files
+ *
+ * -    merge(runs, output):
+ *          O(N log k) time per pass; removes the runs
+ *
+ * -    sort(input, output):
+ *          both of the above
+ *
+ */
+
+template <class T, class Compare = std::less<T>,
+          class Heap = DaryHeap<T, 4, unsigned int, Compare> >
+class ExternalSort {
+
+private:
+    // a record of the input and the run it goes to
+    struct Tagged {
+        size_t run;
+        T record;
+    };
+
+    struct TaggedCompare {
+        Compare compare;
+        explicit TaggedCompare(const Compare &c = Compare()) : compare(c) {}
+        bool operator()(const Tagged &a, const Tagged &b) const {
+            return a.run != b.run ? a.run < b.run : compare(a.record, b.record);
+        }
+    };
+
+    // VARIABLES
+    Compare compare;
+    std::string prefix;
+    size_t memory;
+    size_t buffer;
+    size_t fan_in;
+    size_t created;
+
+    // FUNCTIONS
+    std::string RunName() {
+        std::ostringstream name;
+        name << prefix << "." << created++;
+        return name.str();
+    }
+
+    // merges runs into a single file, and returns the number of records
+    size_t Merge(const std::vector<std::string> &runs, const std::string &output) {
+        std::vector<std::unique_ptr<RunReader<T> > > readers;
+        Heap heap(compare);
+        for ( size_t i = 0; i < runs.size(); i++ ) {
+            readers.emplace_back(new RunReader<T>(runs[i], buffer));
+            const T* first = readers[i]->next();
+            if ( first != NULL ) {
+                heap.insert(*first, static_cast<unsigned int>(i));
+            }
+        }
+        RunWriter<T> writer(output, buffer);
+        size_t count = 0;
+        unsigned int run;
+        while ( !heap.empty() ) {
+            writer.write(heap.extractMin(run));
+            count++;
+            const T* next = readers[run]->next();
+            if ( next != NULL ) {
+                heap.insert(*next, run);
+            }
+        }
+        writer.close();
+        return count;
+    }
+
+public:
+    // CONSTRUCTORS
+    // sorts in memory records at a time, through buffers of buffer records,
+    // merging at most fan_in runs at once
+    explicit ExternalSort(const std::string &temporary_prefix,
+                          size_t memory_records = 1 << 20,
+                          size_t buffer_records = 1 << 16,
+                          size_t merge_fan_in = 256,
+                          const Compare &cmp = Compare()) :
+        compare(cmp), prefix(temporary_prefix),
+        memory(memory_records ? memory_records : 1),
+        buffer(buffer_records ? buffer_records : 1),
+        fan_in(merge_fan_in < 2 ? 2 : merge_fan_in), created(0) {}
+
+    // FUNCTIONS
+    // writes the records of input as sorted runs and returns their names
+    std::vector<std::string> runs(const std::string &input) {
+        std::vector<std::string> names;
+        RunReader<T> reader(input, buffer);
+        DaryHeap<Tagged, 4, void, TaggedCompare> heap((TaggedCompare(compare)));
+        heap.reserve(memory);
+        const T* record;
+        while ( heap.size() < memory && (record = reader.next()) != NULL ) {
+            Tagged tagged = { 0, *record };
+            heap.insert(tagged);
+        }
+        std::unique_ptr<RunWriter<T> > writer;
+        size_t run = 0;
+        while ( !heap.empty() ) {
+            Tagged least = heap.extractMin();
+            if ( !writer || least.run != run ) {
+                if ( writer ) {
+                    writer->close();
+                }
+                run = least.run;
+                names.push_back(RunName());
+                writer.reset(new RunWriter<T>(names.back(), buffer));
+            }
+            writer->write(least.record);
+            if ( (record = reader.next()) != NULL ) {
+                Tagged tagged = { run, *record };
+                if ( compare(*record, least.record) ) {
+                    tagged.run++;
+                }
+                heap.insert(tagged);
+            }
+        }
+        if ( writer ) {
+            writer->close();
+        }
+        return names;
+    }
+
+    // merges the runs into output, fan_in at a time, removing each run once
+    // merged, and returns the number of records
+    size_t merge(std::vector<std::string> runs, const std::string &output) {
+        while ( runs.size() > fan_in ) {
+            std::vector<std::string> merged;
+            for ( size_t i = 0; i < runs.size(); i += fan_in ) {
+                std::vector<std::string> group(runs.begin() + i,
+                    runs.begin() + std::min(i + fan_in, runs.size()));
+                merged.push_back(RunName());
+                Merge(group, merged.back());
+                for ( size_t j = 0; j < group.size(); j++ ) {
+                    std::remove(group[j].c_str());
+                }
+            }
+            runs.swap(merged);
+        }
+        size_t count = Merge(runs, output);
+        for ( size_t i = 0; i < runs.size(); i++ ) {
+            std::remove(runs[i].c_str());
+        }
+        return count;
+    }
+
+    // sorts the records of input into output and returns their number
+    size_t sort(const std::string &input, const std::string &output) {
+        return merge(runs(input), output);
+    }
+};
+
+#endif
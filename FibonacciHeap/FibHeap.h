@@ -1,14 +1,51 @@
 #ifndef FIBONACCIHEAP_H_
 #define FIBONACCIHEAP_H_
 
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
-#include <cmath>
+#include <cstring>
 #include <limits>
+#include <algorithm>
 #include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "HeapValue.h"
+#include "Instrumentation.h"
+#include "NodePool.h"
 
-template <class T>
+/* FibHeap
+ * a Fibonacci heap of keys of type T, each carrying an optional payload of
+ * type Value stored in its node. keys are ordered by Compare, so the "minimum"
+ * is the first key in that order: std::less gives a min-heap and std::greater
+ * a max-heap. every operation named after the minimum, and decrease_key,
+ * follows the comparator.
+ *
+ * nodes are drawn from a NodePool, which obtains memory from Allocator in
+ * contiguous chunks and recycles freed nodes through a free list. the heap
+ * only calls the allocator when a chunk runs out and frees every chunk at
+ * once when it is destroyed
+ *
+ * for keys and payloads that are trivially copyable, save writes the forest
+ * to a file as it is, marks included, and restore rebuilds it in O(n) from
+ * one block of the pool, so a saved heap comes back in the shape it was
+ * left in rather than as n fresh roots to consolidate
+ */
+template <class T, class Value = void, class Compare = std::less<T>,
+          class Allocator = std::allocator<T> >
 class FibHeap {
 
+public:
+    typedef T key_type;
+    typedef typename HeapValue<Value>::type value_type;
+    typedef Compare key_compare;
+
 protected:
     /*
      * Algorithm from: Cormen et al. (2009) "Fibonacci Heaps," in Introduction to Algorithms, 3rd ed. Cambridge: MIT Press, pp. 505-530.
@@ -21,6 +58,7 @@ protected:
     struct FibonacciNode
     {
 	    C key;
+	    value_type value;
 
 	    bool mark;
 	
@@ -30,8 +68,12 @@ protected:
 	    FibonacciNode* child;
 	    unsigned int degree;
 
-        FibonacciNode() : key() mark() degree() p(left(right(child()))) {}
-        FibonacciNode(C value) : key(value), mark(), degree() {
+        FibonacciNode() : key(), value(), mark(), p(), left(), right(), child(), degree() {}
+        // constructs the key from k and the payload from args in place
+        template <class K, class... Args>
+        FibonacciNode(K&& k, Args&&... args) :
+            key(std::forward<K>(k)), value(std::forward<Args>(args)...),
+            mark(), degree() {
             p = left = right = child = 0;
         }
     };
@@ -41,8 +83,11 @@ protected:
     {	
 	    unsigned int n;
 	    FibonacciNode<C>* min;
+	    // CONSOLIDATE's array A, kept empty between calls. the degree of a
+	    // node is at most log base golden ratio of n < 47 for n < 2^32
+	    FibonacciNode<C>* A[64];
 
-        FibonacciHeap() : n(), min() {}
+        FibonacciHeap() : n(), min(), A() {}
     };
 
     // OPERATIONS
@@ -76,6 +121,7 @@ protected:
      */
     void Insert( FibonacciHeap<T>* H, FibonacciNode<T>* x )
     {
+	    INSTRUMENT_COUNT(HEAP_INSERTS, 1);
 	    // 1
 	    x->degree = 0;
 	    // 2
@@ -98,7 +144,7 @@ protected:
 		    H->min->left = x;
 		    x->right = H->min;
 		    // 9
-		    if ( x->key < H->min->key )
+		    if ( compare(x->key, H->min->key) )
 		    {
 			    // 10
 			    H->min = x;
@@ -108,6 +154,32 @@ protected:
 	    H->n++;
     }
 
+    /* InsertList(H,x,k)
+     * adds a circular list of k new roots, whose minimum is x, to the root
+     * list of H in O(1). this is lines 2-6 of UNION with x as H2.min, and
+     * equivalent to k calls of INSERT
+     */
+    void InsertList( FibonacciHeap<T>* H, FibonacciNode<T>* x, unsigned int k )
+    {
+	    INSTRUMENT_COUNT(HEAP_INSERTS, k);
+	    if ( H->min == NULL )
+	    {
+		    H->min = x;
+	    }
+	    else
+	    {
+		    H->min->right->left = x->left;
+		    x->left->right = H->min->right;
+		    H->min->right = x;
+		    x->left = H->min;
+		    if ( compare(x->key, H->min->key) )
+		    {
+			    H->min = x;
+		    }
+	    }
+	    H->n += k;
+    }
+
     /* *node = Minimum(H)
      * The minimum node of a Fibonacci Heap H is given by the pointer H.min
      * . . .
@@ -126,7 +198,7 @@ protected:
      * 6. H.n = H1.n + H2.n
      * 7. return H
      */
-    FibonacciHeap<T>* FibHeap<T>::Union( FibonacciHeap<T>* H1, FibonacciHeap<T>* H2 )
+    FibonacciHeap<T>* Union( FibonacciHeap<T>* H1, FibonacciHeap<T>* H2 )
     {
 	    FibonacciHeap<T>* H;
 	
@@ -143,7 +215,7 @@ protected:
 		    H2->min->left = H->min;
 	    }
 	    // 4
-	    if ( H1->min == NULL || ( H2->min != NULL && H2->min->key < H1->min->key ) )
+	    if ( H1->min == NULL || ( H2->min != NULL && compare(H2->min->key, H1->min->key) ) )
 	    {
 		    // 5
 		    H->min = H2->min;
@@ -157,12 +229,34 @@ protected:
 	    return H;
     }
 
+    /* UnionInto(H1,H2)
+     * Union without a new heap object: the root list of H2 is spliced into
+     * that of H1 in place, and H2 is left empty
+     */
+    void UnionInto( FibonacciHeap<T>* H1, FibonacciHeap<T>* H2 )
+    {
+	    if ( H1->min != NULL && H2->min != NULL )
+	    {
+		    H1->min->right->left = H2->min->left;
+		    H2->min->left->right = H1->min->right;
+		    H1->min->right = H2->min;
+		    H2->min->left = H1->min;
+	    }
+	    if ( H1->min == NULL || ( H2->min != NULL && compare(H2->min->key, H1->min->key) ) )
+	    {
+		    H1->min = H2->min;
+	    }
+	    H1->n += H2->n;
+	    H2->min = NULL;
+	    H2->n = 0;
+    }
+
     /* *node = ExtractMin(H)
      * 1. z = H.min
      * 2. if z != NULL
      * 3. 	for each child x of z
-     * 4. 		add x to the root list of H
-     * 5. 		x.p = NULL
+     * 4. 		x.p = NULL
+     * 5. 	splice the child list of z into the root list of H
      * 6. 	remove z from the root list of H
      * 7.   if z == z.right
      * 8. 		H.min = NULL
@@ -170,40 +264,38 @@ protected:
      *10. 		CONSOLIDATE(H)
      *11. 	H.n = H.n - 1
      *12. return z
+     *
+     * the children are spliced in as a whole ring rather than added one at a
+     * time, so nothing needs to be allocated to hold them
      */
     FibonacciNode<T>* ExtractMin( FibonacciHeap<T>* H )
     {
-	    FibonacciNode<T>* z, * x, * next;
-	    FibonacciNode<T>** childList;
+	    FibonacciNode<T>* z, * x, * w, * last;
 	
 	    // 1
 	    z = H->min;
 	    // 2
 	    if ( z != NULL )
 	    {
-		    // 3
+		    INSTRUMENT_COUNT(HEAP_EXTRACTS, 1);
 		    x = z->child;
 		    if ( x != NULL )
 		    {
-			    childList = new FibonacciNode<T>*[z->degree];
-			    next = x;
-			    for ( int i = 0; i < (int)z->degree; i++ )
-			    {
-				    childList[i] = next;
-				    next = next->right;
-			    }
-			    for ( int i = 0; i < (int)z->degree; i++ )
+			    // 3
+			    w = x;
+			    do
 			    {
-				    x = childList[i];
 				    // 4
-				    H->min->left->right = x;
-				    x->left = H->min->left;
-				    H->min->left = x;
-				    x->right = H->min;
-				    // 5
-				    x->p = NULL;
-			    }
-			    delete [] childList;
+				    w->p = NULL;
+				    w = w->right;
+			    } while ( w != x );
+			    // 5
+			    last = x->left;
+			    z->left->right = x;
+			    x->left = z->left;
+			    last->right = z;
+			    z->left = last;
+			    z->child = NULL;
 		    }
 		    // 6
 		    z->left->right = z->right;
@@ -228,128 +320,194 @@ protected:
 	    return z;
     }
 
+    /* *node = ExtractList(H,k)
+     * removes the k minimum nodes of H, or all of them if H.n < k, and
+     * returns them in order as a list linked through right and ended by NULL.
+     * the nodes still to be considered form a frontier, kept as a binary heap
+     * in this heap's scratch vector: it starts as the root list, and every
+     * node taken from it adds its children. the nodes left in the frontier at
+     * the end are exactly the roots of what remains of H, so they are linked
+     * into a new root list and consolidated once, instead of once per node
+     */
+    FibonacciNode<T>* ExtractList( FibonacciHeap<T>* H, size_t k )
+    {
+	    FibonacciNode<T>* w, * x, * first, * last;
+	    size_t extracted;
+
+	    if ( H->min == NULL || k == 0 )
+	    {
+		    return NULL;
+	    }
+	    // the frontier's top is the node whose key comes first
+	    auto later = [this]( FibonacciNode<T>* a, FibonacciNode<T>* b )
+	    {
+		    return compare(b->key, a->key);
+	    };
+	    frontier.clear();
+	    w = H->min;
+	    do
+	    {
+		    frontier.push_back(w);
+		    w = w->right;
+	    } while ( w != H->min );
+	    std::make_heap(frontier.begin(), frontier.end(), later);
+
+	    first = last = NULL;
+	    for ( extracted = 0; extracted < k && !frontier.empty(); extracted++ )
+	    {
+		    std::pop_heap(frontier.begin(), frontier.end(), later);
+		    x = frontier.back();
+		    frontier.pop_back();
+		    w = x->child;
+		    if ( w != NULL )
+		    {
+			    do
+			    {
+				    frontier.push_back(w);
+				    std::push_heap(frontier.begin(), frontier.end(), later);
+				    w = w->right;
+			    } while ( w != x->child );
+		    }
+		    // the siblings of x are already in the frontier, so its right
+		    // pointer is free to link the list of extracted nodes
+		    x->right = NULL;
+		    if ( first == NULL )
+		    {
+			    first = x;
+		    }
+		    else
+		    {
+			    last->right = x;
+		    }
+		    last = x;
+	    }
+
+	    H->min = NULL;
+	    for ( size_t i = 0; i < frontier.size(); i++ )
+	    {
+		    x = frontier[i];
+		    x->p = NULL;
+		    if ( H->min == NULL )
+		    {
+			    H->min = x->left = x->right = x;
+		    }
+		    else
+		    {
+			    x->right = H->min->right;
+			    x->left = H->min;
+			    H->min->right->left = x;
+			    H->min->right = x;
+		    }
+	    }
+	    H->n -= extracted;
+	    INSTRUMENT_COUNT(HEAP_EXTRACTS, extracted);
+	    if ( H->min != NULL )
+	    {
+		    Consolidate(H);
+	    }
+	    return first;
+    }
+
     /* Consolidate(H)
-     * 1. let A[0 . . D(H.n)] be a new array
-     * 2. for i = 0 to D(H.n)
-     * 3. 	A[i] = NULL
-     * 4. for each node w in the root list of H
+     * 1. let A[0 . . D(H.n)] be the (empty) table H.A
+     * 2. r = the number of nodes in the root list of H
+     * 3. w = H.min
+     * 4. repeat r times
      * 5. 	x = w
-     * 6. 	d = x.degree
-     * 7. 	while A[d] != NULL
-     * 8. 		y = A[d]
-     * 9. 		if x.key > y.key
-     *10.			exchange x with y
-     *11. 		FIB-HEAP-LINK(H,y,x)
-     *12. 		A[d] = NULL
-     *13. 		d = d + 1
-     *14. 	A[d] = x
-     *15. H.min = NULL
-     *16. for i = 0 to D(H.n)
-     *17. 	if A[i] != NULL
-     *18. 		if H.min == NULL
-     *19. 			create a root list for H containing just A[i]
+     * 6. 	w = w.right
+     * 7. 	d = x.degree
+     * 8. 	while A[d] != NULL
+     * 9. 		y = A[d]
+     *10. 		if x.key > y.key
+     *11.			exchange x with y
+     *12. 		FIB-HEAP-LINK(H,y,x)
+     *13. 		A[d] = NULL
+     *14. 		d = d + 1
+     *15. 	A[d] = x
+     *16. H.min = NULL
+     *17. for i = 0 to D(H.n)
+     *18. 	if A[i] != NULL
+     *19. 		if H.min == NULL or A[i].key < H.min.key
      *20. 			H.min = A[i]
-     *21. 		else insert A[i] into H's root list
-     *22. 			if A[i].key < H.min.key
-     *23. 				H.min = A[i]
+     *21. 		A[i] = NULL
+     *
+     * linking only ever removes roots that have already been visited, so the
+     * next root can be read before x is linked and no copy of the root list
+     * is needed. the roots left afterwards are exactly the entries of A, which
+     * are already a root list, so only the minimum has to be found
      */
     void Consolidate( FibonacciHeap<T>* H )
     {
-	    FibonacciNode<T>* w, * next, * x, * y, * temp;
-	    FibonacciNode<T>** A, ** rootList;
-	    // Max degree <= log base golden ratio of n
-	    unsigned int d, rootSize;
-	    int max_degree = static_cast<int>(
-            floor( log(static_cast<double>(H->n)) / 
-                   log((1 + sqrt(static_cast<double>(5)))/2)
-            )
-        );
+	    FibonacciNode<T>* w, * x, * y, * temp;
+	    FibonacciNode<T>** A;
+	    unsigned int d, rootSize, top;
 	
+	    INSTRUMENT_COUNT(CONSOLIDATE_PASSES, 1);
 	    // 1
-	    A = new FibonacciNode<T>*[max_degree+2]; // plus two both for indexing to max degree and also A[max_degree+1] == NULL
+	    A = H->A;
+	    top = 0;
 	    // 2
-	    for ( int i = 0; i < max_degree+2; i++ )
-	    {
-		    // 3
-		    A[i] = NULL;
-	    }
-	    // 4
 	    w = H->min;
 	    rootSize = 0;
-	    next = w;
 	    do
 	    {
 		    rootSize++;
-		    next = next->right;
-	    } while ( next != w );
-	    rootList = new FibonacciNode<T>*[rootSize];
-	    for ( int i = 0; i < static_cast<int>(rootSize); i++ )
+		    w = w->right;
+	    } while ( w != H->min );
+	    // 3, 4
+	    for ( unsigned int i = 0; i < rootSize; i++ )
 	    {
-		    rootList[i] = next;
-		    next = next->right;
-	    }
-	    for ( int i = 0; i < static_cast<int>(rootSize); i++ )
-	    {
-		    w = rootList[i];
 		    // 5
 		    x = w;
 		    // 6
-		    d = x->degree;
+		    w = w->right;
 		    // 7
+		    d = x->degree;
+		    // 8
 		    while ( A[d] != NULL )
 		    {
-			    // 8
-			    y = A[d];
 			    // 9
-			    if ( x->key > y->key )
+			    y = A[d];
+			    // 10
+			    if ( compare(y->key, x->key) )
 			    {
-				    // 10
+				    // 11
 				    temp = x;
 				    x = y;
 				    y = temp;
 			    }
-			    // 11
-			    FibHeapLink(H,y,x);
 			    // 12
-			    A[d] = NULL;
+			    FibHeapLink(H,y,x);
 			    // 13
+			    A[d] = NULL;
+			    // 14
 			    d++;
 		    }
-		    // 14
+		    // 15
 		    A[d] = x;
+		    if ( d > top )
+		    {
+			    top = d;
+		    }
 	    }
-	    delete [] rootList;
-	    // 15
-	    H->min = NULL;
 	    // 16
-	    for ( int i = 0; i < max_degree+2; i++ )
+	    H->min = NULL;
+	    // 17
+	    for ( unsigned int i = 0; i <= top; i++ )
 	    {
-		    // 17
+		    // 18
 		    if ( A[i] != NULL )
 		    {
-			    // 18
-			    if ( H->min == NULL )
-			    {
-				    // 19, 20
-				    H->min = A[i]->left = A[i]->right = A[i];
-			    }
-			    else
+			    // 19
+			    if ( H->min == NULL || compare(A[i]->key, H->min->key) )
 			    {
-				    // 21
-				    H->min->left->right = A[i];
-				    A[i]->left = H->min->left;
-				    H->min->left = A[i];
-				    A[i]->right = H->min;
-				    // 22
-				    if ( A[i]->key < H->min->key )
-				    {
-					    // 23
-					    H->min = A[i];
-				    }
+				    // 20
+				    H->min = A[i];
 			    }
+			    // 21
+			    A[i] = NULL;
 		    }
 	    }
-	    delete [] A;
     }
 
     /* FibHeapLink(H,y,x)
@@ -359,6 +517,7 @@ protected:
      */
     void FibHeapLink( FibonacciHeap<T>* H, FibonacciNode<T>* y, FibonacciNode<T>* x )
     {
+	    INSTRUMENT_COUNT(LINKS, 1);
 	    // 1
 	    y->left->right = y->right;
 	    y->right->left = y->left;
@@ -393,23 +552,22 @@ protected:
      * 8. if x.key < H.min.key
      * 9. 	H.min = x
      */
-    void DecreaseKey( FibonacciHeap<T>* H, FibonacciNode<T>* x, T k )
+    void DecreaseKey( FibonacciHeap<T>* H, FibonacciNode<T>* x, const T &k )
     {
 	    FibonacciNode<T>* y;
 	
 	    // 1
-	    if ( x->key < k )
+	    if ( compare(x->key, k) )
 	    {
 		    // 2
-		    // error( "new key is greater than current key" );
-		    return;
+		    throw KeyIncrease();
 	    }
 	    // 3
 	    x->key = k;
 	    // 4
 	    y = x->p;
 	    // 5
-	    if ( y != NULL && x->key < y->key )
+	    if ( y != NULL && compare(x->key, y->key) )
 	    {
 		    // 6
 		    Cut(H,x,y);
@@ -417,7 +575,7 @@ protected:
 		    CascadingCut(H,y);
 	    }
 	    // 8
-	    if ( x->key < H->min->key )
+	    if ( compare(x->key, H->min->key) )
 	    {
 		    // 9
 		    H->min = x;
@@ -432,6 +590,7 @@ protected:
      */
     void Cut( FibonacciHeap<T>* H, FibonacciNode<T>* x, FibonacciNode<T>* y )
     {
+	    INSTRUMENT_COUNT(CUTS, 1);
 	    // 1
 	    if ( x->right == x )
 	    {
@@ -492,51 +651,506 @@ protected:
     }
 
     /* Delete(H,x)
-     * undefined behaviour for non-numeric types
+     * 1. y = x.p
+     * 2. if y != NULL
+     * 3. 	CUT(H,x,y)
+     * 4. 	CASCADING-CUT(H,y)
+     * 5. H.min = x
+     * 6. EXTRACT-MIN(H)
+     *
+     * the textbook decreases x.key to minus infinity first. moving x to the
+     * root list and naming it the minimum has the same effect on the
+     * structure without needing such a key, and EXTRACT-MIN recomputes the
+     * real minimum while consolidating
      */
     void Delete( FibonacciHeap<T>* H, FibonacciNode<T>* x )
     {
-	    DecreaseKey(H,x,numeric_limits<T>::lowest());
-	    delete ExtractMin(H);
+	    FibonacciNode<T>* y;
+
+	    // 1
+	    y = x->p;
+	    // 2
+	    if ( y != NULL )
+	    {
+		    // 3
+		    Cut(H,x,y);
+		    // 4
+		    CascadingCut(H,y);
+	    }
+	    // 5
+	    H->min = x;
+	    // 6
+	    pool.destroy(ExtractMin(H));
+    }
+
+    /* DestroyAll(H,release)
+     * runs the destructor of every node in H's forest, splicing each child
+     * list into the root list as it is reached so no recursion or scratch
+     * memory is needed. the memory itself is left to the pool, unless
+     * release is set and each node is handed back to it
+     */
+    void DestroyAll( FibonacciHeap<T>* H, bool release = false )
+    {
+	    FibonacciNode<T>* w, * next, * x;
+
+	    if ( H->min == NULL )
+	    {
+		    return;
+	    }
+	    w = H->min;
+	    do
+	    {
+		    x = w->child;
+		    if ( x != NULL )
+		    {
+			    next = w->right;
+			    w->right = x;
+			    x->left->right = next;
+			    next->left = x->left;
+			    x->left = w;
+			    w->child = NULL;
+		    }
+		    w = w->right;
+	    } while ( w != H->min );
+	    do
+	    {
+		    next = w->right;
+		    if ( release )
+		    {
+			    pool.destroy(w);
+		    }
+		    else
+		    {
+			    w->~FibonacciNode<T>();
+		    }
+		    w = next;
+	    } while ( w != H->min );
+	    H->min = NULL;
+	    H->n = 0;
+    }
+
+    /* *node = CopyForest(H)
+     * copies every node of H's forest into nodes from this heap's pool and
+     * returns the copy of H.min. the forest is walked in preorder through the
+     * child, right and parent pointers, so no recursion or scratch memory is
+     * needed; each copy is appended to the ring of its parent's copy, which
+     * keeps the sibling order, degrees and marks of H. if a key cannot be
+     * copied, the nodes copied so far are destroyed before rethrowing
+     */
+    FibonacciNode<T>* CopyForest( const FibonacciHeap<T>* H )
+    {
+	    FibonacciNode<T>* x, * copy, * head, * parent, * first;
+	    FibonacciHeap<T> partial;
+
+	    if ( H->min == NULL )
+	    {
+		    return NULL;
+	    }
+	    pool.reserve(H->n);
+	    x = H->min;
+	    parent = first = NULL;
+	    try
+	    {
+		    for ( ;; )
+		    {
+			    copy = pool.create(x->key, x->value);
+			    copy->mark = x->mark;
+			    copy->degree = x->degree;
+			    copy->p = parent;
+			    copy->child = NULL;
+			    // the first node of each ring becomes the head of its copy
+			    head = parent ? parent->child : first;
+			    if ( head == NULL )
+			    {
+				    copy->left = copy->right = copy;
+				    if ( parent )
+				    {
+					    parent->child = copy;
+				    }
+				    else
+				    {
+					    first = copy;
+				    }
+			    }
+			    else
+			    {
+				    copy->right = head;
+				    copy->left = head->left;
+				    head->left->right = copy;
+				    head->left = copy;
+			    }
+			    if ( x->child != NULL )
+			    {
+				    parent = copy;
+				    x = x->child;
+				    continue;
+			    }
+			    // climb until a node has a sibling left to copy
+			    while ( x->right == ( x->p ? x->p->child : H->min ) )
+			    {
+				    if ( x->p == NULL )
+				    {
+					    return first;
+				    }
+				    x = x->p;
+				    parent = parent->p;
+			    }
+			    x = x->right;
+		    }
+	    }
+	    catch ( ... )
+	    {
+		    partial.min = first;
+		    DestroyAll(&partial);
+		    throw;
+	    }
+    }
+
+    /* SaveForest(H,file)
+     * writes every node of H's forest to file in the preorder of CopyForest,
+     * starting at H.min: its key, its payload unless that is empty, and a
+     * word holding its degree and mark. the degrees give the shape of every
+     * tree, so no pointers are written. nodes go out through a buffer of
+     * SNAPSHOT_BLOCK records. returns whether every write succeeded
+     */
+    bool SaveForest( const FibonacciHeap<T>* H, std::FILE* file )
+    {
+	    const size_t value_size = std::is_empty<value_type>::value ? 0 : sizeof(value_type);
+	    const size_t size = sizeof(T) + value_size + sizeof(std::uint32_t);
+	    std::vector<char> buffer(size * SNAPSHOT_BLOCK);
+	    size_t used = 0;
+	    std::uint32_t word;
+	    const FibonacciNode<T>* x;
+
+	    if ( H->min == NULL )
+	    {
+		    return true;
+	    }
+	    x = H->min;
+	    for ( ;; )
+	    {
+		    char* record = buffer.data() + used * size;
+		    word = x->degree << 1 | ( x->mark ? 1 : 0 );
+		    std::memcpy(record, &x->key, sizeof(T));
+		    std::memcpy(record + sizeof(T), &x->value, value_size);
+		    std::memcpy(record + sizeof(T) + value_size, &word, sizeof(word));
+		    if ( ++used == SNAPSHOT_BLOCK )
+		    {
+			    if ( std::fwrite(buffer.data(), size, used, file) != used )
+			    {
+				    return false;
+			    }
+			    used = 0;
+		    }
+		    if ( x->child != NULL )
+		    {
+			    x = x->child;
+			    continue;
+		    }
+		    while ( x->right == ( x->p ? x->p->child : H->min ) )
+		    {
+			    if ( x->p == NULL )
+			    {
+				    return std::fwrite(buffer.data(), size, used, file) == used;
+			    }
+			    x = x->p;
+		    }
+		    x = x->right;
+	    }
+    }
+
+    /* valid = ChildrenValid(x)
+     * checks the invariant behind the degree bound at the children of x:
+     * ordered by degree, the i-th child (from 1) has degree at least i - 1,
+     * or i - 2 once it is marked. a child gets degree i - 1 when it is
+     * linked and loses at most one child before it is cut, so every heap
+     * built by the operations above satisfies it, and with it every node of
+     * degree d has at least F(d+2) descendants. a forest read from a file is
+     * checked node by node, as a degree beyond log base golden ratio of n
+     * would overrun CONSOLIDATE's array A. each child counts at the smallest
+     * position it may hold, degree + 1 or degree + 2, and no more than k - 1
+     * children may be limited to positions below k
+     */
+    bool ChildrenValid( const FibonacciNode<T>* x )
+    {
+	    unsigned int below[64] = { 0 };
+	    const FibonacciNode<T>* y;
+	    unsigned int limit, sum;
+
+	    y = x->child;
+	    do
+	    {
+		    limit = y->degree + ( y->mark ? 2 : 1 );
+		    if ( limit < x->degree )
+		    {
+			    below[limit]++;
+		    }
+		    y = y->right;
+	    } while ( y != x->child );
+	    sum = 0;
+	    for ( unsigned int k = 1; k < x->degree; k++ )
+	    {
+		    sum += below[k];
+		    if ( sum > k )
+		    {
+			    return false;
+		    }
+	    }
+	    return true;
+    }
+
+    /* *node = RestoreForest(file,n,roots,handles)
+     * reads n nodes written by SaveForest into nodes from one block of the
+     * pool and returns the first root, which was H.min. a stack holds the
+     * nodes whose children are still being read and how many each is
+     * missing; every node is appended to the ring of the node on top, or to
+     * the root list when the stack is empty, which restores the sibling
+     * order of the saved forest. the handle of each node is written to
+     * handles in that order, and the pool grows by one block of nodes for
+     * each block of records read. a short read, a child coming before its
+     * parent, a root coming before the first one, children that break
+     * ChildrenValid, or degrees that do not add up to roots trees of n
+     * nodes throw SnapshotError once the nodes read so far are destroyed
+     */
+    template <class OutputIterator>
+    FibonacciNode<T>* RestoreForest( std::FILE* file, size_t n, size_t roots,
+                                     OutputIterator &handles )
+    {
+	    const size_t value_size = std::is_empty<value_type>::value ? 0 : sizeof(value_type);
+	    const size_t size = sizeof(T) + value_size + sizeof(std::uint32_t);
+	    std::vector<char> buffer(size * std::min<size_t>(n, SNAPSHOT_BLOCK));
+	    std::vector<std::pair<FibonacciNode<T>*, unsigned int> > parents;
+	    FibonacciNode<T>* x, * head, * parent, * first;
+	    FibonacciHeap<T> partial;
+	    const char* record = NULL;
+	    size_t left = 0, seen = 0;
+	    std::uint32_t word;
+
+	    first = NULL;
+	    try
+	    {
+		    for ( size_t i = 0; i < n; i++ )
+		    {
+			    if ( left == 0 )
+			    {
+				    left = std::min<size_t>(n - i, SNAPSHOT_BLOCK);
+				    if ( std::fread(buffer.data(), size, left, file) != left )
+				    {
+					    throw SnapshotError();
+				    }
+				    pool.reserve(left);
+				    record = buffer.data();
+			    }
+			    x = pool.create();
+			    std::memcpy(&x->key, record, sizeof(T));
+			    std::memcpy(&x->value, record + sizeof(T), value_size);
+			    std::memcpy(&word, record + sizeof(T) + value_size, sizeof(word));
+			    record += size;
+			    left--;
+			    x->degree = word >> 1;
+			    x->mark = ( word & 1 ) != 0;
+			    // no degree of 64 or more fits A, nor passes ChildrenValid
+			    if ( x->degree >= 64 )
+			    {
+				    pool.destroy(x);
+				    throw SnapshotError();
+			    }
+			    parent = parents.empty() ? NULL : parents.back().first;
+			    x->p = parent;
+			    head = parent ? parent->child : first;
+			    if ( head == NULL )
+			    {
+				    x->left = x->right = x;
+				    if ( parent )
+				    {
+					    parent->child = x;
+				    }
+				    else
+				    {
+					    first = x;
+				    }
+			    }
+			    else
+			    {
+				    x->right = head;
+				    x->left = head->left;
+				    head->left->right = x;
+				    head->left = x;
+			    }
+			    if ( parent )
+			    {
+				    if ( compare(x->key, parent->key) )
+				    {
+					    throw SnapshotError();
+				    }
+				    if ( --parents.back().second == 0 )
+				    {
+					    parents.pop_back();
+					    if ( !ChildrenValid(parent) )
+					    {
+						    throw SnapshotError();
+					    }
+				    }
+			    }
+			    else if ( ++seen > roots || compare(x->key, first->key) )
+			    {
+				    throw SnapshotError();
+			    }
+			    if ( x->degree > 0 )
+			    {
+				    parents.push_back(std::make_pair(x, x->degree));
+			    }
+			    *handles = handle(x);
+			    ++handles;
+		    }
+		    if ( !parents.empty() || seen != roots )
+		    {
+			    throw SnapshotError();
+		    }
+	    }
+	    catch ( ... )
+	    {
+		    partial.min = first;
+		    DestroyAll(&partial, true);
+		    throw;
+	    }
+	    return first;
     }
 
 private:
     // VARIABLES
+    Compare compare;
+    NodePool<FibonacciNode<T>, Allocator> pool;
     std::deque<FibonacciNode<T>*> nodes;
     FibonacciHeap<T>* heap;
+    // scratch space of ExtractList, kept to avoid allocating on every call
+    std::vector<FibonacciNode<T>*> frontier;
+
+    // the first word of a saved heap, "FibHeap1" in little-endian order, and
+    // the number of nodes save and restore pass to the file at once
+    static const std::uint64_t SNAPSHOT_MAGIC = 0x3170616548626946ull;
+    static const size_t SNAPSHOT_BLOCK = 4096;
+
+    // makes room in the pool for the keys of a range when it can be measured
+    // without consuming it
+    template <class InputIterator>
+    void reserve(InputIterator, InputIterator, std::input_iterator_tag) {}
+
+    template <class ForwardIterator>
+    void reserve(ForwardIterator first, ForwardIterator last,
+                 std::forward_iterator_tag) {
+        pool.reserve(std::distance(first, last));
+    }
 
 public:
+    // EXCEPTIONS
+    // thrown by decrease_key when the new key comes after the old one
+    class KeyIncrease {
+    };
+
+    // thrown by save when the file cannot be written, and by restore when it
+    // cannot be read or does not hold a heap of this key and payload type
+    class SnapshotError {
+    };
+
+    // HANDLES
+    // identifies a node returned by insert for as long as it stays in the
+    // heap. nodes never move, so the handle survives every other operation,
+    // including merging into another heap
+    class handle {
+        friend class FibHeap;
+        FibonacciNode<T>* node;
+        explicit handle(FibonacciNode<T>* x) : node(x) {}
+    public:
+        handle() : node(NULL) {}
+        bool operator==(const handle &h) const { return node == h.node; }
+        bool operator!=(const handle &h) const { return node != h.node; }
+    };
+
     // CONSTRUCTORS
     FibHeap() : heap(MakeHeap()) {}
 
-    FibHeap(T* array, int size) : heap(MakeHeap()) {
-        FibonacciNode<T>* node;
-        for ( int i = 0; i < size; i++ ) {
-            node = new FibonacciNode<T>(array[i]);
-            Insert(heap,node);
+    explicit FibHeap(const Compare &cmp, const Allocator &alloc = Allocator()) :
+        compare(cmp), pool(alloc), heap(MakeHeap()) {}
+
+    FibHeap(T* array, int size) : FibHeap(array, array + size) {}
+
+    // builds a heap of the keys in [first, last) with insert_range
+    template <class InputIterator>
+    FibHeap(InputIterator first, InputIterator last,
+            const Compare &cmp = Compare(), const Allocator &alloc = Allocator()) :
+        compare(cmp), pool(alloc), heap(MakeHeap()) {
+        try {
+            insert_range(first, last);
+        }
+        catch ( ... ) {
+            delete heap;
+            throw;
         }
     }
 
-    FibHeap(FibHeap &H) : heap(MakeHeap()) {
-        FibonacciNode<T>* node;
-        while ( H.size() > 0 ) {
-            H.storeMin();
+    // copies the forest node for node in O(n), from one block of the pool,
+    // and the external nodes in order. H is left untouched
+    FibHeap(const FibHeap &H) : compare(H.compare), heap(MakeHeap()) {
+        try {
+            heap->min = CopyForest(H.heap);
+            heap->n = H.heap->n;
+            for ( size_t i = 0; i < H.nodes.size(); i++ ) {
+                nodes.push_back(pool.create(H.nodes[i]->key, H.nodes[i]->value));
+            }
         }
-        while ( H.en_count() > 0 ) {
-            node = new FibonacciNode<T>(H[0]);
-            Insert(heap,node);
-            H.en_insertFirst();
+        catch ( ... ) {
+            while ( !nodes.empty() ) {
+                pool.destroy(nodes.back());
+                nodes.pop_back();
+            }
+            DestroyAll(heap);
+            delete heap;
+            throw;
         }
     }
 
-    // DESTRUCTOR
-    FibHeap<T>::~FibHeap() {
-        while ( !nodes.empty() ) {
-            delete nodes.front();
-            nodes.pop_front();
+    // takes over the nodes of H, which is left empty. handles into H now
+    // refer to this heap
+    FibHeap(FibHeap &&H) : compare(H.compare), heap(MakeHeap()) {
+        swap(H);
+    }
+
+    FibHeap& operator=(const FibHeap &H) {
+        if ( this != &H ) {
+            FibHeap copy(H);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    // the old nodes of this heap are destroyed and H is left empty
+    FibHeap& operator=(FibHeap &&H) {
+        if ( this != &H ) {
+            FibHeap moved(std::move(H));
+            swap(moved);
         }
-        while ( heap->min && heap->n ) {
-            delete ExtractMin(heap);
+        return *this;
+    }
+
+    // exchanges the contents of two heaps in O(1). handles follow their nodes
+    void swap(FibHeap &H) {
+        std::swap(compare, H.compare);
+        pool.swap(H.pool);
+        nodes.swap(H.nodes);
+        std::swap(heap, H.heap);
+    }
+
+    // DESTRUCTOR
+    // the pool returns its chunks to the allocator in one pass; node
+    // destructors only need to run for keys that have one
+    ~FibHeap() {
+        if ( !std::is_trivially_destructible<FibonacciNode<T> >::value ) {
+            while ( !nodes.empty() ) {
+                pool.destroy(nodes.front());
+                nodes.pop_front();
+            }
+            DestroyAll(heap);
         }
         delete heap;
     }
@@ -545,13 +1159,13 @@ public:
     // returns min{# nodes in heap, INT_MAX}
     int size() { return static_cast<int>(heap->n) >= 0 ? 
                         static_cast<int>(heap->n) :
-                        numeric_limits<int>::max();
+                        std::numeric_limits<int>::max();
     }
 
     // returns min{# non-heap nodes, INT_MAX}
     int en_count() { return static_cast<int>(nodes.size()) >= 0 ?
                             static_cast<int>(nodes.size()) :
-                            numeric_limits<int>::max();
+                            std::numeric_limits<int>::max();
     }
 
     // NON-HEAP MANIPULATION
@@ -566,42 +1180,312 @@ public:
     }
 
     void en_removeFirst() {
-        delete nodes.front();
+        pool.destroy(nodes.front());
         nodes.pop_front();
     }
 
     void en_removeLast() {
-        delete nodes.back();
+        pool.destroy(nodes.back());
         nodes.pop_back();
     }
 
     // places a new node at the end of the queue
-    void store(T value) { nodes.push_back(new FibonacciNode<T>(value)); }
+    void store(const T &value) { nodes.push_back(pool.create(value)); }
 
     // places the minimum of the heap at the end of the queue
     void storeMin() { nodes.push_back(ExtractMin(heap)); }
 
     // HEAP FUNCTIONS
-    // places a new node in the heap
-    void insert(T value) {
-        Insert(heap, new FibonacciNode<T>(value));
+    // places a new node in the heap and returns its handle
+    handle insert(const T &key) {
+        return emplace(key);
+    }
+
+    handle insert(const T &key, const value_type &value) {
+        return emplace(key, value);
+    }
+
+    // constructs the key from k and the payload from args directly in a new
+    // node, without copying either
+    template <class K, class... Args>
+    handle emplace(K&& k, Args&&... args) {
+        FibonacciNode<T>* node = pool.create(std::forward<K>(k),
+                                             std::forward<Args>(args)...);
+        Insert(heap, node);
+        return handle(node);
+    }
+
+    // inserts every key of [first, last) in O(# keys). the new nodes are
+    // linked into one circular list while finding its minimum, and the list
+    // is spliced into the root list in a single step. for forward iterators
+    // all nodes come from one block of the pool
+    template <class InputIterator>
+    void insert_range(InputIterator first, InputIterator last) {
+        FibonacciNode<T>* head = NULL, * least = NULL, * node;
+        unsigned int k = 0;
+        reserve(first, last,
+                typename std::iterator_traits<InputIterator>::iterator_category());
+        try {
+            for ( ; first != last; ++first ) {
+                node = pool.create(*first);
+                k++;
+                if ( head == NULL ) {
+                    head = least = node->left = node->right = node;
+                }
+                else {
+                    node->right = head;
+                    node->left = head->left;
+                    head->left->right = node;
+                    head->left = node;
+                    if ( compare(node->key, least->key) ) {
+                        least = node;
+                    }
+                }
+            }
+        }
+        catch ( ... ) {
+            for ( ; k > 0; k-- ) {
+                node = head->right;
+                pool.destroy(head);
+                head = node;
+            }
+            throw;
+        }
+        if ( head != NULL ) {
+            InsertList(heap, least, k);
+        }
+    }
+
+    // insert_range split over up to threads threads: each one builds a heap
+    // from its share of the keys with its own pool, and the heaps are then
+    // merged into this one in O(threads + # chunks of their pools)
+    template <class RandomAccessIterator>
+    void insert_range_parallel(RandomAccessIterator first,
+                               RandomAccessIterator last, unsigned int threads) {
+        // below this many keys per thread, starting a thread costs more than
+        // it saves
+        const std::ptrdiff_t MIN_SHARE = 4096;
+        std::ptrdiff_t count = last - first;
+        if ( static_cast<std::ptrdiff_t>(threads) > count / MIN_SHARE ) {
+            threads = static_cast<unsigned int>(count / MIN_SHARE);
+        }
+        if ( threads <= 1 ) {
+            insert_range(first, last);
+            return;
+        }
+        std::vector<FibHeap> parts;
+        std::vector<std::exception_ptr> errors(threads);
+        std::vector<std::thread> workers;
+        parts.reserve(threads);
+        for ( unsigned int i = 0; i < threads; i++ ) {
+            parts.push_back(FibHeap(compare));
+        }
+        for ( unsigned int i = 0; i < threads; i++ ) {
+            RandomAccessIterator begin = first + count * i / threads;
+            RandomAccessIterator end = first + count * (i + 1) / threads;
+            FibHeap* part = &parts[i];
+            std::exception_ptr* error = &errors[i];
+            workers.push_back(std::thread([=]() {
+                try {
+                    part->insert_range(begin, end);
+                }
+                catch ( ... ) {
+                    *error = std::current_exception();
+                }
+            }));
+        }
+        for ( unsigned int i = 0; i < threads; i++ ) {
+            workers[i].join();
+        }
+        for ( unsigned int i = 0; i < threads; i++ ) {
+            if ( errors[i] ) {
+                std::rethrow_exception(errors[i]);
+            }
+        }
+        for ( unsigned int i = 0; i < threads; i++ ) {
+            merge(std::move(parts[i]));
+        }
+    }
+
+    bool empty() { return heap->n == 0; }
+
+    // the node holding the minimum, or a null handle when the heap is empty
+    handle top() { return handle(Minimum(heap)); }
+
+    // the key and payload of a node in the heap
+    const T& key(handle h) { return h.node->key; }
+    value_type& value(handle h) { return h.node->value; }
+
+    // moves a node's key towards the minimum in O(1) amortized time.
+    // throws KeyIncrease exception
+    void decrease_key(handle h, const T &key) {
+        DecreaseKey(heap, h.node, key);
+    }
+
+    // removes a node from the heap in O(log n) amortized time
+    void erase(handle h) {
+        Delete(heap, h.node);
+    }
+
+    // moves every node of other into this heap, leaving other empty, in O(#
+    // chunks of other's pool), which is O(1) amortized over its insertions.
+    // handles into other stay valid and now refer to this heap. the external
+    // nodes of other are appended to this heap's queue, which costs one step
+    // each unless this queue is empty
+    void merge(FibHeap &&other) {
+        if ( &other == this ) {
+            return;
+        }
+        if ( nodes.empty() ) {
+            nodes.swap(other.nodes);
+        }
+        else {
+            nodes.insert(nodes.end(), other.nodes.begin(), other.nodes.end());
+            other.nodes.clear();
+        }
+        pool.adopt(other.pool);
+        UnionInto(heap, other.heap);
     }
 
     // extracts the minimum value still in the heap
     T min() { 
         return heap->n ? 
                Minimum(heap)->key :
-               numeric_limits<T>::lowest();
+               std::numeric_limits<T>::lowest();
     }
 
     // extracts the minimum value and deletes the node that contained that
     // value
     T extractMin() {
         T value = Minimum(heap)->key;
-        delete ExtractMin(heap);
+        pool.destroy(ExtractMin(heap));
         return value;
     }
 
+    // extracts the minimum value and moves its payload into value
+    T extractMin(value_type &value) {
+        FibonacciNode<T>* node = ExtractMin(heap);
+        T key = std::move(node->key);
+        value = std::move(node->value);
+        pool.destroy(node);
+        return key;
+    }
+
+    // extracts the k minimum values, or every value if there are fewer, and
+    // writes them in ascending order to out. the forest is consolidated once
+    // for the whole batch. returns the number of values written
+    template <class OutputIterator>
+    size_t extract_k(size_t k, OutputIterator out) {
+        FibonacciNode<T>* x = ExtractList(heap, k), * next;
+        size_t written = 0;
+        try {
+            for ( ; x != NULL; x = next, written++ ) {
+                next = x->right;
+                *out = std::move(x->key);
+                ++out;
+                pool.destroy(x);
+            }
+        }
+        catch ( ... ) {
+            for ( ; x != NULL; x = next ) {
+                next = x->right;
+                pool.destroy(x);
+            }
+            throw;
+        }
+        return written;
+    }
+
+    // as above, also moving the payload of each value to values
+    template <class KeyOutputIterator, class ValueOutputIterator>
+    size_t extract_k(size_t k, KeyOutputIterator keys,
+                     ValueOutputIterator values) {
+        FibonacciNode<T>* x = ExtractList(heap, k), * next;
+        size_t written = 0;
+        try {
+            for ( ; x != NULL; x = next, written++ ) {
+                next = x->right;
+                *keys = std::move(x->key);
+                ++keys;
+                *values = std::move(x->value);
+                ++values;
+                pool.destroy(x);
+            }
+        }
+        catch ( ... ) {
+            for ( ; x != NULL; x = next ) {
+                next = x->right;
+                pool.destroy(x);
+            }
+            throw;
+        }
+        return written;
+    }
+
+    // SNAPSHOTS
+    // writes the heap to file at its current position in O(n), as a header
+    // and one record per node in the byte order of this machine. the
+    // external nodes are not part of it. throws SnapshotError
+    void save(std::FILE* file) {
+        static_assert(std::is_trivially_copyable<T>::value &&
+                      std::is_trivially_copyable<value_type>::value,
+                      "keys and payloads must be trivially copyable");
+        std::uint64_t roots = 0;
+        FibonacciNode<T>* x = heap->min;
+        if ( x != NULL ) {
+            do {
+                roots++;
+                x = x->right;
+            } while ( x != heap->min );
+        }
+        std::uint64_t header[5] = {
+            SNAPSHOT_MAGIC, sizeof(T),
+            std::is_empty<value_type>::value ? 0 : sizeof(value_type),
+            heap->n, roots
+        };
+        if ( std::fwrite(header, sizeof(header), 1, file) != 1 ||
+             !SaveForest(heap, file) ) {
+            throw SnapshotError();
+        }
+    }
+
+    // adds a heap written by save to this one in O(n), with the shape and
+    // marks it was saved with, and writes the handle of every restored node
+    // to handles. throws SnapshotError, leaving this heap as it was
+    template <class OutputIterator>
+    void restore(std::FILE* file, OutputIterator handles) {
+        static_assert(std::is_trivially_copyable<T>::value &&
+                      std::is_trivially_copyable<value_type>::value,
+                      "keys and payloads must be trivially copyable");
+        std::uint64_t header[5];
+        if ( std::fread(header, sizeof(header), 1, file) != 1 ||
+             header[0] != SNAPSHOT_MAGIC || header[1] != sizeof(T) ||
+             header[2] != (std::is_empty<value_type>::value ? 0 : sizeof(value_type)) ||
+             header[3] > std::numeric_limits<unsigned int>::max() - heap->n ||
+             header[4] > header[3] || (header[3] != 0 && header[4] == 0) ) {
+            throw SnapshotError();
+        }
+        FibonacciHeap<T>* restored = MakeHeap();
+        try {
+            restored->min = RestoreForest(file, header[3], header[4], handles);
+        }
+        catch ( ... ) {
+            delete restored;
+            throw;
+        }
+        restored->n = static_cast<unsigned int>(header[3]);
+        heap = Union(heap, restored);
+    }
+
+    void restore(std::FILE* file) {
+        struct Discard {
+            Discard& operator*() { return *this; }
+            Discard& operator++() { return *this; }
+            Discard& operator=(const handle&) { return *this; }
+        };
+        restore(file, Discard());
+    }
+
     // OVERLOADED OPERATORS
     // provides a reference to key of the external node at position index ( mod
     // nodes.size() )
@@ -613,5 +1497,10 @@ public:
 
 };
 
+template <class T, class Value, class Compare, class Allocator>
+const std::uint64_t FibHeap<T, Value, Compare, Allocator>::SNAPSHOT_MAGIC;
+
+template <class T, class Value, class Compare, class Allocator>
+const size_t FibHeap<T, Value, Compare, Allocator>::SNAPSHOT_BLOCK;
 
 #endif
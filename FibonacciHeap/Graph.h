@@ -0,0 +1,378 @@
+#ifndef GRAPH_H_
+#define GRAPH_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+#include "FibHeap.h"
+
+/* Graph
+ ******************************************************************************
+ *
+ * a directed graph with weighted arcs in compressed sparse row form: the
+ * arcs leaving vertex v are arcs()[offset[v]] to arcs()[offset[v+1]], so a
+ * search scans them as one contiguous array. vertices are numbered from 0.
+ * an undirected graph is built by giving every edge in both directions.
+ *
+ * load_dimacs reads the shortest path format of the DIMACS challenge: a
+ * "p sp n m" line, then one "a u v w" line per arc, with vertices numbered
+ * from 1; lines starting with "c" are comments. it throws FormatError,
+ * naming the file and the line, when the file cannot be read or a line
+ * cannot be parsed, and for a negative weight, which ShortestPaths and
+ * prim do not handle.
+ *
+ * Operations:
+ *
+ * -    Graph(n, edges, undirected):
+ *          O(n + m), from a list of (from, to, weight) edges
+ *
+ * -    begin(v), end(v), degree(v):
+ *          O(1)
+ *
+ */
+
+template <class Weight = double>
+class Graph {
+
+public:
+    typedef std::uint32_t vertex_type;
+    typedef Weight weight_type;
+
+    static const vertex_type NONE = 0xffffffffu;
+
+    struct Edge {
+        vertex_type from;
+        vertex_type to;
+        Weight weight;
+    };
+
+    struct Arc {
+        vertex_type to;
+        Weight weight;
+    };
+
+    // EXCEPTIONS
+    // thrown by load_dimacs; line is 0 when the file cannot be opened
+    class FormatError {
+    public:
+        std::string path;
+        size_t line;
+        FormatError(const std::string &p, size_t l) : path(p), line(l) {}
+    };
+
+private:
+    // VARIABLES
+    std::vector<size_t> offset;
+    std::vector<Arc> arc;
+
+public:
+    // CONSTRUCTORS
+    Graph() : offset(1, 0) {}
+
+    // the graph of n vertices with the given edges, each also in reverse
+    // when undirected
+    Graph(vertex_type n, const std::vector<Edge> &edges, bool undirected = false) :
+        offset(static_cast<size_t>(n) + 1, 0),
+        arc(edges.size() * (undirected ? 2 : 1)) {
+        // counts the arcs leaving each vertex, then places them in order
+        for ( size_t i = 0; i < edges.size(); i++ ) {
+            offset[edges[i].from + 1]++;
+            if ( undirected ) {
+                offset[edges[i].to + 1]++;
+            }
+        }
+        for ( size_t v = 0; v < n; v++ ) {
+            offset[v + 1] += offset[v];
+        }
+        std::vector<size_t> next(offset.begin(), offset.end() - 1);
+        for ( size_t i = 0; i < edges.size(); i++ ) {
+            Arc forward = { edges[i].to, edges[i].weight };
+            arc[next[edges[i].from]++] = forward;
+            if ( undirected ) {
+                Arc backward = { edges[i].from, edges[i].weight };
+                arc[next[edges[i].to]++] = backward;
+            }
+        }
+    }
+
+    // FUNCTIONS
+    vertex_type vertices() const {
+        return static_cast<vertex_type>(offset.size() - 1);
+    }
+
+    size_t arcs() const { return arc.size(); }
+
+    const Arc* begin(vertex_type v) const { return arc.data() + offset[v]; }
+    const Arc* end(vertex_type v) const { return arc.data() + offset[v + 1]; }
+
+    size_t degree(vertex_type v) const { return offset[v + 1] - offset[v]; }
+
+    // reads a graph in the DIMACS shortest path format
+    static Graph load_dimacs(const std::string &path) {
+        std::FILE* file = std::fopen(path.c_str(), "r");
+        if ( file == NULL ) {
+            throw FormatError(path, 0);
+        }
+        std::vector<Edge> edges;
+        vertex_type n = 0;
+        bool header = false;
+        size_t line = 0;
+        char text[256];
+        while ( std::fgets(text, sizeof(text), file) != NULL ) {
+            line++;
+            char* p = text;
+            char* q;
+            bool complete = std::strchr(text, '\n') != NULL || std::feof(file);
+            if ( text[0] == 'c' || text[0] == '\n' || text[0] == '\r' ) {
+                // skips the rest of a long comment
+                int c = 0;
+                while ( !complete && (c = std::fgetc(file)) != '\n' && c != EOF ) {}
+                continue;
+            }
+            bool valid = false;
+            if ( text[0] == 'p' && !header ) {
+                p = text + 1;
+                while ( *p == ' ' || *p == '\t' ) {
+                    p++;
+                }
+                if ( p[0] == 's' && p[1] == 'p' ) {
+                    unsigned long long vertices = std::strtoull(p + 2, &q, 10);
+                    unsigned long long arcs = std::strtoull(q, &p, 10);
+                    valid = p != q && vertices < NONE;
+                    // the count is only a hint: a file may claim more arcs
+                    // than it holds
+                    edges.reserve(valid ? std::min(arcs, 1ull << 20) : 0);
+                    n = static_cast<vertex_type>(vertices);
+                    header = true;
+                }
+            }
+            else if ( text[0] == 'a' && header ) {
+                unsigned long long from = std::strtoull(text + 1, &q, 10);
+                unsigned long long to = std::strtoull(q, &p, 10);
+                double weight = std::strtod(p, &q);
+                valid = q != p && from >= 1 && from <= n && to >= 1 && to <= n &&
+                        weight >= 0;
+                Edge edge = { static_cast<vertex_type>(from - 1),
+                              static_cast<vertex_type>(to - 1),
+                              static_cast<Weight>(weight) };
+                edges.push_back(edge);
+            }
+            if ( !valid || !complete ) {
+                std::fclose(file);
+                throw FormatError(path, line);
+            }
+        }
+        bool failed = std::ferror(file) != 0;
+        std::fclose(file);
+        if ( failed ) {
+            throw FormatError(path, line);
+        }
+        return Graph(n, edges);
+    }
+};
+
+template <class Weight>
+const typename Graph<Weight>::vertex_type Graph<Weight>::NONE;
+
+/* ShortestPaths
+ ******************************************************************************
+ *
+ * Dijkstra's algorithm over a Graph with non-negative weights, on a heap of
+ * the vertices found so far keyed by tentative distance. every vertex enters
+ * the heap once and is moved forward with decrease_key when a shorter path
+ * to it is found, so the heap never holds more than the vertex count and a
+ * search costs O(m + n log n) on a FibHeap. Heap may be any engine in this
+ * directory with key type Weight and value type vertex_type, e.g. a DaryHeap,
+ * or a RadixHeap for integer weights.
+ *
+ * a search starts from one source or from several, all at distance 0, and
+ * stops early once a given target is settled. the arrays are kept between
+ * searches, and only the vertices the last search touched are reset, so
+ * many short searches on a large graph cost what they visit.
+ *
+ * Operations:
+ *
+ * -    run(source, target), run_sources(first, last, target):
+ *          a search from source, or from every vertex of [first, last),
+ *          stopping when target is settled
+ *
+ * -    settled(v), distance(v), parent(v), path(v):
+ *          whether the distance of v is final, that distance, the vertex
+ *          before v on a shortest path, and the path from a source to v
+ *
+ */
+
+template <class Weight = double,
+          class Heap = FibHeap<Weight, typename Graph<Weight>::vertex_type> >
+class ShortestPaths {
+
+public:
+    typedef typename Graph<Weight>::vertex_type vertex_type;
+
+private:
+    enum State {
+        UNSEEN,
+        QUEUED,
+        SETTLED
+    };
+
+    // VARIABLES
+    const Graph<Weight>* graph;
+    std::vector<Weight> dist;
+    std::vector<vertex_type> prev;
+    std::vector<char> state;
+    std::vector<typename Heap::handle> node;
+    std::vector<vertex_type> touched;
+    size_t count;
+
+    // FUNCTIONS
+    void Reset() {
+        for ( size_t i = 0; i < touched.size(); i++ ) {
+            state[touched[i]] = UNSEEN;
+        }
+        touched.clear();
+        count = 0;
+    }
+
+    void Search(Heap &heap, vertex_type target) {
+        vertex_type u;
+        while ( !heap.empty() ) {
+            Weight d = heap.extractMin(u);
+            state[u] = SETTLED;
+            count++;
+            if ( u == target ) {
+                return;
+            }
+            for ( const typename Graph<Weight>::Arc* a = graph->begin(u);
+                  a != graph->end(u); ++a ) {
+                vertex_type v = a->to;
+                Weight w = d + a->weight;
+                if ( state[v] == UNSEEN ) {
+                    state[v] = QUEUED;
+                    touched.push_back(v);
+                    dist[v] = w;
+                    prev[v] = u;
+                    node[v] = heap.insert(w, v);
+                }
+                else if ( state[v] == QUEUED && w < dist[v] ) {
+                    dist[v] = w;
+                    prev[v] = u;
+                    heap.decrease_key(node[v], w);
+                }
+            }
+        }
+    }
+
+public:
+    // CONSTRUCTORS
+    // searches g, which must outlive this object
+    explicit ShortestPaths(const Graph<Weight> &g) :
+        graph(&g), dist(g.vertices()), prev(g.vertices()),
+        state(g.vertices(), UNSEEN), node(g.vertices()), count(0) {}
+
+    // FUNCTIONS
+    void run(vertex_type source, vertex_type target = Graph<Weight>::NONE) {
+        run_sources(&source, &source + 1, target);
+    }
+
+    template <class InputIterator>
+    void run_sources(InputIterator first, InputIterator last,
+                     vertex_type target = Graph<Weight>::NONE) {
+        Reset();
+        Heap heap;
+        for ( ; first != last; ++first ) {
+            vertex_type s = *first;
+            if ( state[s] == UNSEEN ) {
+                state[s] = QUEUED;
+                touched.push_back(s);
+                dist[s] = Weight();
+                prev[s] = Graph<Weight>::NONE;
+                node[s] = heap.insert(Weight(), s);
+            }
+        }
+        Search(heap, target);
+    }
+
+    bool settled(vertex_type v) const { return state[v] == SETTLED; }
+
+    // the number of vertices the last search settled
+    size_t settled() const { return count; }
+
+    Weight distance(vertex_type v) const { return dist[v]; }
+
+    vertex_type parent(vertex_type v) const { return prev[v]; }
+
+    // the vertices of a shortest path from a source to a settled vertex v
+    std::vector<vertex_type> path(vertex_type v) const {
+        std::vector<vertex_type> vertices;
+        for ( ; v != Graph<Weight>::NONE; v = prev[v] ) {
+            vertices.push_back(v);
+        }
+        return std::vector<vertex_type>(vertices.rbegin(), vertices.rend());
+    }
+};
+
+/* prim
+ ******************************************************************************
+ *
+ * Prim's algorithm for a minimum spanning forest of an undirected Graph,
+ * one given with every edge in both directions. each vertex is keyed in the
+ * heap by the lightest edge joining it to the tree grown so far, which
+ * decrease_key lowers as lighter edges are found: O(m + n log n) on a
+ * FibHeap. parent receives the other end of the edge that joins each vertex
+ * to its tree, or NONE for the first vertex of every tree; the total weight
+ * of the forest is returned.
+ *
+ */
+
+template <class Weight,
+          class Heap = FibHeap<Weight, typename Graph<Weight>::vertex_type> >
+Weight prim(const Graph<Weight> &g,
+            std::vector<typename Graph<Weight>::vertex_type> &parent) {
+    typedef typename Graph<Weight>::vertex_type vertex_type;
+    vertex_type n = g.vertices();
+    parent.assign(n, Graph<Weight>::NONE);
+    std::vector<Weight> best(n);
+    // 0 for vertices not yet seen, 1 in the heap, 2 in the tree
+    std::vector<char> state(n, 0);
+    std::vector<typename Heap::handle> node(n);
+    Weight total = Weight();
+    Heap heap;
+    for ( vertex_type root = 0; root < n; root++ ) {
+        if ( state[root] != 0 ) {
+            continue;
+        }
+        state[root] = 1;
+        node[root] = heap.insert(Weight(), root);
+        while ( !heap.empty() ) {
+            vertex_type u;
+            total += heap.extractMin(u);
+            state[u] = 2;
+            for ( const typename Graph<Weight>::Arc* a = g.begin(u);
+                  a != g.end(u); ++a ) {
+                vertex_type v = a->to;
+                if ( state[v] == 0 ) {
+                    state[v] = 1;
+                    best[v] = a->weight;
+                    parent[v] = u;
+                    node[v] = heap.insert(a->weight, v);
+                }
+                else if ( state[v] == 1 && a->weight < best[v] ) {
+                    best[v] = a->weight;
+                    parent[v] = u;
+                    heap.decrease_key(node[v], a->weight);
+                }
+            }
+        }
+    }
+    return total;
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef HEAPVALUE_H_
+#define HEAPVALUE_H_
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/* HeapValue
+ * maps the Value parameter of a heap to the type stored in its nodes. a heap
+ * declared without a payload (Value = void) stores an empty NoValue, which
+ * shares padding with the node's other small fields
+ */
+struct NoValue {
+};
+
+template <class Value>
+struct HeapValue {
+    typedef Value type;
+};
+
+template <>
+struct HeapValue<void> {
+    typedef NoValue type;
+};
+
+/* ReleaseValue(value), ReplaceValue(value, args...)
+ * for heaps that keep payloads in slots of a vector and reuse freed slots.
+ * ReleaseValue frees the resources of a payload when its slot is freed,
+ * leaving a moved-from value behind. ReplaceValue gives a reused slot its new
+ * payload: constructed in place over the old one when that cannot throw, and
+ * otherwise constructed aside and moved in, so that a throwing constructor
+ * still leaves a live value in the slot
+ */
+template <class V>
+void ReleaseValue(V &value) {
+    V discarded(std::move(value));
+    (void)discarded;
+}
+
+template <bool InPlace>
+struct ValueReplacer {
+    template <class V, class... Args>
+    static void replace(V &value, Args&&... args) {
+        value = V(std::forward<Args>(args)...);
+    }
+};
+
+template <>
+struct ValueReplacer<true> {
+    template <class V, class... Args>
+    static void replace(V &value, Args&&... args) {
+        value.~V();
+        ::new (static_cast<void*>(&value)) V(std::forward<Args>(args)...);
+    }
+};
+
+template <class V, class... Args>
+void ReplaceValue(V &value, Args&&... args) {
+    ValueReplacer<std::is_nothrow_constructible<V, Args&&...>::value>::
+        replace(value, std::forward<Args>(args)...);
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef IOERROR_H_
+#define IOERROR_H_
+
+#include <string>
+
+/* IOError
+ ******************************************************************************
+ *
+ * thrown by the file-backed structures of this directory when a file cannot
+ * be opened, read or written in full, or does not hold what it should.
+ *
+ */
+
+class IOError {
+public:
+    std::string path;
+    explicit IOError(const std::string &p) : path(p) {}
+};
+
+#endif
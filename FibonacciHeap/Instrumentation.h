@@ -0,0 +1,168 @@
+#ifndef INSTRUMENTATION_H_
+#define INSTRUMENTATION_H_
+
+/* Instrumentation
+ ******************************************************************************
+ *
+ * counters and per-operator timers for the hot paths of FibHeap and
+ * Polynomial. they are compiled in only when INSTRUMENTATION is defined
+ * (e.g. -DINSTRUMENTATION); otherwise every INSTRUMENT_ macro expands to
+ * nothing and the queries below report zero.
+ *
+ * counters are relaxed atomics, so instrumented code may run on several
+ * threads. timers are inclusive: operator-= is timed as a whole and also
+ * contributes to the *= and += it calls.
+ *
+ * Operations:
+ *
+ * -    recording (library code only):
+ *          INSTRUMENT_COUNT(HEAP_INSERTS, 1);
+ *          INSTRUMENT_TIME(MULTIPLY);
+ *
+ *          the first adds to a counter, the second times the rest of the
+ *          enclosing scope against an operator
+ *
+ * -    querying:
+ *          Instrumentation::count(Instrumentation::LINKS);
+ *          Instrumentation::calls(Instrumentation::DIVIDE);
+ *          Instrumentation::nanoseconds(Instrumentation::DIVIDE);
+ *          Instrumentation::reset();
+ *
+ * -    reporting:
+ *          Instrumentation::dump(std::cout);
+ *
+ *          writes every counter and timer as a single JSON object
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+class Instrumentation {
+public:
+    enum Counter {
+        ALLOCATIONS,
+        BYTES_ALLOCATED,
+        DEALLOCATIONS,
+        SET_DEGREE_CALLS,
+        SET_DEGREE_REALLOCATIONS,
+        HEAP_INSERTS,
+        HEAP_EXTRACTS,
+        CONSOLIDATE_PASSES,
+        LINKS,
+        CUTS,
+        COUNTERS
+    };
+
+    enum Timer {
+        ASSIGN,
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE,
+        REMAINDER,
+        EUCLIDEAN_DIVISION,
+        SET_DEGREE,
+        EVALUATE,
+        TIMERS
+    };
+
+#ifdef INSTRUMENTATION
+    static const bool enabled = true;
+#else
+    static const bool enabled = false;
+#endif
+
+    static unsigned long long count(Counter counter) {
+        return state().counts[counter].load(std::memory_order_relaxed);
+    }
+
+    static unsigned long long calls(Timer timer) {
+        return state().calls[timer].load(std::memory_order_relaxed);
+    }
+
+    static unsigned long long nanoseconds(Timer timer) {
+        return state().nanoseconds[timer].load(std::memory_order_relaxed);
+    }
+
+    static void add(Counter counter, unsigned long long amount) {
+        state().counts[counter].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    static void reset() {
+        for ( int i = 0; i < COUNTERS; i++ ) {
+            state().counts[i].store(0, std::memory_order_relaxed);
+        }
+        for ( int i = 0; i < TIMERS; i++ ) {
+            state().calls[i].store(0, std::memory_order_relaxed);
+            state().nanoseconds[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static void dump(std::ostream &out) {
+        static const char* counter_names[COUNTERS] = {
+            "allocations", "bytes_allocated", "deallocations",
+            "set_degree_calls", "set_degree_reallocations", "heap_inserts",
+            "heap_extracts", "consolidate_passes", "links", "cuts"
+        };
+        static const char* timer_names[TIMERS] = {
+            "assign", "add", "subtract", "multiply", "divide", "remainder",
+            "euclidean_division", "set_degree", "evaluate"
+        };
+        out << "{\"enabled\":" << (enabled ? "true" : "false");
+        for ( int i = 0; i < COUNTERS; i++ ) {
+            out << ",\"" << counter_names[i] << "\":"
+                << count(static_cast<Counter>(i));
+        }
+        out << ",\"operators\":{";
+        for ( int i = 0; i < TIMERS; i++ ) {
+            out << (i ? "," : "") << "\"" << timer_names[i] << "\":{\"calls\":"
+                << calls(static_cast<Timer>(i)) << ",\"ns\":"
+                << nanoseconds(static_cast<Timer>(i)) << "}";
+        }
+        out << "}}";
+    }
+
+    // adds the lifetime of the object to a timer
+    class Scope {
+    private:
+        Timer timer;
+        std::chrono::steady_clock::time_point start;
+    public:
+        Scope(Timer t) : timer(t), start(std::chrono::steady_clock::now()) {}
+        ~Scope() {
+            std::chrono::nanoseconds elapsed =
+                std::chrono::steady_clock::now() - start;
+            state().calls[timer].fetch_add(1, std::memory_order_relaxed);
+            state().nanoseconds[timer].fetch_add(
+                static_cast<unsigned long long>(elapsed.count()),
+                std::memory_order_relaxed);
+        }
+    };
+
+private:
+    struct State {
+        std::atomic<unsigned long long> counts[COUNTERS];
+        std::atomic<unsigned long long> calls[TIMERS];
+        std::atomic<unsigned long long> nanoseconds[TIMERS];
+    };
+
+    // one zero-initialized instance shared by every translation unit
+    static State& state() {
+        static State instance;
+        return instance;
+    }
+};
+
+#ifdef INSTRUMENTATION
+#define INSTRUMENT_COUNT(counter, amount) \
+    Instrumentation::add(Instrumentation::counter, (amount))
+#define INSTRUMENT_TIME(timer) \
+    Instrumentation::Scope instrumentation_scope(Instrumentation::timer)
+#else
+#define INSTRUMENT_COUNT(counter, amount) ((void)0)
+#define INSTRUMENT_TIME(timer) ((void)0)
+#endif
+
+#endif
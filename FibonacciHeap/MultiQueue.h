@@ -0,0 +1,209 @@
+#ifndef MULTIQUEUE_H_
+#define MULTIQUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "DaryHeap.h"
+#include "HeapValue.h"
+
+/* MultiQueue
+ ******************************************************************************
+ *
+ * a concurrent priority queue for many producers and consumers, sharded over
+ * c * p sequential heaps, each behind its own lock, for p threads. Heap may
+ * be any of the engines in this directory; the default is a 4-ary DaryHeap.
+ *
+ * push() adds the key to a random shard whose lock is free, and after eight
+ * busy shards waits for the lock of a ninth. in RELAXED mode
+ * (the default) try_pop() locks two random shards and extracts the better of
+ * their minima, so it returns a key close to the global minimum - with c * p
+ * shards, on average within O(c * p) ranks of it - and threads rarely contend
+ * for the same lock. in STRICT mode try_pop() locks every shard in order and
+ * extracts the true minimum, which serializes consumers but gives the order
+ * of a single heap.
+ *
+ * try_pop() only reports an empty queue after finding every shard empty.
+ *
+ * Operations:
+ *
+ * -    push(key), push(key, value):
+ *          O(Heap insert)
+ *
+ * -    try_pop(key), try_pop(key, value):
+ *          O(Heap extractMin) in RELAXED mode, O(c * p) locks in STRICT mode
+ *
+ * -    size(), empty():
+ *          a snapshot that may be stale by the time it is read
+ *
+ */
+
+template <class T, class Value = void, class Compare = std::less<T>,
+          class Heap = DaryHeap<T, 4, Value, Compare> >
+class MultiQueue {
+
+public:
+    typedef T key_type;
+    typedef typename HeapValue<Value>::type value_type;
+    typedef Compare key_compare;
+
+    enum Mode {
+        RELAXED,
+        STRICT
+    };
+
+private:
+    struct Shard {
+        std::mutex lock;
+        Heap heap;
+        // keeps neighbouring shards off each other's cache lines
+        char padding[64];
+    };
+
+    // VARIABLES
+    Compare compare;
+    Mode mode;
+    std::vector<Shard> shards;
+    std::atomic<size_t> count;
+
+    // FUNCTIONS
+    // a xorshift generator per thread, seeded from its id
+    static std::uint64_t Random() {
+        static thread_local std::uint64_t state =
+            std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    size_t RandomShard() { return Random() % shards.size(); }
+
+    // whether shard a's minimum comes before shard b's. both must be locked
+    bool Before(Shard &a, Shard &b) {
+        if ( a.heap.empty() ) {
+            return false;
+        }
+        return b.heap.empty() || compare(a.heap.min(), b.heap.min());
+    }
+
+    // locks every shard in order and extracts from the one with the true
+    // minimum
+    template <class... Out>
+    bool PopStrict(T &key, Out&... value) {
+        for ( size_t i = 0; i < shards.size(); i++ ) {
+            shards[i].lock.lock();
+        }
+        Shard* best = &shards[0];
+        for ( size_t i = 1; i < shards.size(); i++ ) {
+            if ( Before(shards[i], *best) ) {
+                best = &shards[i];
+            }
+        }
+        bool found = !best->heap.empty();
+        if ( found ) {
+            key = best->heap.extractMin(value...);
+            count--;
+        }
+        for ( size_t i = 0; i < shards.size(); i++ ) {
+            shards[i].lock.unlock();
+        }
+        return found;
+    }
+
+    // extracts the better minimum of two random shards, falling back to a
+    // scan of every shard when both are empty
+    template <class... Out>
+    bool PopRelaxed(T &key, Out&... value) {
+        for ( int attempt = 0; attempt < 8; attempt++ ) {
+            size_t i = RandomShard(), j = RandomShard();
+            if ( i == j ) {
+                j = (j + 1) % shards.size();
+            }
+            std::unique_lock<std::mutex> first(shards[i].lock, std::try_to_lock);
+            if ( !first.owns_lock() ) {
+                continue;
+            }
+            std::unique_lock<std::mutex> second(shards[j].lock, std::try_to_lock);
+            if ( !second.owns_lock() ) {
+                continue;
+            }
+            Shard &best = Before(shards[j], shards[i]) ? shards[j] : shards[i];
+            if ( best.heap.empty() ) {
+                break;
+            }
+            key = best.heap.extractMin(value...);
+            count--;
+            return true;
+        }
+        // both were empty or busy: take from the first shard with anything
+        size_t start = RandomShard();
+        for ( size_t k = 0; k < shards.size(); k++ ) {
+            Shard &shard = shards[(start + k) % shards.size()];
+            std::lock_guard<std::mutex> guard(shard.lock);
+            if ( !shard.heap.empty() ) {
+                key = shard.heap.extractMin(value...);
+                count--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <class... Args>
+    void Push(const T &key, Args&&... args) {
+        for ( int attempt = 0; ; attempt++ ) {
+            Shard &shard = shards[RandomShard()];
+            std::unique_lock<std::mutex> guard(shard.lock, std::defer_lock);
+            // after a few busy shards, e.g. while a strict pop holds them
+            // all, waits for one instead of spinning
+            if ( attempt < 8 ) {
+                guard.try_lock();
+            }
+            else {
+                guard.lock();
+            }
+            if ( guard.owns_lock() ) {
+                shard.heap.emplace(key, std::forward<Args>(args)...);
+                count++;
+                return;
+            }
+        }
+    }
+
+public:
+    // CONSTRUCTORS
+    // c * threads shards, and at least two. every shard orders its keys by
+    // a default-constructed Compare
+    explicit MultiQueue(unsigned int threads, unsigned int c = 2,
+                        Mode m = RELAXED) :
+        mode(m), shards(threads * c < 2 ? 2 : threads * c), count(0) {}
+
+    // FUNCTIONS
+    void push(const T &key) { Push(key); }
+
+    void push(const T &key, const value_type &value) { Push(key, value); }
+
+    // extracts a key near the minimum into key, or returns false if every
+    // shard is empty
+    bool try_pop(T &key) {
+        return mode == STRICT ? PopStrict(key) : PopRelaxed(key);
+    }
+
+    // as above, also moving the payload into value
+    bool try_pop(T &key, value_type &value) {
+        return mode == STRICT ? PopStrict(key, value) : PopRelaxed(key, value);
+    }
+
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+
+    bool empty() const { return size() == 0; }
+
+    size_t shard_count() const { return shards.size(); }
+};
+
+#endif
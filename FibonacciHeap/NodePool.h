@@ -0,0 +1,238 @@
+#ifndef NODEPOOL_H_
+#define NODEPOOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Instrumentation.h"
+
+/* NodePool
+ ******************************************************************************
+ *
+ * a slab allocator for the nodes of a pointer-based heap. memory is obtained
+ * from Allocator (rebound to the slot type) in chunks that double in size,
+ * from FIRST_CHUNK up to MAX_CHUNK nodes, so consecutive insertions get
+ * neighbouring addresses. a freed node is pushed onto an intrusive free list
+ * that overlays its storage and is handed out again before the current chunk
+ * is touched.
+ *
+ * nodes never move once created, so pointers to them are stable handles.
+ *
+ * Operations:
+ *
+ * -    create(args...), destroy(node):
+ *          constructs a node in a free slot / destroys it and frees the slot.
+ *          neither calls the underlying allocator except when a new chunk is
+ *          needed
+ *
+ * -    release():
+ *          returns every chunk to the allocator without running destructors.
+ *          the owner must have destroyed any node with a non-trivial
+ *          destructor first
+ *
+ * -    adopt(other):
+ *          takes over another pool's chunks, free list and untouched slots,
+ *          so nodes created by it may now be destroyed through this one and
+ *          its spare slots are reused. O(# chunks of other): the free lists
+ *          are spliced through a tail pointer and untouched slots are kept
+ *          as ranges, never walked. the allocators must compare equal
+ *
+ * -    reserve(count):
+ *          makes sure the next count creations need no further calls to
+ *          the allocator, allocating at most one chunk to do so
+ *
+ * -    swap(other):
+ *          exchanges the chunks, free lists and allocators of two pools
+ *
+ */
+
+template <class Node, class Allocator = std::allocator<Node> >
+class NodePool {
+private:
+    union Slot {
+        Slot* next;
+        typename std::aligned_storage<sizeof(Node), alignof(Node)>::type node;
+    };
+    typedef typename std::allocator_traits<Allocator>::template
+        rebind_alloc<Slot> SlotAllocator;
+    typedef std::allocator_traits<SlotAllocator> SlotTraits;
+    struct Chunk {
+        Slot* slots;
+        size_t size;
+    };
+    // untouched slots of an older chunk, used up once the cursor runs out
+    struct Range {
+        Slot* first;
+        Slot* last;
+    };
+
+    SlotAllocator allocator;
+    std::vector<Chunk> chunks;
+    Slot* free_list;
+    // the last slot of the free list, valid while it is not empty
+    Slot* free_tail;
+    // untouched slots at the end of the newest chunk, and of others
+    Slot* cursor;
+    Slot* limit;
+    std::vector<Range> ranges;
+    size_t next_size;
+    size_t live;
+
+    NodePool(const NodePool &);
+    NodePool& operator=(const NodePool &);
+
+    void grow(size_t size) {
+        Chunk chunk;
+        chunk.size = size;
+        chunk.slots = SlotTraits::allocate(allocator, size);
+        INSTRUMENT_COUNT(ALLOCATIONS, 1);
+        INSTRUMENT_COUNT(BYTES_ALLOCATED, sizeof(Slot) * size);
+        try {
+            chunks.push_back(chunk);
+        }
+        catch ( ... ) {
+            SlotTraits::deallocate(allocator, chunk.slots, size);
+            throw;
+        }
+        cursor = chunk.slots;
+        limit = chunk.slots + size;
+    }
+
+    Slot* take() {
+        Slot* slot;
+        if ( free_list ) {
+            slot = free_list;
+            free_list = slot->next;
+        }
+        else {
+            if ( cursor == limit && !ranges.empty() ) {
+                cursor = ranges.back().first;
+                limit = ranges.back().last;
+                ranges.pop_back();
+            }
+            if ( cursor == limit ) {
+                grow(next_size);
+                if ( next_size < MAX_CHUNK ) {
+                    next_size *= 2;
+                }
+            }
+            slot = cursor++;
+        }
+        live++;
+        return slot;
+    }
+
+    void give(Slot* slot) {
+        if ( !free_list ) {
+            free_tail = slot;
+        }
+        slot->next = free_list;
+        free_list = slot;
+        live--;
+    }
+
+public:
+    static const size_t FIRST_CHUNK = 64;
+    static const size_t MAX_CHUNK = 65536;
+
+    explicit NodePool(const Allocator &alloc = Allocator()) :
+        allocator(alloc), free_list(NULL), free_tail(NULL), cursor(NULL),
+        limit(NULL), next_size(FIRST_CHUNK), live(0) {}
+
+    ~NodePool() { release(); }
+
+    template <class... Args>
+    Node* create(Args&&... args) {
+        Slot* slot = take();
+        try {
+            return ::new (static_cast<void*>(&slot->node))
+                Node(std::forward<Args>(args)...);
+        }
+        catch ( ... ) {
+            give(slot);
+            throw;
+        }
+    }
+
+    void destroy(Node* node) {
+        node->~Node();
+        give(reinterpret_cast<Slot*>(node));
+    }
+
+    void release() {
+        for ( size_t i = 0; i < chunks.size(); i++ ) {
+            SlotTraits::deallocate(allocator, chunks[i].slots, chunks[i].size);
+            INSTRUMENT_COUNT(DEALLOCATIONS, 1);
+        }
+        chunks.clear();
+        ranges.clear();
+        free_list = free_tail = cursor = limit = NULL;
+        next_size = FIRST_CHUNK;
+        live = 0;
+    }
+
+    void adopt(NodePool &other) {
+        // a failure to grow either vector leaves the pools as they were
+        if ( other.cursor != other.limit ) {
+            Range range = { other.cursor, other.limit };
+            other.ranges.push_back(range);
+            other.cursor = other.limit = NULL;
+        }
+        size_t old_chunks = chunks.size();
+        chunks.insert(chunks.end(), other.chunks.begin(), other.chunks.end());
+        try {
+            ranges.insert(ranges.end(), other.ranges.begin(), other.ranges.end());
+        }
+        catch ( ... ) {
+            chunks.resize(old_chunks);
+            throw;
+        }
+        // splices the other free list in front of this one
+        if ( other.free_list ) {
+            other.free_tail->next = free_list;
+            if ( !free_list ) {
+                free_tail = other.free_tail;
+            }
+            free_list = other.free_list;
+        }
+        live += other.live;
+        other.chunks.clear();
+        other.ranges.clear();
+        other.free_list = other.free_tail = other.cursor = other.limit = NULL;
+        other.next_size = FIRST_CHUNK;
+        other.live = 0;
+    }
+
+    void reserve(size_t count) {
+        if ( static_cast<size_t>(limit - cursor) >= count ) {
+            return;
+        }
+        // the untouched end of the current chunk is kept for later
+        if ( cursor != limit ) {
+            Range range = { cursor, limit };
+            ranges.push_back(range);
+            cursor = limit = NULL;
+        }
+        grow(count);
+    }
+
+    void swap(NodePool &other) {
+        std::swap(allocator, other.allocator);
+        chunks.swap(other.chunks);
+        std::swap(free_list, other.free_list);
+        std::swap(free_tail, other.free_tail);
+        std::swap(cursor, other.cursor);
+        std::swap(limit, other.limit);
+        ranges.swap(other.ranges);
+        std::swap(next_size, other.next_size);
+        std::swap(live, other.live);
+    }
+
+    // number of nodes created and not yet destroyed
+    size_t size() const { return live; }
+};
+
+#endif
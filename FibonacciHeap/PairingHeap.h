@@ -0,0 +1,494 @@
+#ifndef PAIRINGHEAP_H_
+#define PAIRINGHEAP_H_
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "HeapValue.h"
+#include "Instrumentation.h"
+#include "NodePool.h"
+
+/* PairingHeap
+ ******************************************************************************
+ *
+ * a pairing heap with the interface of FibHeap: the same template
+ * parameters, handles, payloads, comparator and operations, so either engine
+ * can be used at a call site without other changes. FibHeap's queue of
+ * external nodes (store, en_*, operator[]) is not provided.
+ *
+ * the heap is a single heap-ordered tree kept as child / next sibling lists,
+ * where prev points to the previous sibling, or to the parent for a first
+ * child. a node has three links and no degree or mark, so for a double key
+ * it is 40 bytes against FibHeap's 56, and nodes come from a NodePool in the
+ * same way.
+ *
+ * extractMin merges the children of the root in one of two ways, chosen per
+ * heap:
+ *
+ * -    TWO_PASS (default):
+ *          links the children in pairs from left to right, then links the
+ *          results from right to left
+ *
+ * -    MULTIPASS:
+ *          repeatedly links the first two trees of the list and appends the
+ *          result to its end
+ *
+ * insert is O(1), merge O(# chunks of the other heap's pool), which is O(1)
+ * amortized over its insertions, extractMin and erase O(log n) amortized, and
+ * decrease_key o(log n) amortized, which behaves like O(1) in practice.
+ *
+ */
+
+template <class T, class Value = void, class Compare = std::less<T>,
+          class Allocator = std::allocator<T> >
+class PairingHeap {
+
+public:
+    typedef T key_type;
+    typedef typename HeapValue<Value>::type value_type;
+    typedef Compare key_compare;
+
+    enum Pairing {
+        TWO_PASS,
+        MULTIPASS
+    };
+
+private:
+    struct Node {
+        T key;
+        Node* child;
+        Node* next;
+        Node* prev;
+        value_type value;
+
+        template <class K, class... Args>
+        Node(K&& k, Args&&... args) :
+            key(std::forward<K>(k)), child(NULL), next(NULL), prev(NULL),
+            value(std::forward<Args>(args)...) {}
+    };
+
+    // VARIABLES
+    Compare compare;
+    Pairing pairing;
+    NodePool<Node, Allocator> pool;
+    Node* root;
+    size_t n;
+
+    // FUNCTIONS
+    // makes the root that comes later a first child of the other one and
+    // returns the remaining root
+    Node* Link(Node* a, Node* b) {
+        INSTRUMENT_COUNT(LINKS, 1);
+        if ( compare(b->key, a->key) ) {
+            std::swap(a, b);
+        }
+        b->next = a->child;
+        if ( a->child != NULL ) {
+            a->child->prev = b;
+        }
+        b->prev = a;
+        a->child = b;
+        return a;
+    }
+
+    // merges a list of sibling trees into one tree and returns its root
+    Node* Combine(Node* first) {
+        if ( first == NULL ) {
+            return NULL;
+        }
+        INSTRUMENT_COUNT(CONSOLIDATE_PASSES, 1);
+        Node* result;
+        if ( pairing == TWO_PASS ) {
+            // first pass: the linked pairs are stacked through prev
+            Node* stack = NULL, * a = first, * b, * rest;
+            while ( a != NULL ) {
+                b = a->next;
+                if ( b == NULL ) {
+                    a->prev = stack;
+                    stack = a;
+                    break;
+                }
+                rest = b->next;
+                a = Link(a, b);
+                a->prev = stack;
+                stack = a;
+                a = rest;
+            }
+            // second pass: the stack is popped from the rightmost pair
+            result = stack;
+            stack = stack->prev;
+            while ( stack != NULL ) {
+                Node* below = stack->prev;
+                result = Link(stack, result);
+                stack = below;
+            }
+        }
+        else {
+            // the list of trees is used as a queue through next
+            Node* tail = first;
+            while ( tail->next != NULL ) {
+                tail = tail->next;
+            }
+            result = first;
+            while ( result->next != NULL ) {
+                Node* b = result->next;
+                Node* rest = b->next;
+                Node* linked = Link(result, b);
+                if ( rest == NULL ) {
+                    result = linked;
+                    break;
+                }
+                linked->next = NULL;
+                tail->next = linked;
+                tail = linked;
+                result = rest;
+            }
+        }
+        result->next = result->prev = NULL;
+        return result;
+    }
+
+    // takes x and its subtree out of the list of children of its parent
+    void Detach(Node* x) {
+        if ( x->prev->child == x ) {
+            x->prev->child = x->next;
+        }
+        else {
+            x->prev->next = x->next;
+        }
+        if ( x->next != NULL ) {
+            x->next->prev = x->prev;
+        }
+        x->next = x->prev = NULL;
+    }
+
+    Node* ExtractMin() {
+        Node* z = root;
+        root = Combine(z->child);
+        z->child = NULL;
+        n--;
+        INSTRUMENT_COUNT(HEAP_EXTRACTS, 1);
+        return z;
+    }
+
+    void Insert(Node* x) {
+        root = root ? Link(root, x) : x;
+        n++;
+        INSTRUMENT_COUNT(HEAP_INSERTS, 1);
+    }
+
+    // destroys the tree under x without recursion, by splicing each child
+    // list into the list being walked
+    void DestroyAll(Node* x) {
+        while ( x != NULL ) {
+            if ( x->child != NULL ) {
+                Node* last = x->child;
+                while ( last->next != NULL ) {
+                    last = last->next;
+                }
+                last->next = x->next;
+                x->next = x->child;
+                x->child = NULL;
+            }
+            Node* next = x->next;
+            pool.destroy(x);
+            x = next;
+        }
+    }
+
+    // copies the tree of H node for node in preorder, climbing back through
+    // prev when a sibling list ends
+    Node* CopyTree(const PairingHeap &H) {
+        const Node* s = H.root;
+        Node* first, * c;
+        if ( s == NULL ) {
+            return NULL;
+        }
+        pool.reserve(H.n);
+        first = c = pool.create(s->key, s->value);
+        try {
+            for ( ;; ) {
+                if ( s->child != NULL ) {
+                    s = s->child;
+                    c->child = pool.create(s->key, s->value);
+                    c->child->prev = c;
+                    c = c->child;
+                    continue;
+                }
+                while ( s->next == NULL ) {
+                    if ( s == H.root ) {
+                        return first;
+                    }
+                    while ( s->prev->child != s ) {
+                        s = s->prev;
+                        c = c->prev;
+                    }
+                    s = s->prev;
+                    c = c->prev;
+                }
+                s = s->next;
+                c->next = pool.create(s->key, s->value);
+                c->next->prev = c;
+                c = c->next;
+            }
+        }
+        catch ( ... ) {
+            DestroyAll(first);
+            throw;
+        }
+    }
+
+public:
+    // EXCEPTIONS
+    // thrown by decrease_key when the new key comes after the old one
+    class KeyIncrease {
+    };
+
+    // HANDLES
+    // identifies a node for as long as it stays in the heap, including after
+    // merging into another heap
+    class handle {
+        friend class PairingHeap;
+        Node* node;
+        explicit handle(Node* x) : node(x) {}
+    public:
+        handle() : node(NULL) {}
+        bool operator==(const handle &h) const { return node == h.node; }
+        bool operator!=(const handle &h) const { return node != h.node; }
+    };
+
+    // CONSTRUCTORS
+    PairingHeap() : pairing(TWO_PASS), root(NULL), n(0) {}
+
+    explicit PairingHeap(const Compare &cmp, const Allocator &alloc = Allocator()) :
+        compare(cmp), pairing(TWO_PASS), pool(alloc), root(NULL), n(0) {}
+
+    explicit PairingHeap(Pairing p, const Compare &cmp = Compare(),
+                         const Allocator &alloc = Allocator()) :
+        compare(cmp), pairing(p), pool(alloc), root(NULL), n(0) {}
+
+    template <class InputIterator>
+    PairingHeap(InputIterator first, InputIterator last,
+                const Compare &cmp = Compare(), const Allocator &alloc = Allocator()) :
+        compare(cmp), pairing(TWO_PASS), pool(alloc), root(NULL), n(0) {
+        try {
+            insert_range(first, last);
+        }
+        catch ( ... ) {
+            DestroyAll(root);
+            throw;
+        }
+    }
+
+    // copies the tree node for node in O(n) from one block of the pool
+    PairingHeap(const PairingHeap &H) :
+        compare(H.compare), pairing(H.pairing), root(CopyTree(H)), n(H.n) {}
+
+    PairingHeap(PairingHeap &&H) :
+        compare(H.compare), pairing(H.pairing), root(NULL), n(0) {
+        swap(H);
+    }
+
+    PairingHeap& operator=(const PairingHeap &H) {
+        if ( this != &H ) {
+            PairingHeap copy(H);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    PairingHeap& operator=(PairingHeap &&H) {
+        if ( this != &H ) {
+            PairingHeap moved(std::move(H));
+            swap(moved);
+        }
+        return *this;
+    }
+
+    // DESTRUCTOR
+    ~PairingHeap() {
+        if ( !std::is_trivially_destructible<Node>::value ) {
+            DestroyAll(root);
+        }
+    }
+
+    // FUNCTIONS
+    void swap(PairingHeap &H) {
+        std::swap(compare, H.compare);
+        std::swap(pairing, H.pairing);
+        pool.swap(H.pool);
+        std::swap(root, H.root);
+        std::swap(n, H.n);
+    }
+
+    size_t size() const { return n; }
+
+    bool empty() const { return n == 0; }
+
+    // selects how later extractions merge the children of the root
+    void set_pairing(Pairing p) { pairing = p; }
+
+    // places a new node in the heap and returns its handle
+    handle insert(const T &key) {
+        return emplace(key);
+    }
+
+    handle insert(const T &key, const value_type &value) {
+        return emplace(key, value);
+    }
+
+    // constructs the key from k and the payload from args in a new node
+    template <class K, class... Args>
+    handle emplace(K&& k, Args&&... args) {
+        Node* node = pool.create(std::forward<K>(k), std::forward<Args>(args)...);
+        Insert(node);
+        return handle(node);
+    }
+
+    // inserts every key of [first, last), drawing the nodes from one block
+    // of the pool when the range can be measured in advance
+    template <class InputIterator>
+    void insert_range(InputIterator first, InputIterator last) {
+        reserve(first, last,
+                typename std::iterator_traits<InputIterator>::iterator_category());
+        for ( ; first != last; ++first ) {
+            Insert(pool.create(*first));
+        }
+    }
+
+    // the node holding the minimum, or a null handle when the heap is empty
+    handle top() const { return handle(root); }
+
+    // the key and payload of a node in the heap
+    const T& key(handle h) const { return h.node->key; }
+    value_type& value(handle h) { return h.node->value; }
+
+    // moves a node's key towards the minimum in O(1) time; the cost of
+    // restoring the shape is paid by later extractions.
+    // throws KeyIncrease exception
+    void decrease_key(handle h, const T &key) {
+        Node* x = h.node;
+        if ( compare(x->key, key) ) {
+            throw KeyIncrease();
+        }
+        x->key = key;
+        if ( x != root ) {
+            Detach(x);
+            root = Link(root, x);
+        }
+    }
+
+    // removes a node from the heap in O(log n) amortized time
+    void erase(handle h) {
+        Node* x = h.node;
+        if ( x == root ) {
+            pool.destroy(ExtractMin());
+            return;
+        }
+        Detach(x);
+        Node* subtree = Combine(x->child);
+        if ( subtree != NULL ) {
+            root = Link(root, subtree);
+        }
+        n--;
+        pool.destroy(x);
+    }
+
+    // moves every node of other into this heap in O(# chunks of other's
+    // pool), as FibHeap::merge does; handles into other stay valid and now refer to this heap. the allocators must compare
+    // equal
+    void merge(PairingHeap &&other) {
+        if ( &other == this || other.root == NULL ) {
+            return;
+        }
+        pool.adopt(other.pool);
+        root = root ? Link(root, other.root) : other.root;
+        n += other.n;
+        other.root = NULL;
+        other.n = 0;
+    }
+
+    // the minimum value still in the heap
+    T min() const {
+        return n ?
+               root->key :
+               std::numeric_limits<T>::lowest();
+    }
+
+    // extracts the minimum value and deletes the node that contained it
+    T extractMin() {
+        Node* x = ExtractMin();
+        T key = std::move(x->key);
+        pool.destroy(x);
+        return key;
+    }
+
+    // extracts the minimum value and moves its payload into value
+    T extractMin(value_type &value) {
+        Node* x = ExtractMin();
+        T key = std::move(x->key);
+        value = std::move(x->value);
+        pool.destroy(x);
+        return key;
+    }
+
+    // extracts the k minimum values, or every value if there are fewer, and
+    // writes them in ascending order to out, as FibHeap's extract_k does.
+    // a pairing heap has no consolidation to share across the batch, so
+    // this is k calls to extractMin. returns the number of values written
+    template <class OutputIterator>
+    size_t extract_k(size_t k, OutputIterator out) {
+        size_t written = 0;
+        for ( ; written < k && n > 0; written++ ) {
+            Node* x = ExtractMin();
+            try {
+                *out = std::move(x->key);
+                ++out;
+            }
+            catch ( ... ) {
+                pool.destroy(x);
+                throw;
+            }
+            pool.destroy(x);
+        }
+        return written;
+    }
+
+    // as above, also moving the payload of each value to values
+    template <class KeyOutputIterator, class ValueOutputIterator>
+    size_t extract_k(size_t k, KeyOutputIterator keys,
+                     ValueOutputIterator values) {
+        size_t written = 0;
+        for ( ; written < k && n > 0; written++ ) {
+            Node* x = ExtractMin();
+            try {
+                *keys = std::move(x->key);
+                ++keys;
+                *values = std::move(x->value);
+                ++values;
+            }
+            catch ( ... ) {
+                pool.destroy(x);
+                throw;
+            }
+            pool.destroy(x);
+        }
+        return written;
+    }
+
+private:
+    template <class InputIterator>
+    void reserve(InputIterator, InputIterator, std::input_iterator_tag) {}
+
+    template <class ForwardIterator>
+    void reserve(ForwardIterator first, ForwardIterator last,
+                 std::forward_iterator_tag) {
+        pool.reserve(std::distance(first, last));
+    }
+};
+
+#endif
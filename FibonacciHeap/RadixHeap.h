@@ -0,0 +1,373 @@
+#ifndef RADIXHEAP_H_
+#define RADIXHEAP_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "HeapValue.h"
+#include "Instrumentation.h"
+
+/* RadixHeap
+ ******************************************************************************
+ *
+ * a monotone priority queue of integer keys with the interface of FibHeap.
+ * it only works for workloads where no key inserted or decreased to is below
+ * the last minimum extracted, as in Dijkstra's algorithm or a discrete event
+ * simulation. builds without NDEBUG assert this on every insertion and
+ * decrease.
+ *
+ * a key k is kept in bucket 0 if it equals the last minimum m, and otherwise
+ * in bucket b, where b is the position of the highest bit in which k and m
+ * differ (1 for the lowest bit). when bucket 0 runs out, the first non-empty
+ * bucket is emptied: its smallest key becomes the new m and every key in it
+ * moves to a strictly lower bucket. a key therefore moves at most once per
+ * bit, and no key is ever compared with another except while searching that
+ * one bucket, which gives O(log C) amortized operations for keys spanning a
+ * range of C.
+ *
+ * buckets are vectors that keep their capacity, so once they have grown the
+ * heap allocates nothing. handles name slots, as in DaryHeap: a slot holds
+ * the payload and the bucket and index of its entry. merge gives the nodes
+ * of the other heap new slots, so its handles become invalid.
+ *
+ * Operations:
+ *
+ * -    insert, emplace, decrease_key, erase:
+ *          O(1)
+ *
+ * -    extractMin:
+ *          O(log C) amortized
+ *
+ * -    top, min:
+ *          O(1) when keys equal the last minimum, otherwise a scan of the
+ *          first non-empty bucket. a peek does not advance the last minimum,
+ *          so keys below the peeked one may still be inserted
+ *
+ */
+
+template <class T, class Value = void>
+class RadixHeap {
+    static_assert(std::is_integral<T>::value, "RadixHeap keys must be integers");
+
+public:
+    typedef T key_type;
+    typedef typename HeapValue<Value>::type value_type;
+    typedef std::less<T> key_compare;
+    typedef std::uint32_t index_type;
+
+    // EXCEPTIONS
+    // thrown by decrease_key when the new key is greater than the old one
+    class KeyIncrease {};
+    // thrown by an insertion when every slot is in use
+    class Full {};
+
+    // HANDLES
+    // names the slot of a node for as long as the node stays in the heap
+    class handle {
+        friend class RadixHeap;
+        index_type slot;
+        explicit handle(index_type s) : slot(s) {}
+    public:
+        handle() : slot(NIL) {}
+        bool operator==(const handle &h) const { return slot == h.slot; }
+        bool operator!=(const handle &h) const { return slot != h.slot; }
+    };
+
+private:
+    static const index_type NIL = 0xffffffffu;
+    typedef typename std::make_unsigned<T>::type Bits;
+    static const int BITS = std::numeric_limits<Bits>::digits;
+
+    struct Entry {
+        T key;
+        index_type slot;
+    };
+
+    struct Position {
+        index_type bucket;
+        // the index of the entry in its bucket, or the next free slot
+        index_type index;
+    };
+
+    // VARIABLES
+    std::vector<Entry> buckets[BITS + 1];
+    std::vector<Position> position;
+    std::vector<value_type> values;
+    index_type free_slot;
+    // the last minimum extracted, below which no key may go
+    T last;
+    size_t n;
+
+    // FUNCTIONS
+    // maps keys to unsigned integers in the same order
+    static Bits Order(T key) {
+        Bits bits = static_cast<Bits>(key);
+        if ( std::is_signed<T>::value ) {
+            bits ^= Bits(1) << (BITS - 1);
+        }
+        return bits;
+    }
+
+    int Bucket(T key) const {
+        Bits differ = Order(key) ^ Order(last);
+        if ( differ == 0 ) {
+            return 0;
+        }
+#if defined(__GNUC__)
+        return 64 - __builtin_clzll(static_cast<unsigned long long>(differ));
+#else
+        int b = 0;
+        while ( differ != 0 ) {
+            differ >>= 1;
+            b++;
+        }
+        return b;
+#endif
+    }
+
+    template <class... Args>
+    index_type allocate(Args&&... args) {
+        index_type slot;
+        if ( free_slot != NIL ) {
+            slot = free_slot;
+            ReplaceValue(values[slot], std::forward<Args>(args)...);
+            free_slot = position[slot].index;
+        }
+        else {
+            if ( position.size() >= NIL ) {
+                throw Full();
+            }
+            slot = static_cast<index_type>(position.size());
+            values.emplace_back(std::forward<Args>(args)...);
+            position.push_back(Position());
+        }
+        return slot;
+    }
+
+    // releases the payload's resources now rather than when reused
+    void deallocate(index_type slot) {
+        ReleaseValue(values[slot]);
+        position[slot].index = free_slot;
+        free_slot = slot;
+    }
+
+    // adds the entry of slot to the bucket of its key
+    void Place(T key, index_type slot) {
+        assert(!(key < last) && "RadixHeap key below the last minimum");
+        int b = Bucket(key);
+        Entry entry = { key, slot };
+        position[slot].bucket = b;
+        position[slot].index = static_cast<index_type>(buckets[b].size());
+        buckets[b].push_back(entry);
+    }
+
+    // takes the entry of slot out of its bucket
+    void Unplace(index_type slot) {
+        std::vector<Entry> &bucket = buckets[position[slot].bucket];
+        index_type i = position[slot].index;
+        if ( i + 1 != bucket.size() ) {
+            bucket[i] = bucket.back();
+            position[bucket[i].slot].index = i;
+        }
+        bucket.pop_back();
+    }
+
+    // makes bucket 0 non-empty by advancing last to the smallest key and
+    // redistributing its bucket. the heap must not be empty
+    void Pull() {
+        if ( !buckets[0].empty() ) {
+            return;
+        }
+        INSTRUMENT_COUNT(CONSOLIDATE_PASSES, 1);
+        int i = 1;
+        while ( buckets[i].empty() ) {
+            i++;
+        }
+        std::vector<Entry> &bucket = buckets[i];
+        T least = bucket[0].key;
+        for ( size_t j = 1; j < bucket.size(); j++ ) {
+            if ( bucket[j].key < least ) {
+                least = bucket[j].key;
+            }
+        }
+        last = least;
+        for ( size_t j = 0; j < bucket.size(); j++ ) {
+            Place(bucket[j].key, bucket[j].slot);
+        }
+        bucket.clear();
+    }
+
+    // the entry extractMin would take next, found without advancing last.
+    // among equal keys it is the one Pull would leave at the back of bucket
+    // 0. the heap must not be empty
+    const Entry& Least() const {
+        if ( !buckets[0].empty() ) {
+            return buckets[0].back();
+        }
+        int i = 1;
+        while ( buckets[i].empty() ) {
+            i++;
+        }
+        const std::vector<Entry> &bucket = buckets[i];
+        size_t least = 0;
+        for ( size_t j = 1; j < bucket.size(); j++ ) {
+            if ( !(bucket[least].key < bucket[j].key) ) {
+                least = j;
+            }
+        }
+        return bucket[least];
+    }
+
+public:
+    // CONSTRUCTORS
+    RadixHeap() : free_slot(NIL), last(std::numeric_limits<T>::min()), n(0) {}
+
+    template <class InputIterator>
+    RadixHeap(InputIterator begin, InputIterator end) :
+        free_slot(NIL), last(std::numeric_limits<T>::min()), n(0) {
+        insert_range(begin, end);
+    }
+
+    // FUNCTIONS
+    void swap(RadixHeap &H) {
+        for ( int i = 0; i <= BITS; i++ ) {
+            buckets[i].swap(H.buckets[i]);
+        }
+        position.swap(H.position);
+        values.swap(H.values);
+        std::swap(free_slot, H.free_slot);
+        std::swap(last, H.last);
+        std::swap(n, H.n);
+    }
+
+    size_t size() const { return n; }
+
+    bool empty() const { return n == 0; }
+
+    // places a new node in the heap and returns its handle. key must not be
+    // below the last minimum extracted
+    handle insert(const T &key) {
+        return emplace(key);
+    }
+
+    handle insert(const T &key, const value_type &value) {
+        return emplace(key, value);
+    }
+
+    // constructs the payload from args in a new node
+    template <class... Args>
+    handle emplace(T key, Args&&... args) {
+        index_type slot = allocate(std::forward<Args>(args)...);
+        try {
+            Place(key, slot);
+        }
+        catch ( ... ) {
+            deallocate(slot);
+            throw;
+        }
+        n++;
+        INSTRUMENT_COUNT(HEAP_INSERTS, 1);
+        return handle(slot);
+    }
+
+    template <class InputIterator>
+    void insert_range(InputIterator begin, InputIterator end) {
+        for ( ; begin != end; ++begin ) {
+            insert(*begin);
+        }
+    }
+
+    // the node holding the minimum, or a null handle when the heap is empty
+    handle top() {
+        if ( n == 0 ) {
+            return handle();
+        }
+        return handle(Least().slot);
+    }
+
+    // the key and payload of a node in the heap
+    const T& key(handle h) const {
+        return buckets[position[h.slot].bucket][position[h.slot].index].key;
+    }
+    value_type& value(handle h) { return values[h.slot]; }
+
+    // lowers a node's key in O(1) time, to no less than the last minimum
+    // extracted.
+    // throws KeyIncrease exception
+    void decrease_key(handle h, const T &key) {
+        if ( this->key(h) < key ) {
+            throw KeyIncrease();
+        }
+        Unplace(h.slot);
+        Place(key, h.slot);
+    }
+
+    // removes a node from the heap in O(1) time
+    void erase(handle h) {
+        Unplace(h.slot);
+        deallocate(h.slot);
+        n--;
+    }
+
+    // moves every node of other into this heap, which leaves other empty and
+    // its handles invalid. no key of other may be below this heap's last
+    // minimum, unless this heap is empty
+    void merge(RadixHeap &&other) {
+        if ( &other == this ) {
+            return;
+        }
+        if ( n == 0 ) {
+            swap(other);
+            return;
+        }
+        for ( int i = 0; i <= BITS; i++ ) {
+            for ( size_t j = 0; j < other.buckets[i].size(); j++ ) {
+                const Entry &entry = other.buckets[i][j];
+                emplace(entry.key, std::move(other.values[entry.slot]));
+            }
+        }
+        RadixHeap emptied;
+        other.swap(emptied);
+    }
+
+    // the minimum value still in the heap
+    T min() const {
+        if ( n == 0 ) {
+            return std::numeric_limits<T>::lowest();
+        }
+        return Least().key;
+    }
+
+    // extracts the minimum value and frees the node that contained it
+    T extractMin() {
+        Pull();
+        deallocate(buckets[0].back().slot);
+        buckets[0].pop_back();
+        n--;
+        INSTRUMENT_COUNT(HEAP_EXTRACTS, 1);
+        return last;
+    }
+
+    // extracts the minimum value and moves its payload into value
+    T extractMin(value_type &value) {
+        Pull();
+        index_type slot = buckets[0].back().slot;
+        value = std::move(values[slot]);
+        deallocate(slot);
+        buckets[0].pop_back();
+        n--;
+        INSTRUMENT_COUNT(HEAP_EXTRACTS, 1);
+        return last;
+    }
+};
+
+template <class T, class Value>
+const typename RadixHeap<T, Value>::index_type RadixHeap<T, Value>::NIL;
+
+#endif
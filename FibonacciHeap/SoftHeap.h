@@ -0,0 +1,385 @@
+#ifndef SOFTHEAP_H_
+#define SOFTHEAP_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "HeapValue.h"
+#include "Instrumentation.h"
+#include "NodePool.h"
+
+/* SoftHeap
+ ******************************************************************************
+ *
+ * a soft heap in the simplified form of Kaplan, Tarjan and Zwick: a
+ * priority queue that may raise the keys of some of its items, for work
+ * that only needs its output roughly in order. after n insertions at most
+ * epsilon * n items in the heap are corrupted, i.e. filed under a key
+ * greater than their own, and extractMin returns an item whose filed key is
+ * the least of all filed keys. every item extracted has a key no greater
+ * than that of any uncorrupted item still in the heap.
+ *
+ * the heap is a list of binary trees of distinct rank, in increasing order,
+ * like the digits of a binary counter. every node holds a list of items
+ * filed under the node's key. a node of rank above r = ceil(log2(3 /
+ * epsilon)) keeps about (3/2)^(rank - r) items: when its list runs low it
+ * takes the whole list of its child with the lesser key, and the child's
+ * key with it, which is where corruption comes from. because items move in
+ * lists rather than one at a time, both operations are O(1) amortized for a
+ * fixed epsilon, against O(log n) for an exact heap.
+ *
+ * Operations:
+ *
+ * -    insert(key), insert(key, value), emplace(key, args...):
+ *          O(log(1 / epsilon)) amortized
+ *
+ * -    extractMin(), extractMin(value):
+ *          O(1) amortized, plus a walk over the O(log n) tree roots
+ *
+ * -    corrupted():
+ *          how many items extracted so far were corrupted when they left
+ *
+ */
+
+template <class T, class Value = void, class Compare = std::less<T>,
+          class Allocator = std::allocator<T> >
+class SoftHeap {
+
+public:
+    typedef T key_type;
+    typedef typename HeapValue<Value>::type value_type;
+    typedef Compare key_compare;
+
+private:
+    struct Item {
+        T key;
+        Item* next;
+        value_type value;
+
+        template <class K, class... Args>
+        Item(K&& k, Args&&... args) :
+            key(std::forward<K>(k)), next(NULL),
+            value(std::forward<Args>(args)...) {}
+    };
+
+    struct Node {
+        // the key every item of the list is filed under
+        T key;
+        Node* left;
+        Node* right;
+        // the next root, and the root of least key from this one on
+        Node* next;
+        Node* suffix;
+        Item* first;
+        Item* last;
+        size_t count;
+        // the number of items the list is refilled to
+        size_t target;
+        int rank;
+
+        Node(const T &k, int r) :
+            key(k), left(NULL), right(NULL), next(NULL), suffix(this),
+            first(NULL), last(NULL), count(0), target(1), rank(r) {}
+    };
+
+    // VARIABLES
+    Compare compare;
+    double eps;
+    int r;
+    NodePool<Item, Allocator> items;
+    NodePool<Node, Allocator> nodes;
+    Node* roots;
+    size_t n;
+    size_t spoiled;
+
+    // FUNCTIONS
+    static bool Leaf(const Node* x) { return x->left == NULL && x->right == NULL; }
+
+    // refills the list of x from its children until it holds target items
+    // or x is a leaf
+    void Sift(Node* x) {
+        while ( x->count < x->target && !Leaf(x) ) {
+            if ( x->left == NULL ||
+                 (x->right != NULL && compare(x->right->key, x->left->key)) ) {
+                std::swap(x->left, x->right);
+            }
+            Node* y = x->left;
+            if ( x->first == NULL ) {
+                x->first = y->first;
+            }
+            else {
+                x->last->next = y->first;
+            }
+            x->last = y->last;
+            x->count += y->count;
+            x->key = y->key;
+            y->first = y->last = NULL;
+            y->count = 0;
+            if ( Leaf(y) ) {
+                x->left = NULL;
+                nodes.destroy(y);
+            }
+            else {
+                Sift(y);
+            }
+        }
+    }
+
+    // joins two roots of equal rank under a new root
+    Node* Combine(Node* x, Node* y) {
+        INSTRUMENT_COUNT(LINKS, 1);
+        Node* z = nodes.create(x->key, x->rank + 1);
+        z->left = x;
+        z->right = y;
+        z->target = z->rank <= r ? 1 : (3 * x->target + 1) / 2;
+        Sift(z);
+        return z;
+    }
+
+    void Suffix(Node* x) {
+        x->suffix = x->next != NULL && compare(x->next->suffix->key, x->key) ?
+                    x->next->suffix : x;
+    }
+
+    void DestroyAll(Node* x) {
+        if ( x == NULL ) {
+            return;
+        }
+        for ( Item* e = x->first; e != NULL; ) {
+            Item* next = e->next;
+            items.destroy(e);
+            e = next;
+        }
+        DestroyAll(x->left);
+        DestroyAll(x->right);
+        nodes.destroy(x);
+    }
+
+    // takes the first item filed under the least key out of the heap
+    Item* ExtractMin() {
+        Node* h = roots->suffix;
+        Item* e = h->first;
+        h->first = e->next;
+        if ( h->first == NULL ) {
+            h->last = NULL;
+        }
+        h->count--;
+        n--;
+        if ( compare(e->key, h->key) ) {
+            spoiled++;
+        }
+        // the roots before h, whose suffix pointers may change
+        Node* before[8 * sizeof(size_t) + 1];
+        int k = 0;
+        for ( Node* x = roots; x != h; x = x->next ) {
+            before[k++] = x;
+        }
+        if ( 2 * h->count <= h->target ) {
+            if ( !Leaf(h) ) {
+                INSTRUMENT_COUNT(CONSOLIDATE_PASSES, 1);
+                Sift(h);
+                Suffix(h);
+            }
+            else if ( h->count == 0 ) {
+                if ( k == 0 ) {
+                    roots = h->next;
+                }
+                else {
+                    before[k - 1]->next = h->next;
+                }
+                nodes.destroy(h);
+            }
+        }
+        else {
+            Suffix(h);
+        }
+        while ( k-- > 0 ) {
+            Suffix(before[k]);
+        }
+        INSTRUMENT_COUNT(HEAP_EXTRACTS, 1);
+        return e;
+    }
+
+public:
+    // CONSTRUCTORS
+    // a heap corrupting at most epsilon of the items inserted, 0 < epsilon
+    explicit SoftHeap(double epsilon = 0.1, const Compare &cmp = Compare(),
+                      const Allocator &alloc = Allocator()) :
+        compare(cmp), eps(epsilon),
+        r(epsilon >= 1 ? 1 : static_cast<int>(std::ceil(std::log2(3 / epsilon)))),
+        items(alloc), nodes(alloc), roots(NULL), n(0), spoiled(0) {}
+
+    SoftHeap(const SoftHeap&) = delete;
+    SoftHeap& operator=(const SoftHeap&) = delete;
+
+    // DESTRUCTOR
+    ~SoftHeap() {
+        if ( !std::is_trivially_destructible<Item>::value ||
+             !std::is_trivially_destructible<Node>::value ) {
+            while ( roots != NULL ) {
+                Node* next = roots->next;
+                DestroyAll(roots);
+                roots = next;
+            }
+        }
+    }
+
+    // FUNCTIONS
+    size_t size() const { return n; }
+
+    bool empty() const { return n == 0; }
+
+    double epsilon() const { return eps; }
+
+    size_t corrupted() const { return spoiled; }
+
+    void insert(const T &key) { emplace(key); }
+
+    void insert(const T &key, const value_type &value) { emplace(key, value); }
+
+    // constructs the key from k and the payload from args in a new item
+    template <class K, class... Args>
+    void emplace(K&& k, Args&&... args) {
+        Item* e = items.create(std::forward<K>(k), std::forward<Args>(args)...);
+        Node* x;
+        try {
+            x = nodes.create(e->key, 0);
+        }
+        catch ( ... ) {
+            items.destroy(e);
+            throw;
+        }
+        x->first = x->last = e;
+        x->count = 1;
+        // adds one to the binary counter of ranks
+        while ( roots != NULL && roots->rank == x->rank ) {
+            Node* rest = roots->next;
+            x = Combine(roots, x);
+            roots = rest;
+        }
+        x->next = roots;
+        Suffix(x);
+        roots = x;
+        n++;
+        INSTRUMENT_COUNT(HEAP_INSERTS, 1);
+    }
+
+    // the least filed key, an upper bound on the key extractMin returns.
+    // the heap must not be empty
+    const T& min() const { return roots->suffix->key; }
+
+    // extracts an item of least filed key and frees it
+    T extractMin() {
+        Item* e = ExtractMin();
+        T key = std::move(e->key);
+        items.destroy(e);
+        return key;
+    }
+
+    // as above, also moving its payload into value
+    T extractMin(value_type &value) {
+        Item* e = ExtractMin();
+        T key = std::move(e->key);
+        value = std::move(e->value);
+        items.destroy(e);
+        return key;
+    }
+};
+
+/* approximate_median, soft_select
+ ******************************************************************************
+ *
+ * selection on a SoftHeap. approximate_median returns an element of
+ * [first, last) whose rank is within epsilon * n / 2 of n / 2: it extracts
+ * the first n / 2 - epsilon * n / 2 items of a SoftHeap of them and takes
+ * the greatest, which at least that many elements do not exceed and which
+ * only corrupted items can be less than. O(n) for a fixed epsilon.
+ *
+ * soft_select moves the element of rank k (from 0) to first + k, with no
+ * greater element before it and no lesser one after, as std::nth_element
+ * does. its pivots come from a SoftHeap of epsilon 1/3, so each has rank
+ * between a third and two thirds of the range and the selection takes O(n)
+ * in the worst case.
+ *
+ */
+
+template <class RandomIterator, class Compare>
+typename std::iterator_traits<RandomIterator>::value_type
+approximate_median(RandomIterator first, RandomIterator last, double epsilon,
+                   Compare compare) {
+    typedef typename std::iterator_traits<RandomIterator>::value_type T;
+    size_t n = last - first;
+    SoftHeap<T, void, Compare> heap(epsilon, compare);
+    for ( RandomIterator i = first; i != last; ++i ) {
+        heap.insert(*i);
+    }
+    size_t slack = static_cast<size_t>(epsilon * n / 2);
+    size_t m = n / 2 > slack ? n / 2 - slack : 1;
+    T best = heap.extractMin();
+    for ( size_t i = 1; i < m; i++ ) {
+        T key = heap.extractMin();
+        if ( compare(best, key) ) {
+            best = key;
+        }
+    }
+    return best;
+}
+
+template <class RandomIterator>
+typename std::iterator_traits<RandomIterator>::value_type
+approximate_median(RandomIterator first, RandomIterator last,
+                   double epsilon = 0.1) {
+    return approximate_median(first, last, epsilon, std::less<
+        typename std::iterator_traits<RandomIterator>::value_type>());
+}
+
+template <class RandomIterator, class Compare>
+RandomIterator soft_select(RandomIterator first, RandomIterator last, size_t k,
+                           Compare compare) {
+    typedef typename std::iterator_traits<RandomIterator>::value_type T;
+    RandomIterator target = first + k;
+    while ( last - first > 32 ) {
+        // extracting a third of the range from a heap of epsilon 1/3 gives
+        // a pivot of rank between n/3 and 2n/3
+        size_t n = last - first;
+        SoftHeap<T, void, Compare> heap(1.0 / 3, compare);
+        for ( RandomIterator i = first; i != last; ++i ) {
+            heap.insert(*i);
+        }
+        T pivot = heap.extractMin();
+        for ( size_t i = 1; i < n / 3; i++ ) {
+            T key = heap.extractMin();
+            if ( compare(pivot, key) ) {
+                pivot = key;
+            }
+        }
+        RandomIterator less = std::partition(first, last,
+            [&](const T &x) { return compare(x, pivot); });
+        RandomIterator equal = std::partition(less, last,
+            [&](const T &x) { return !compare(pivot, x); });
+        if ( target < less ) {
+            last = less;
+        }
+        else if ( target < equal ) {
+            return target;
+        }
+        else {
+            first = equal;
+        }
+    }
+    std::sort(first, last, compare);
+    return target;
+}
+
+template <class RandomIterator>
+RandomIterator soft_select(RandomIterator first, RandomIterator last, size_t k) {
+    return soft_select(first, last, k, std::less<
+        typename std::iterator_traits<RandomIterator>::value_type>());
+}
+
+#endif
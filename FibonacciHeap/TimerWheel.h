@@ -0,0 +1,462 @@
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "FibHeap.h"
+#include "HeapValue.h"
+
+/* MonotonicClock, FakeClock
+ ******************************************************************************
+ *
+ * time sources for TimerWheel, counting ticks as unsigned 64-bit integers.
+ * MonotonicClock counts milliseconds of std::chrono::steady_clock. FakeClock
+ * only moves when told to, so that tests and simulations are deterministic.
+ *
+ */
+
+class MonotonicClock {
+public:
+    std::uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+class FakeClock {
+private:
+    std::uint64_t ticks;
+public:
+    explicit FakeClock(std::uint64_t start = 0) : ticks(start) {}
+    std::uint64_t now() const { return ticks; }
+    void advance(std::uint64_t count) { ticks += count; }
+    void set(std::uint64_t t) { ticks = t; }
+};
+
+/* TimerWheel
+ ******************************************************************************
+ *
+ * timers keyed by a deadline in ticks of Clock. most timers are cancelled
+ * long before they fire, so adding and cancelling one must not cost a heap
+ * operation.
+ *
+ * the wheel has four levels of 64 slots. a timer is kept at the level of
+ * the highest 6-bit group of its deadline that differs from the current
+ * tick, in the slot given by that group of the deadline. a slot is then a
+ * doubly linked list, so adding and cancelling a timer is O(1). when the
+ * current tick enters the range of a slot, its timers move down to the
+ * levels below, and the timers of a level 0 slot fire. a timer therefore
+ * moves at most four times. a bitmap of occupied slots per level lets
+ * advance jump straight to the next tick with work to do.
+ *
+ * the levels reach 2^24 ticks, about 4.6 hours of MonotonicClock. a later
+ * deadline goes to an overflow FibHeap, which hands its timers to the wheel
+ * when the current tick reaches their 2^24-tick period. cancelling an
+ * overflow timer is an erase from the heap.
+ *
+ * timers live in one vector and are named by index and generation, so a
+ * handle to a timer that has fired or been cancelled is detected and
+ * ignored.
+ *
+ * Operations:
+ *
+ * -    add(deadline, args...), add_after(delay, args...):
+ *          O(1), or O(1) amortized for an overflow deadline. the payload is
+ *          constructed from args. a deadline not after now() fires at the
+ *          next tick
+ *
+ * -    cancel(h):
+ *          O(1), or O(log n) amortized for an overflow timer. false if the
+ *          timer has fired or been cancelled
+ *
+ * -    advance(to, fire), poll(fire):
+ *          moves the current tick to to, or to the clock's time, and calls
+ *          fire(deadline, value) for every timer that expires on the way, in
+ *          deadline order. O(1) amortized per timer plus O(1) per tick with
+ *          work to do. fire may add and cancel timers, but not advance
+ *
+ * -    next_event():
+ *          the next tick at which advance has work to do, which is never
+ *          after the earliest deadline
+ *
+ */
+
+template <class Value = void, class Clock = MonotonicClock>
+class TimerWheel {
+
+public:
+    typedef std::uint64_t tick_type;
+    typedef typename HeapValue<Value>::type value_type;
+    typedef std::uint32_t index_type;
+
+    // EXCEPTIONS
+    // thrown by add when every index is in use
+    class Full {};
+
+    // HANDLES
+    // names a timer. it is ignored by cancel once the timer has gone
+    class handle {
+        friend class TimerWheel;
+        index_type index;
+        std::uint32_t generation;
+        handle(index_type i, std::uint32_t g) : index(i), generation(g) {}
+    public:
+        handle() : index(NIL), generation(0) {}
+        bool operator==(const handle &h) const {
+            return index == h.index && generation == h.generation;
+        }
+        bool operator!=(const handle &h) const { return !(*this == h); }
+    };
+
+private:
+    static const index_type NIL = 0xffffffffu;
+    static const int BITS = 6;
+    static const int SLOTS = 1 << BITS;
+    static const int LEVELS = 4;
+    // deadlines differing from the current tick above this bit overflow
+    static const int SPAN = BITS * LEVELS;
+    // links 0 to SLOTS * LEVELS - 1 head the slot lists, the next one the
+    // list of timers about to fire, and the rest belong to timers
+    static const index_type FIRING = SLOTS * LEVELS;
+    static const index_type SENTINELS = FIRING + 1;
+
+    enum State {
+        FREE,
+        WHEEL,
+        OVERFLOW
+    };
+
+    struct Link {
+        index_type next;
+        index_type prev;
+    };
+
+    typedef FibHeap<tick_type, index_type> Heap;
+
+    struct Timer {
+        tick_type deadline;
+        std::uint32_t generation;
+        State state;
+        typename Heap::handle overflow;
+        value_type value;
+
+        template <class... Args>
+        Timer(tick_type d, Args&&... args) :
+            deadline(d), generation(0), state(WHEEL),
+            value(std::forward<Args>(args)...) {}
+    };
+
+    // VARIABLES
+    Clock own;
+    Clock* clock;
+    std::vector<Link> links;
+    std::vector<Timer> timers;
+    // one bit per slot that may hold timers; cancel leaves bits set
+    std::uint64_t occupied[LEVELS];
+    Heap overflow;
+    index_type free_timer;
+    tick_type current;
+    size_t n;
+
+    // FUNCTIONS
+    Timer& timer(index_type i) { return timers[i - SENTINELS]; }
+
+    // places i at the end of the list headed by sentinel s
+    void Append(index_type s, index_type i) {
+        links[i].next = s;
+        links[i].prev = links[s].prev;
+        links[links[s].prev].next = i;
+        links[s].prev = i;
+    }
+
+    void Unlink(index_type i) {
+        links[links[i].prev].next = links[i].next;
+        links[links[i].next].prev = links[i].prev;
+    }
+
+    bool Empty(index_type s) const { return links[s].next == s; }
+
+    // the position of the highest set bit of a non-zero x
+    static int HighestBit(tick_type x) {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(static_cast<unsigned long long>(x));
+#else
+        int b = -1;
+        while ( x != 0 ) {
+            x >>= 1;
+            b++;
+        }
+        return b;
+#endif
+    }
+
+    static int LowestBit(std::uint64_t x) {
+#if defined(__GNUC__)
+        return __builtin_ctzll(static_cast<unsigned long long>(x));
+#else
+        int b = 0;
+        while ( !(x & 1) ) {
+            x >>= 1;
+            b++;
+        }
+        return b;
+#endif
+    }
+
+    // files timer i by its deadline relative to the current tick
+    void Place(index_type i) {
+        Timer &t = timer(i);
+        if ( t.deadline <= current ) {
+            t.state = WHEEL;
+            Append(FIRING, i);
+        }
+        else if ( (t.deadline >> SPAN) != (current >> SPAN) ) {
+            t.overflow = overflow.insert(t.deadline, i);
+            t.state = OVERFLOW;
+        }
+        else {
+            int level = HighestBit(t.deadline ^ current) / BITS;
+            int slot = (t.deadline >> (BITS * level)) & (SLOTS - 1);
+            t.state = WHEEL;
+            Append(level * SLOTS + slot, i);
+            occupied[level] |= std::uint64_t(1) << slot;
+        }
+    }
+
+    // refiles every timer of the slot list headed by s
+    void Cascade(index_type s) {
+        while ( !Empty(s) ) {
+            index_type i = links[s].next;
+            Unlink(i);
+            Place(i);
+        }
+    }
+
+    // the next tick after the current one at which a slot is reached or the
+    // overflow heap is due, if there is one
+    bool Next(tick_type &next) {
+        bool found = false;
+        next = std::numeric_limits<tick_type>::max();
+        for ( int level = 0; level < LEVELS; level++ ) {
+            int shift = BITS * level;
+            int group = (current >> shift) & (SLOTS - 1);
+            // only slots after the current group can hold timers
+            std::uint64_t later = occupied[level] &
+                                  ~((std::uint64_t(2) << group) - 1);
+            while ( later != 0 ) {
+                int slot = LowestBit(later);
+                if ( Empty(level * SLOTS + slot) ) {
+                    occupied[level] &= ~(std::uint64_t(1) << slot);
+                    later &= later - 1;
+                    continue;
+                }
+                tick_type base = current >> (shift + BITS) << (shift + BITS);
+                tick_type tick = base | (tick_type(slot) << shift);
+                if ( !found || tick < next ) {
+                    next = tick;
+                    found = true;
+                }
+                break;
+            }
+        }
+        if ( !overflow.empty() ) {
+            tick_type tick = overflow.min() >> SPAN << SPAN;
+            if ( !found || tick < next ) {
+                next = tick;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    // makes t the current tick, which must be the next one with work to do,
+    // and fires its timers
+    template <class Callback>
+    size_t Step(tick_type t, Callback &fire) {
+        current = t;
+        if ( (t & ((tick_type(1) << SPAN) - 1)) == 0 ) {
+            while ( !overflow.empty() && (overflow.min() >> SPAN) == (t >> SPAN) ) {
+                index_type i;
+                overflow.extractMin(i);
+                Place(i);
+            }
+        }
+        for ( int level = LEVELS - 1; level >= 0; level-- ) {
+            int shift = BITS * level;
+            if ( (t & ((tick_type(1) << shift) - 1)) == 0 ) {
+                int slot = (t >> shift) & (SLOTS - 1);
+                occupied[level] &= ~(std::uint64_t(1) << slot);
+                Cascade(level * SLOTS + slot);
+            }
+        }
+        size_t fired = 0;
+        while ( !Empty(FIRING) ) {
+            index_type i = links[FIRING].next;
+            Unlink(i);
+            tick_type deadline = timer(i).deadline;
+            value_type value(std::move(timer(i).value));
+            Release(i);
+            fired++;
+            fire(deadline, value);
+        }
+        return fired;
+    }
+
+    void Release(index_type i) {
+        Timer &t = timer(i);
+        // releases the payload's resources now rather than when reused
+        ReleaseValue(t.value);
+        t.generation++;
+        t.state = FREE;
+        links[i].next = free_timer;
+        free_timer = i;
+        n--;
+    }
+
+    void Initialize() {
+        links.resize(SENTINELS);
+        for ( index_type s = 0; s < SENTINELS; s++ ) {
+            links[s].next = links[s].prev = s;
+        }
+        for ( int level = 0; level < LEVELS; level++ ) {
+            occupied[level] = 0;
+        }
+    }
+
+public:
+    // CONSTRUCTORS
+    // a wheel reading its own default-constructed clock
+    TimerWheel() : clock(&own), free_timer(NIL), current(own.now()), n(0) {
+        Initialize();
+    }
+
+    // a wheel reading c, which must outlive it
+    explicit TimerWheel(Clock &c) :
+        clock(&c), free_timer(NIL), current(c.now()), n(0) {
+        Initialize();
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // FUNCTIONS
+    size_t size() const { return n; }
+
+    bool empty() const { return n == 0; }
+
+    // the last tick the wheel has advanced to
+    tick_type now() const { return current; }
+
+    // reserves room for count timers
+    void reserve(size_t count) {
+        links.reserve(SENTINELS + count);
+        timers.reserve(count);
+    }
+
+    // arms a timer for the given tick, constructing its payload from args
+    template <class... Args>
+    handle add(tick_type deadline, Args&&... args) {
+        if ( deadline <= current ) {
+            deadline = current + 1;
+        }
+        index_type i;
+        if ( free_timer != NIL ) {
+            i = free_timer;
+            free_timer = links[i].next;
+            timer(i).deadline = deadline;
+            ReplaceValue(timer(i).value, std::forward<Args>(args)...);
+        }
+        else {
+            if ( links.size() >= NIL ) {
+                throw Full();
+            }
+            timers.emplace_back(deadline, std::forward<Args>(args)...);
+            i = static_cast<index_type>(links.size());
+            links.push_back(Link());
+        }
+        n++;
+        try {
+            Place(i);
+        }
+        catch ( ... ) {
+            Release(i);
+            throw;
+        }
+        return handle(i, timer(i).generation);
+    }
+
+    // arms a timer for delay ticks after the clock's time
+    template <class... Args>
+    handle add_after(tick_type delay, Args&&... args) {
+        return add(clock->now() + delay, std::forward<Args>(args)...);
+    }
+
+    // whether h names a timer that has neither fired nor been cancelled
+    bool active(handle h) const {
+        return h.index >= SENTINELS && h.index < links.size() &&
+               timers[h.index - SENTINELS].generation == h.generation &&
+               timers[h.index - SENTINELS].state != FREE;
+    }
+
+    // the deadline and payload of an active timer
+    tick_type deadline(handle h) const {
+        return timers[h.index - SENTINELS].deadline;
+    }
+    value_type& value(handle h) { return timer(h.index).value; }
+
+    // disarms a timer, and returns whether it was active
+    bool cancel(handle h) {
+        if ( !active(h) ) {
+            return false;
+        }
+        Timer &t = timer(h.index);
+        if ( t.state == OVERFLOW ) {
+            overflow.erase(t.overflow);
+        }
+        else {
+            Unlink(h.index);
+        }
+        Release(h.index);
+        return true;
+    }
+
+    // a tick at or before the earliest deadline, or the largest tick when
+    // no timer is active
+    tick_type next_event() {
+        tick_type next;
+        Next(next);
+        return next;
+    }
+
+    // fires every timer due by tick to and returns how many fired
+    template <class Callback>
+    size_t advance(tick_type to, Callback fire) {
+        size_t fired = 0;
+        tick_type next;
+        while ( current < to && Next(next) && next <= to ) {
+            fired += Step(next, fire);
+        }
+        if ( current < to ) {
+            current = to;
+        }
+        return fired;
+    }
+
+    // fires every timer due by the clock's time
+    template <class Callback>
+    size_t poll(Callback fire) {
+        return advance(clock->now(), fire);
+    }
+};
+
+template <class Value, class Clock>
+const typename TimerWheel<Value, Clock>::index_type TimerWheel<Value, Clock>::NIL;
+template <class Value, class Clock>
+const typename TimerWheel<Value, Clock>::index_type
+    TimerWheel<Value, Clock>::SENTINELS;
+
+#endif
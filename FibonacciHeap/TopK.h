@@ -0,0 +1,125 @@
+#ifndef TOPK_H_
+#define TOPK_H_
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "FibHeap.h"
+#include "HeapValue.h"
+
+/* TopK
+ ******************************************************************************
+ *
+ * the k greatest keys of a stream, with their payloads, in memory for k
+ * items however long the stream. the kept items sit in a heap whose minimum
+ * is the least of them, the threshold: once k items are kept, a key that
+ * does not come after the threshold is rejected with one comparison and no
+ * other work, and a key that does replaces the threshold item. the heap's
+ * nodes are freed into its pool and reused, so a full TopK allocates
+ * nothing. for the k least keys, use std::greater as Compare.
+ *
+ * every thread of a parallel scan may keep a TopK of its own part; merge
+ * then combines two of them into the k greatest of both.
+ *
+ * Heap may be any engine in this directory with the same key, payload and
+ * comparator; the default is FibHeap.
+ *
+ * Operations:
+ *
+ * -    offer(key, args...):
+ *          O(1) when rejected, else O(log k) amortized. the payload is
+ *          constructed from args only when the key is kept
+ *
+ * -    threshold():
+ *          O(1). the least key kept, which a key must come after to be
+ *          kept once the TopK is full
+ *
+ * -    merge(other):
+ *          O(k log k) amortized; leaves other empty
+ *
+ * -    take():
+ *          O(k log k). empties the TopK and returns its items, greatest
+ *          first
+ *
+ */
+
+template <class T, class Value = void, class Compare = std::less<T>,
+          class Heap = FibHeap<T, Value, Compare> >
+class TopK {
+
+public:
+    typedef T key_type;
+    typedef typename HeapValue<Value>::type value_type;
+    typedef Compare key_compare;
+
+private:
+    // VARIABLES
+    Compare compare;
+    Heap heap;
+    size_t k;
+    size_t n;
+
+    // FUNCTIONS
+    // drops the least items until at most k are left
+    void Trim() {
+        for ( ; n > k; n-- ) {
+            heap.extractMin();
+        }
+    }
+
+public:
+    // CONSTRUCTORS
+    explicit TopK(size_t capacity, const Compare &cmp = Compare()) :
+        compare(cmp), heap(cmp), k(capacity), n(0) {}
+
+    // FUNCTIONS
+    size_t size() const { return n; }
+
+    bool empty() const { return n == 0; }
+
+    bool full() const { return n >= k; }
+
+    size_t capacity() const { return k; }
+
+    // the least key kept. the TopK must not be empty
+    const T& threshold() { return heap.key(heap.top()); }
+
+    // keeps key if it is among the k greatest so far, and returns whether
+    // it was kept
+    template <class... Args>
+    bool offer(const T &key, Args&&... args) {
+        if ( n >= k ) {
+            if ( k == 0 || !compare(heap.key(heap.top()), key) ) {
+                return false;
+            }
+            heap.extractMin();
+            n--;
+        }
+        heap.emplace(key, std::forward<Args>(args)...);
+        n++;
+        return true;
+    }
+
+    // keeps the k greatest items of both, leaving other empty
+    void merge(TopK &&other) {
+        if ( &other == this ) {
+            return;
+        }
+        heap.merge(std::move(other.heap));
+        n += other.n;
+        other.n = 0;
+        Trim();
+    }
+
+    // empties the TopK and returns its items, greatest first
+    std::vector<std::pair<T, value_type> > take() {
+        std::vector<std::pair<T, value_type> > items(n);
+        for ( ; n > 0; n-- ) {
+            items[n - 1].first = heap.extractMin(items[n - 1].second);
+        }
+        return items;
+    }
+};
+
+#endif
@@ -0,0 +1,894 @@
+/* bench
+ ******************************************************************************
+ *
+ * micro-benchmarks for FibHeap.
+ *
+ *      bench [--size n] [--ops m] [--graph file.gr]
+ *
+ * every benchmark starts from a heap of n random keys (default 10^6) and
+ * times m operations (default 10^5), once for each engine: FibHeap
+ * ("fibheap"), CompactFibHeap ("compact") and PairingHeap with two-pass
+ * ("pairing") and multipass ("pairing_multipass") pairing, and DaryHeap with
+ * arity 2, 4 and 8 ("dary2", "dary4", "dary8"). the build benchmark times the
+ * n insertions themselves and copy a single copy of a consolidated heap of n
+ * keys, both reported per element. build_range and build_parallel time the
+ * same n keys through FibHeap's insert_range and insert_range_parallel, the
+ * latter on every hardware thread. pop_k<k> pops m keys in batches of k,
+ * by calling extractMin k times ("fibheap") or extract_k once
+ * ("fibheap_extract_k"), and reports the time per key. decrease mixes three
+ * decrease_key calls on random live nodes with every extract-min, as a
+ * shortest path search does. monotone does the same with integer keys that
+ * never go below the last minimum, and adds RadixHeap ("radix").
+ *
+ * concurrent runs alternating pushes and pops on p threads, for p = 1, 2, 4
+ * and 8, against one DaryHeap behind a mutex ("locked_t<p>") and a
+ * MultiQueue in relaxed ("multiqueue_t<p>") and strict
+ * ("multiqueue_strict_t<p>") mode; m is the total over all threads.
+ * executor submits m empty tasks of random priority to an Executor of p
+ * workers ("executor_t<p>") and times them until all have run; the
+ * scheduling latency histogram of each run is written to stderr. timers
+ * keeps n timeouts of up to 10^4 ticks armed while adding m more, cancelling
+ * nine of every ten before they are due and advancing the time by one tick
+ * every 16 additions, on a TimerWheel ("wheel") and on a FibHeap that erases
+ * cancelled timers and extracts due ones ("fibheap").
+ *
+ * external sorts a file of n random 8-byte records in /tmp with memory for
+ * n/64 of them: runs times run generation, and merge the merge of the runs
+ * through FibHeap ("fibheap"), PairingHeap ("pairing") and DaryHeap
+ * ("dary4"), per record; the throughput in MB/s is written to stderr.
+ *
+ * dijkstra runs full shortest path searches from 4 random sources on a
+ * road-like graph, and reports the time per settled vertex: ShortestPaths
+ * on FibHeap, PairingHeap, DaryHeap and RadixHeap, against the usual
+ * std::priority_queue search that pushes a vertex again on every
+ * improvement and skips stale entries ("lazy_binary"). the graph is read
+ * from a DIMACS .gr file given with --graph, or else is a square grid of
+ * about n vertices with random weights from 1 to 1000. prim times a minimum
+ * spanning forest of the same graph taken as undirected, per vertex.
+ *
+ * topk keeps the 1000 greatest of n random keys in a TopK on FibHeap
+ * ("fibheap"), PairingHeap ("pairing") and DaryHeap ("dary4"), against
+ * inserting all n into a FibHeap and popping 1000 ("insert_all"), per key.
+ *
+ * soft inserts n random keys and extracts them all from a SoftHeap with
+ * epsilon 0.1 ("soft_0.1") and 0.01 ("soft_0.01") and from a FibHeap
+ * ("fibheap"), per key; the fraction of keys that came out corrupted, and
+ * the largest distance between the rank of a key and the step it came out
+ * at, as a fraction of n, are written to stderr. select finds the median of
+ * n random keys with approximate_median at epsilon 0.1 ("soft_median"),
+ * soft_select ("soft_select") and std::nth_element ("nth_element"), per key.
+ *
+ * snapshot saves a FibHeap of n random keys with payloads, left in its
+ * consolidated shape by m extractions, to a file in /tmp ("save"), reads it
+ * back with restore ("restore"), and against that reads the same keys and
+ * payloads from a flat file and inserts them one by one, then extracts one
+ * so the forest is consolidated again ("reinsert"), per node. journal times
+ * m operations on a DurableHeap of n items, an insert, a decrease_key and
+ * an extraction in turn, each journaled to /tmp ("durable"), against the
+ * same on a FibHeap ("fibheap"), and a checkpoint of the DurableHeap, per
+ * item ("checkpoint").
+ *
+ * allocations are counted by replacing the global operator new, so
+ * allocs_per_op shows any call into the allocator on the measured path and
+ * bytes_per_op the growth of live heap memory over it; for build this is the
+ * memory per element. results are written as CSV:
+ *
+ *      benchmark,engine,n,ops,ns_per_op,allocs_per_op,bytes_per_op
+ *
+ * build:
+ *      g++ -O2 -std=c++11 -pthread bench.cpp -o bench
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+#include "CompactFibHeap.h"
+#include "DaryHeap.h"
+#include "DurableHeap.h"
+#include "Executor.h"
+#include "ExternalSort.h"
+#include "FibHeap.h"
+#include "Graph.h"
+#include "MultiQueue.h"
+#include "PairingHeap.h"
+#include "RadixHeap.h"
+#include "SoftHeap.h"
+#include "TimerWheel.h"
+#include "TopK.h"
+
+using namespace std;
+
+// atomic because the threaded benchmarks allocate from several threads;
+// relaxed, as only the totals between two measurements matter
+static atomic<unsigned long long> allocations(0);
+static atomic<long long> live_bytes(0);
+
+// every block carries its size in a header in front of it, so that delete
+// can account for the bytes it frees
+static const size_t HEADER = alignof(max_align_t);
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    char* memory = static_cast<char*>(malloc(HEADER + size));
+    if ( !memory ) {
+        throw bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(memory) = size;
+    live_bytes.fetch_add(static_cast<long long>(size), memory_order_relaxed);
+    return memory + HEADER;
+}
+
+void operator delete(void* memory) noexcept {
+    if ( memory ) {
+        // through an integer, as the compiler cannot see that memory came
+        // from the operator new above and warns about the offset otherwise
+        char* block = reinterpret_cast<char*>(
+            reinterpret_cast<uintptr_t>(memory) - HEADER);
+        live_bytes.fetch_sub(static_cast<long long>(*reinterpret_cast<size_t*>(block)),
+                             memory_order_relaxed);
+        free(block);
+    }
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    operator delete(memory);
+}
+
+typedef chrono::steady_clock Clock;
+
+struct Measurement {
+    Clock::time_point start;
+    unsigned long long first_allocations;
+    long long first_live_bytes;
+
+    Measurement() : start(Clock::now()),
+                    first_allocations(allocations.load(memory_order_relaxed)),
+                    first_live_bytes(live_bytes.load(memory_order_relaxed)) {}
+
+    void report(const char* benchmark, const char* engine, int n, int ops) {
+        double elapsed = chrono::duration<double>(Clock::now() - start).count();
+        printf("%s,%s,%d,%d,%.1f,%.4f,%.1f\n", benchmark, engine, n, ops,
+               elapsed * 1e9 / ops,
+               static_cast<double>(allocations.load(memory_order_relaxed) -
+                                   first_allocations) / ops,
+               static_cast<double>(live_bytes.load(memory_order_relaxed) -
+                                   first_live_bytes) / ops);
+        fflush(stdout);
+    }
+};
+
+// PairingHeap with multipass pairing, constructible without arguments
+template <class T, class Value = void>
+struct MultipassHeap : PairingHeap<T, Value> {
+    MultipassHeap() : PairingHeap<T, Value>(PairingHeap<T, Value>::MULTIPASS) {}
+};
+
+mt19937_64 generator(12345);
+
+vector<double> randomKeys(int n) {
+    uniform_real_distribution<double> key(0, 1);
+    vector<double> keys(n);
+    for ( int i = 0; i < n; i++ ) {
+        keys[i] = key(generator);
+    }
+    return keys;
+}
+
+// n insertions into an empty heap
+template <class Heap>
+void benchmarkBuild(const char* engine, int n) {
+    vector<double> keys = randomKeys(n);
+    Measurement measurement;
+    Heap heap;
+    for ( int i = 0; i < n; i++ ) {
+        heap.insert(keys[i]);
+    }
+    measurement.report("build", engine, n, n);
+}
+
+// n insertions in one call of insert_range, or of insert_range_parallel on
+// every hardware thread
+void benchmarkBuildRange(bool parallel, int n) {
+    vector<double> keys = randomKeys(n);
+    unsigned int threads = thread::hardware_concurrency();
+    Measurement measurement;
+    FibHeap<double> heap;
+    if ( parallel ) {
+        heap.insert_range_parallel(keys.begin(), keys.end(),
+                                   threads ? threads : 1);
+        measurement.report("build_parallel", "fibheap", n, n);
+    }
+    else {
+        heap.insert_range(keys.begin(), keys.end());
+        measurement.report("build_range", "fibheap", n, n);
+    }
+}
+
+// one copy of a heap whose forest has been consolidated
+template <class Heap>
+void benchmarkCopy(const char* engine, int n, int ops) {
+    vector<double> keys = randomKeys(n + ops);
+    Heap heap;
+    for ( int i = 0; i < n + ops; i++ ) {
+        heap.insert(keys[i]);
+    }
+    for ( int i = 0; i < ops; i++ ) {
+        heap.extractMin();
+    }
+    Measurement measurement;
+    Heap copy(heap);
+    measurement.report("copy", engine, n, n);
+}
+
+// extract-min from a full heap, after one warm-up pass that leaves every
+// freed node on the free list
+template <class Heap>
+void benchmarkPop(const char* engine, int n, int ops) {
+    vector<double> keys = randomKeys(n + ops);
+    Heap heap;
+    for ( int i = 0; i < n + ops; i++ ) {
+        heap.insert(keys[i]);
+    }
+    for ( int i = 0; i < ops; i++ ) {
+        heap.extractMin();
+    }
+    volatile double sink = 0;
+    Measurement measurement;
+    for ( int i = 0; i < ops; i++ ) {
+        sink = heap.extractMin();
+    }
+    measurement.report("pop", engine, n, ops);
+    (void)sink;
+}
+
+// m operations, three decreases to every extraction, on a heap of n nodes
+template <class Heap>
+void benchmarkDecrease(const char* engine, int n, int ops) {
+    vector<double> keys = randomKeys(n);
+    vector<typename Heap::handle> handles(n);
+    vector<char> present(n, 1);
+    uniform_int_distribution<int> node(0, n - 1);
+    uniform_real_distribution<double> factor(0, 1);
+    Heap heap;
+    for ( int i = 0; i < n; i++ ) {
+        handles[i] = heap.insert(keys[i], i);
+    }
+    int extracted;
+    volatile double sink = heap.extractMin(extracted);
+    present[extracted] = 0;
+    Measurement measurement;
+    for ( int i = 0; i < ops; i++ ) {
+        if ( i % 4 == 3 ) {
+            sink = heap.extractMin(extracted);
+            present[extracted] = 0;
+        }
+        else {
+            int x = node(generator);
+            if ( present[x] ) {
+                heap.decrease_key(handles[x],
+                                  heap.key(handles[x]) * factor(generator));
+            }
+        }
+    }
+    measurement.report("decrease", engine, n, ops);
+    (void)sink;
+}
+
+// as benchmarkDecrease, with integer keys that stay at or above the last
+// minimum: every extraction of key k pushes a node with a key in
+// [k, k + 2^20), and decreases never go below k
+template <class Heap>
+void benchmarkMonotone(const char* engine, int n, int ops) {
+    const long long RANGE = 1 << 20;
+    uniform_int_distribution<long long> key(0, RANGE - 1);
+    uniform_int_distribution<int> node(0, n - 1);
+    vector<typename Heap::handle> handles(n);
+    vector<char> present(n, 1);
+    Heap heap;
+    for ( int i = 0; i < n; i++ ) {
+        handles[i] = heap.insert(key(generator), i);
+    }
+    int extracted;
+    long long least = heap.extractMin(extracted);
+    present[extracted] = 0;
+    Measurement measurement;
+    for ( int i = 0; i < ops; i++ ) {
+        if ( i % 4 == 3 ) {
+            least = heap.extractMin(extracted);
+            handles[extracted] = heap.insert(least + key(generator), extracted);
+        }
+        else {
+            int x = node(generator);
+            if ( present[x] ) {
+                long long current = heap.key(handles[x]);
+                heap.decrease_key(handles[x], least + (current - least) / 2);
+            }
+        }
+    }
+    measurement.report("monotone", engine, n, ops);
+}
+
+// a DaryHeap behind one mutex, with the interface of a MultiQueue
+class LockedHeap {
+private:
+    mutex lock;
+    DaryHeap<double> heap;
+public:
+    void push(double key) {
+        lock_guard<mutex> guard(lock);
+        heap.insert(key);
+    }
+    bool try_pop(double &key) {
+        lock_guard<mutex> guard(lock);
+        if ( heap.empty() ) {
+            return false;
+        }
+        key = heap.extractMin();
+        return true;
+    }
+};
+
+// m alternating pushes and pops shared among p threads, on a queue of n keys
+template <class Queue>
+void benchmarkConcurrent(Queue &queue, const char* engine, int threads,
+                         int n, int ops) {
+    vector<double> keys = randomKeys(n + ops);
+    for ( int i = 0; i < n; i++ ) {
+        queue.push(keys[i]);
+    }
+    char name[48];
+    snprintf(name, sizeof(name), "%s_t%d", engine, threads);
+    vector<thread> workers;
+    Measurement measurement;
+    for ( int t = 0; t < threads; t++ ) {
+        workers.push_back(thread([&, t]() {
+            double key;
+            for ( int i = n + t; i < n + ops; i += threads ) {
+                queue.push(keys[i]);
+                queue.try_pop(key);
+            }
+        }));
+    }
+    for ( int t = 0; t < threads; t++ ) {
+        workers[t].join();
+    }
+    measurement.report("concurrent", name, n, ops);
+}
+
+// m empty tasks of random priority run by p workers
+void benchmarkExecutor(int threads, int ops) {
+    vector<double> keys = randomKeys(ops);
+    char name[48];
+    snprintf(name, sizeof(name), "executor_t%d", threads);
+    Executor<double> executor(threads);
+    Measurement measurement;
+    for ( int i = 0; i < ops; i++ ) {
+        executor.submit([]() {}, keys[i]);
+    }
+    executor.wait();
+    measurement.report("executor", name, 0, ops);
+    cerr << name << " latency ";
+    executor.latency().dump(cerr);
+    cerr << endl;
+}
+
+// the timers benchmark on a FibHeap keyed by deadline
+class HeapTimers {
+private:
+    FibHeap<unsigned long long> heap;
+    unsigned long long time;
+public:
+    typedef FibHeap<unsigned long long>::handle handle;
+    HeapTimers() : time(0) {}
+    handle add(unsigned long long deadline) { return heap.insert(deadline); }
+    void cancel(handle h) { heap.erase(h); }
+    void advance(unsigned long long to) {
+        time = to;
+        while ( !heap.empty() && heap.min() <= time ) {
+            heap.extractMin();
+        }
+    }
+};
+
+// the timers benchmark on a TimerWheel
+class WheelTimers {
+private:
+    FakeClock clock;
+    TimerWheel<void, FakeClock> wheel;
+public:
+    typedef TimerWheel<void, FakeClock>::handle handle;
+    WheelTimers() : wheel(clock) {}
+    handle add(unsigned long long deadline) { return wheel.add(deadline); }
+    void cancel(handle h) { wheel.cancel(h); }
+    void advance(unsigned long long to) {
+        wheel.advance(to, [](unsigned long long, NoValue&) {});
+    }
+};
+
+// n armed timeouts, then m additions of which nine in ten are cancelled
+// n additions later, before they are due
+template <class Timers>
+void benchmarkTimers(const char* engine, int n, int ops) {
+    vector<double> keys = randomKeys(n + ops);
+    vector<typename Timers::handle> armed(n);
+    vector<unsigned long long> due(n);
+    Timers timers;
+    unsigned long long time = 0;
+    for ( int i = 0; i < n; i++ ) {
+        due[i] = time + 1 + static_cast<unsigned long long>(keys[i] * 10000);
+        armed[i] = timers.add(due[i]);
+    }
+    Measurement measurement;
+    for ( int i = n; i < n + ops; i++ ) {
+        int k = i % n;
+        if ( k % 10 != 0 && due[k] > time ) {
+            timers.cancel(armed[k]);
+        }
+        due[k] = time + 1 + static_cast<unsigned long long>(keys[i] * 10000);
+        armed[k] = timers.add(due[k]);
+        if ( i % 16 == 0 ) {
+            timers.advance(++time);
+        }
+    }
+    measurement.report("timers", engine, n, ops);
+}
+
+// prints the throughput over n 8-byte records to stderr
+void reportThroughput(const char* benchmark, const char* engine, int n,
+                      Clock::time_point start) {
+    double elapsed = chrono::duration<double>(Clock::now() - start).count();
+    cerr << benchmark << "_" << engine << " MB/s " << n * 8.0 / 1e6 / elapsed
+         << endl;
+}
+
+// run generation of n records in memory for n/64, then a merge of the runs
+template <class Heap>
+void benchmarkExternal(const char* engine, int n) {
+    const char* input = "/tmp/bench_sort.in";
+    const char* output = "/tmp/bench_sort.out";
+    {
+        RunWriter<unsigned long long> writer(input, 1 << 16);
+        for ( int i = 0; i < n; i++ ) {
+            writer.write(generator());
+        }
+    }
+    ExternalSort<unsigned long long, less<unsigned long long>, Heap>
+        sorter("/tmp/bench_sort.run", n / 64 + 1);
+    Measurement runs;
+    Clock::time_point start = Clock::now();
+    vector<string> names = sorter.runs(input);
+    runs.report("external_runs", engine, n, n);
+    reportThroughput("external_runs", engine, n, start);
+    Measurement merge;
+    start = Clock::now();
+    sorter.merge(names, output);
+    merge.report("external_merge", engine, n, n);
+    reportThroughput("external_merge", engine, n, start);
+    remove(input);
+    remove(output);
+}
+
+// a key and payload as written to a flat file
+struct Saved {
+    double key;
+    unsigned int value;
+};
+
+// a heap of n keys saved, restored and rebuilt by insertion
+void benchmarkSnapshot(int n, int ops) {
+    typedef FibHeap<double, unsigned int> Heap;
+    const char* path = "/tmp/bench_snapshot.bin";
+    const char* flat = "/tmp/bench_snapshot.flat";
+    vector<double> keys = randomKeys(n + ops);
+    Heap heap;
+    for ( int i = 0; i < n + ops; i++ ) {
+        heap.insert(keys[i], i);
+    }
+    for ( int i = 0; i < ops; i++ ) {
+        heap.extractMin();
+    }
+    {
+        RunWriter<Saved> writer(flat, 1 << 16);
+        for ( int i = 0; i < n + ops; i++ ) {
+            Saved item = { keys[i], static_cast<unsigned int>(i) };
+            writer.write(item);
+        }
+    }
+    Measurement save;
+    FILE* file = fopen(path, "wb");
+    heap.save(file);
+    fclose(file);
+    save.report("snapshot", "save", n, n);
+    {
+        Measurement restore;
+        Heap restored;
+        file = fopen(path, "rb");
+        restored.restore(file);
+        fclose(file);
+        restore.report("snapshot", "restore", n, n);
+    }
+    {
+        Measurement reinsert;
+        Heap rebuilt;
+        RunReader<Saved> reader(flat, 1 << 16);
+        for ( int i = 0; i < n; i++ ) {
+            const Saved* item = reader.next();
+            rebuilt.insert(item->key, item->value);
+        }
+        rebuilt.insert(-1.0, 0);
+        rebuilt.extractMin();
+        reinsert.report("snapshot", "reinsert", n, n);
+    }
+    remove(path);
+    remove(flat);
+}
+
+// m journaled operations on a DurableHeap of n items, then a checkpoint
+template <class Heap>
+void benchmarkJournal(Heap &heap, const char* engine, int n, int ops) {
+    vector<double> keys = randomKeys(n + ops);
+    vector<typename Heap::handle> live;
+    for ( int i = 0; i < n; i++ ) {
+        live.push_back(heap.insert(keys[i], i));
+    }
+    Measurement measurement;
+    for ( int i = 0; i + 3 <= ops; i += 3 ) {
+        live.push_back(heap.insert(keys[n + i], i));
+        heap.decrease_key(live[i], heap.key(live[i]) - 1);
+        heap.extractMin();
+    }
+    measurement.report("journal", engine, n, ops / 3 * 3);
+}
+
+// DurableHeap named by id rather than handle, for benchmarkJournal
+struct JournaledHeap : DurableHeap<double, int> {
+    typedef id_type handle;
+    JournaledHeap() : DurableHeap<double, int>("/tmp/bench_journal") {}
+};
+
+typedef Graph<long long> RoadGraph;
+
+// a grid of about n vertices, each joined to its right and lower neighbours
+// in both directions
+RoadGraph gridGraph(int n) {
+    int side = 1;
+    while ( (side + 1) * (side + 1) <= n ) {
+        side++;
+    }
+    uniform_int_distribution<long long> weight(1, 1000);
+    vector<RoadGraph::Edge> edges;
+    for ( int r = 0; r < side; r++ ) {
+        for ( int c = 0; c < side; c++ ) {
+            RoadGraph::vertex_type v = r * side + c;
+            if ( c + 1 < side ) {
+                RoadGraph::Edge e = { v, v + 1, weight(generator) };
+                edges.push_back(e);
+            }
+            if ( r + 1 < side ) {
+                RoadGraph::Edge e = { v, v + side, weight(generator) };
+                edges.push_back(e);
+            }
+        }
+    }
+    return RoadGraph(side * side, edges, true);
+}
+
+// the sources of the dijkstra benchmark
+vector<RoadGraph::vertex_type> randomSources(const RoadGraph &g) {
+    vector<RoadGraph::vertex_type> sources;
+    for ( int i = 0; i < 4; i++ ) {
+        sources.push_back(generator() % g.vertices());
+    }
+    return sources;
+}
+
+template <class Heap>
+void benchmarkDijkstra(const char* engine, const RoadGraph &g) {
+    vector<RoadGraph::vertex_type> sources = randomSources(g);
+    ShortestPaths<long long, Heap> paths(g);
+    size_t settled = 0;
+    Measurement measurement;
+    for ( size_t i = 0; i < sources.size(); i++ ) {
+        paths.run(sources[i]);
+        settled += paths.settled();
+    }
+    measurement.report("dijkstra", engine, g.vertices(), static_cast<int>(settled));
+}
+
+// Dijkstra on a binary heap without decrease_key
+void benchmarkLazyDijkstra(const RoadGraph &g) {
+    typedef pair<long long, RoadGraph::vertex_type> Entry;
+    vector<RoadGraph::vertex_type> sources = randomSources(g);
+    vector<long long> distance(g.vertices());
+    vector<char> done(g.vertices());
+    size_t settled = 0;
+    Measurement measurement;
+    for ( size_t i = 0; i < sources.size(); i++ ) {
+        fill(distance.begin(), distance.end(), -1);
+        fill(done.begin(), done.end(), 0);
+        priority_queue<Entry, vector<Entry>, greater<Entry> > queue;
+        distance[sources[i]] = 0;
+        queue.push(Entry(0, sources[i]));
+        while ( !queue.empty() ) {
+            Entry top = queue.top();
+            queue.pop();
+            if ( done[top.second] ) {
+                continue;
+            }
+            done[top.second] = 1;
+            settled++;
+            for ( const RoadGraph::Arc* a = g.begin(top.second);
+                  a != g.end(top.second); ++a ) {
+                long long d = top.first + a->weight;
+                if ( distance[a->to] < 0 || d < distance[a->to] ) {
+                    distance[a->to] = d;
+                    queue.push(Entry(d, a->to));
+                }
+            }
+        }
+    }
+    measurement.report("dijkstra", "lazy_binary", g.vertices(), static_cast<int>(settled));
+}
+
+template <class Heap>
+void benchmarkPrim(const char* engine, const RoadGraph &g) {
+    vector<RoadGraph::vertex_type> parent;
+    Measurement measurement;
+    prim<long long, Heap>(g, parent);
+    measurement.report("prim", engine, g.vertices(), g.vertices());
+}
+
+// the 1000 greatest of n keys
+template <class Heap>
+void benchmarkTopK(const char* engine, int n) {
+    vector<double> keys = randomKeys(n);
+    Measurement measurement;
+    TopK<double, void, less<double>, Heap> top(1000);
+    for ( int i = 0; i < n; i++ ) {
+        top.offer(keys[i]);
+    }
+    top.take();
+    measurement.report("topk", engine, n, n);
+}
+
+void benchmarkInsertAll(int n) {
+    vector<double> keys = randomKeys(n);
+    Measurement measurement;
+    FibHeap<double, void, greater<double> > heap;
+    for ( int i = 0; i < n; i++ ) {
+        heap.insert(keys[i]);
+    }
+    for ( int i = 0; i < 1000 && !heap.empty(); i++ ) {
+        heap.extractMin();
+    }
+    measurement.report("topk", "insert_all", n, n);
+}
+
+// n insertions, then n extractions
+void benchmarkSoft(const char* engine, double epsilon, int n) {
+    vector<double> keys = randomKeys(n);
+    vector<double> out(n);
+    Measurement measurement;
+    if ( epsilon > 0 ) {
+        SoftHeap<double> heap(epsilon);
+        for ( int i = 0; i < n; i++ ) {
+            heap.insert(keys[i]);
+        }
+        for ( int i = 0; i < n; i++ ) {
+            out[i] = heap.extractMin();
+        }
+        measurement.report("soft", engine, n, n);
+        sort(keys.begin(), keys.end());
+        double worst = 0;
+        for ( int i = 0; i < n; i++ ) {
+            double rank = lower_bound(keys.begin(), keys.end(), out[i]) - keys.begin();
+            worst = max(worst, rank - i);
+        }
+        cerr << engine << " corrupted " << double(heap.corrupted()) / n
+             << " rank_error " << worst / n << endl;
+    }
+    else {
+        FibHeap<double> heap;
+        for ( int i = 0; i < n; i++ ) {
+            heap.insert(keys[i]);
+        }
+        for ( int i = 0; i < n; i++ ) {
+            out[i] = heap.extractMin();
+        }
+        measurement.report("soft", engine, n, n);
+    }
+}
+
+// the median of n keys: 0 for approximate_median, 1 for soft_select and 2
+// for std::nth_element
+void benchmarkSelect(int method, int n) {
+    static const char* engines[] = { "soft_median", "soft_select", "nth_element" };
+    vector<double> keys = randomKeys(n);
+    volatile double sink;
+    Measurement measurement;
+    if ( method == 0 ) {
+        sink = approximate_median(keys.begin(), keys.end(), 0.1);
+    }
+    else if ( method == 1 ) {
+        sink = *soft_select(keys.begin(), keys.end(), n / 2);
+    }
+    else {
+        nth_element(keys.begin(), keys.begin() + n / 2, keys.end());
+        sink = keys[n / 2];
+    }
+    measurement.report("select", engines[method], n, n);
+    (void)sink;
+}
+
+// m keys popped in batches of k, refilling the heap after every batch
+void benchmarkBatch(bool batched, int k, int n, int ops) {
+    vector<double> keys = randomKeys(n + ops);
+    vector<double> out(k);
+    FibHeap<double> heap;
+    heap.insert_range(keys.begin(), keys.begin() + n);
+    heap.extractMin();
+    char name[32];
+    snprintf(name, sizeof(name), "pop_k%d", k);
+    Measurement measurement;
+    for ( int i = 0; i + k <= ops; i += k ) {
+        if ( batched ) {
+            heap.extract_k(k, out.begin());
+        }
+        else {
+            for ( int j = 0; j < k; j++ ) {
+                out[j] = heap.extractMin();
+            }
+        }
+        heap.insert_range(keys.begin() + n + i, keys.begin() + n + i + k);
+    }
+    measurement.report(name, batched ? "fibheap_extract_k" : "fibheap", n,
+                       ops / k * k);
+}
+
+// alternating insert and extract-min at a steady size
+template <class Heap>
+void benchmarkPushPop(const char* engine, int n, int ops) {
+    vector<double> keys = randomKeys(n + ops);
+    Heap heap;
+    for ( int i = 0; i < n; i++ ) {
+        heap.insert(keys[i]);
+    }
+    volatile double sink = 0;
+    Measurement measurement;
+    for ( int i = 0; i < ops; i++ ) {
+        heap.insert(keys[n + i]);
+        sink = heap.extractMin();
+    }
+    measurement.report("push_pop", engine, n, ops);
+    (void)sink;
+}
+
+int main(int argc, char** argv) {
+    int n = 1000000;
+    int ops = 100000;
+    const char* graph = NULL;
+    for ( int i = 1; i < argc; i++ ) {
+        if ( strcmp(argv[i], "--size") == 0 && i+1 < argc ) {
+            n = atoi(argv[++i]);
+        }
+        else if ( strcmp(argv[i], "--ops") == 0 && i+1 < argc ) {
+            ops = atoi(argv[++i]);
+        }
+        else if ( strcmp(argv[i], "--graph") == 0 && i+1 < argc ) {
+            graph = argv[++i];
+        }
+        else {
+            fprintf(stderr, "usage: bench [--size n] [--ops m] [--graph file.gr]\n");
+            return 2;
+        }
+    }
+    if ( ops > n ) {
+        ops = n;
+    }
+
+    printf("benchmark,engine,n,ops,ns_per_op,allocs_per_op,bytes_per_op\n");
+    benchmarkBuild<FibHeap<double> >("fibheap", n);
+    benchmarkBuild<CompactFibHeap<double> >("compact", n);
+    benchmarkBuild<PairingHeap<double> >("pairing", n);
+    benchmarkBuild<MultipassHeap<double> >("pairing_multipass", n);
+    benchmarkBuild<DaryHeap<double, 2> >("dary2", n);
+    benchmarkBuild<DaryHeap<double, 4> >("dary4", n);
+    benchmarkBuild<DaryHeap<double, 8> >("dary8", n);
+    benchmarkBuildRange(false, n);
+    benchmarkBuildRange(true, n);
+    benchmarkCopy<FibHeap<double> >("fibheap", n, ops);
+    benchmarkCopy<CompactFibHeap<double> >("compact", n, ops);
+    benchmarkCopy<PairingHeap<double> >("pairing", n, ops);
+    benchmarkCopy<DaryHeap<double, 4> >("dary4", n, ops);
+    benchmarkPop<FibHeap<double> >("fibheap", n, ops);
+    benchmarkPop<CompactFibHeap<double> >("compact", n, ops);
+    benchmarkPop<PairingHeap<double> >("pairing", n, ops);
+    benchmarkPop<MultipassHeap<double> >("pairing_multipass", n, ops);
+    benchmarkPop<DaryHeap<double, 2> >("dary2", n, ops);
+    benchmarkPop<DaryHeap<double, 4> >("dary4", n, ops);
+    benchmarkPop<DaryHeap<double, 8> >("dary8", n, ops);
+    for ( int k = 64; k <= 1024; k *= 4 ) {
+        benchmarkBatch(false, k, n, ops);
+        benchmarkBatch(true, k, n, ops);
+    }
+    for ( int threads = 1; threads <= 8; threads *= 2 ) {
+        LockedHeap locked;
+        MultiQueue<double> relaxed(threads);
+        MultiQueue<double> strict(threads, 2, MultiQueue<double>::STRICT);
+        benchmarkConcurrent(locked, "locked", threads, n, ops);
+        benchmarkConcurrent(relaxed, "multiqueue", threads, n, ops);
+        benchmarkConcurrent(strict, "multiqueue_strict", threads, n, ops);
+        benchmarkExecutor(threads, ops);
+    }
+    benchmarkExternal<FibHeap<unsigned long long, unsigned int> >("fibheap", n);
+    benchmarkExternal<PairingHeap<unsigned long long, unsigned int> >("pairing", n);
+    benchmarkExternal<DaryHeap<unsigned long long, 4, unsigned int> >("dary4", n);
+    benchmarkSnapshot(n, ops);
+    {
+        remove("/tmp/bench_journal.snapshot");
+        remove("/tmp/bench_journal.journal");
+        JournaledHeap durable;
+        FibHeap<double, int> plain;
+        benchmarkJournal(durable, "durable", n, ops);
+        benchmarkJournal(plain, "fibheap", n, ops);
+        Measurement checkpoint;
+        durable.checkpoint();
+        checkpoint.report("journal", "checkpoint", n, n);
+        remove("/tmp/bench_journal.snapshot");
+        remove("/tmp/bench_journal.journal");
+    }
+    benchmarkTopK<FibHeap<double> >("fibheap", n);
+    benchmarkTopK<PairingHeap<double> >("pairing", n);
+    benchmarkTopK<DaryHeap<double, 4> >("dary4", n);
+    benchmarkInsertAll(n);
+    benchmarkSoft("soft_0.1", 0.1, n);
+    benchmarkSoft("soft_0.01", 0.01, n);
+    benchmarkSoft("fibheap", 0, n);
+    for ( int method = 0; method < 3; method++ ) {
+        benchmarkSelect(method, n);
+    }
+    benchmarkTimers<HeapTimers>("fibheap", n, ops);
+    benchmarkTimers<WheelTimers>("wheel", n, ops);
+    benchmarkPushPop<FibHeap<double> >("fibheap", n, ops);
+    benchmarkPushPop<CompactFibHeap<double> >("compact", n, ops);
+    benchmarkPushPop<PairingHeap<double> >("pairing", n, ops);
+    benchmarkPushPop<MultipassHeap<double> >("pairing_multipass", n, ops);
+    benchmarkPushPop<DaryHeap<double, 2> >("dary2", n, ops);
+    benchmarkPushPop<DaryHeap<double, 4> >("dary4", n, ops);
+    benchmarkPushPop<DaryHeap<double, 8> >("dary8", n, ops);
+    benchmarkDecrease<FibHeap<double, int> >("fibheap", n, ops);
+    benchmarkDecrease<CompactFibHeap<double, int> >("compact", n, ops);
+    benchmarkDecrease<PairingHeap<double, int> >("pairing", n, ops);
+    benchmarkDecrease<MultipassHeap<double, int> >("pairing_multipass", n, ops);
+    benchmarkDecrease<DaryHeap<double, 2, int> >("dary2", n, ops);
+    benchmarkDecrease<DaryHeap<double, 4, int> >("dary4", n, ops);
+    benchmarkDecrease<DaryHeap<double, 8, int> >("dary8", n, ops);
+    benchmarkMonotone<FibHeap<long long, int> >("fibheap", n, ops);
+    benchmarkMonotone<PairingHeap<long long, int> >("pairing", n, ops);
+    benchmarkMonotone<DaryHeap<long long, 4, int> >("dary4", n, ops);
+    benchmarkMonotone<RadixHeap<long long, int> >("radix", n, ops);
+
+    RoadGraph road = graph ? RoadGraph::load_dimacs(graph) : gridGraph(n);
+    typedef RoadGraph::vertex_type Vertex;
+    benchmarkDijkstra<FibHeap<long long, Vertex> >("fibheap", road);
+    benchmarkDijkstra<PairingHeap<long long, Vertex> >("pairing", road);
+    benchmarkDijkstra<DaryHeap<long long, 4, Vertex> >("dary4", road);
+    benchmarkDijkstra<RadixHeap<long long, Vertex> >("radix", road);
+    benchmarkLazyDijkstra(road);
+    benchmarkPrim<FibHeap<long long, Vertex> >("fibheap", road);
+    benchmarkPrim<PairingHeap<long long, Vertex> >("pairing", road);
+    benchmarkPrim<DaryHeap<long long, 4, Vertex> >("dary4", road);
+    return 0;
+}
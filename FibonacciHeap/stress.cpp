@@ -0,0 +1,630 @@
+/* stress
+ ******************************************************************************
+ *
+ * replays a random mix of operations on every heap engine, timing it, and
+ * replays it again against a reference to check every step.
+ *
+ *      stress [--size n] [--ops m] [--mix i:p:d:m] [--keys distribution]
+ *             [--ties] [--meld k] [--seed s] [--engines list] [--no-check]
+ *
+ * a run fills the heap with n keys (default 10^6) and then performs m
+ * operations (default 10^6), each an insert, a pop (extract-min), a
+ * decrease_key of a random item or a meld of k new items (default 16),
+ * drawn with the weights of --mix (default 50:30:15:5). keys come from
+ * --keys: "uniform" random 32-bit priorities, "ascending" or "descending"
+ * ones, or "few" distinct ones (16), which gives most items the same
+ * priority as many others. a decrease_key moves a key to a uniform priority
+ * below its own. the heap is never popped while empty; an insert is done
+ * instead.
+ *
+ * every key carries the id of its item in its low 32 bits, so no two keys
+ * are equal and every engine pops the same item at every step: the run
+ * depends only on --seed, and the engines see exactly the same operations.
+ * with --ties the engines order keys by priority alone, so items of equal
+ * priority really tie and each engine breaks the ties its own way; the
+ * check then compares the priorities popped and at the minimum rather than
+ * the keys, and the run also depends on the engine, since later operations
+ * pick among the items left. "few" makes ties common.
+ * the engines are FibHeap ("fibheap"), CompactFibHeap ("compact"),
+ * PairingHeap ("pairing"), a 4-ary DaryHeap ("dary4") and
+ * std::priority_queue ("std"), which decreases a key by pushing it again and
+ * skips the stale entry when it comes up. melds go through merge on FibHeap
+ * and PairingHeap; CompactFibHeap has no merge, and DaryHeap's merge
+ * invalidates the handles of the melded heap, so on those and on "std" a
+ * meld inserts the k items one by one. --engines takes a comma-separated
+ * list of names.
+ *
+ * one operation in 64 is timed on its own for the latency percentiles; the
+ * throughput is over the whole run. the check then replays the same run on
+ * a fresh heap next to a std::set, comparing the key popped, the minimum and
+ * the size after every operation, or with --ties their priorities, and that
+ * the item popped was in the heap; the first difference is reported on
+ * stderr and makes the exit status 1. sizes up to 10^8 work, given memory
+ * for the heap and, unless --no-check, for the std::set. results are written
+ * as CSV, latencies in ns:
+ *
+ *      engine,keys,n,ops,mix,ns_per_op,mops,insert_p50,insert_p99,pop_p50,
+ *      pop_p99,decrease_p50,decrease_p99,meld_p50,meld_p99,check
+ *
+ * build:
+ *      g++ -O2 -std=c++11 stress.cpp -o stress
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <random>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "CompactFibHeap.h"
+#include "DaryHeap.h"
+#include "FibHeap.h"
+#include "PairingHeap.h"
+
+using namespace std;
+
+typedef uint64_t Key;
+typedef chrono::steady_clock Clock;
+
+static uint32_t Id(Key key) { return static_cast<uint32_t>(key); }
+static uint32_t Priority(Key key) { return static_cast<uint32_t>(key >> 32); }
+static Key MakeKey(uint32_t priority, uint32_t id) {
+    return static_cast<Key>(priority) << 32 | id;
+}
+
+// the order of keys in the engines: by the whole key, or with TIES by the
+// priority alone
+template <bool TIES>
+struct Order {
+    bool operator()(Key a, Key b) const {
+        return TIES ? Priority(a) < Priority(b) : a < b;
+    }
+};
+
+// the reverse order, for std::priority_queue
+template <bool TIES>
+struct Later {
+    bool operator()(Key a, Key b) const { return Order<TIES>()(b, a); }
+};
+
+enum Operation {
+    INSERT,
+    POP,
+    DECREASE,
+    MELD,
+    OPERATIONS
+};
+
+static const char* operation_names[OPERATIONS] = { "insert", "pop", "decrease", "meld" };
+
+enum Distribution {
+    UNIFORM,
+    ASCENDING,
+    DESCENDING,
+    FEW
+};
+
+struct Workload {
+    size_t n;
+    size_t ops;
+    unsigned int weights[OPERATIONS];
+    Distribution keys;
+    bool ties;
+    size_t meld;
+    uint64_t seed;
+};
+
+/* Engine, LazyQueue
+ ******************************************************************************
+ *
+ * the operations of a run on one engine, by key. an Engine keeps the handle
+ * of every item by id; MELD says whether merge keeps the melded handles
+ * valid. LazyQueue is std::priority_queue with the current key of every id,
+ * so that a popped entry that no longer matches it is known to be stale.
+ *
+ */
+
+template <class Heap, bool MELD>
+class Engine {
+private:
+    Heap heap;
+    vector<typename Heap::handle> handles;
+    size_t n;
+
+    void Place(Heap &h, Key key) {
+        if ( Id(key) >= handles.size() ) {
+            handles.resize(Id(key) + 1);
+        }
+        handles[Id(key)] = h.insert(key);
+    }
+
+    void Meld(const Key* keys, size_t k, true_type) {
+        Heap other;
+        for ( size_t i = 0; i < k; i++ ) {
+            Place(other, keys[i]);
+        }
+        heap.merge(std::move(other));
+    }
+
+    void Meld(const Key* keys, size_t k, false_type) {
+        for ( size_t i = 0; i < k; i++ ) {
+            Place(heap, keys[i]);
+        }
+    }
+
+public:
+    Engine() : n(0) {}
+
+    size_t size() const { return n; }
+
+    void push(Key key) {
+        Place(heap, key);
+        n++;
+    }
+
+    Key pop() {
+        n--;
+        return heap.extractMin();
+    }
+
+    Key top() { return heap.key(heap.top()); }
+
+    void decrease(Key key) { heap.decrease_key(handles[Id(key)], key); }
+
+    void meld(const Key* keys, size_t k) {
+        Meld(keys, k, integral_constant<bool, MELD>());
+        n += k;
+    }
+};
+
+template <bool TIES>
+class LazyQueue {
+private:
+    static const Key DEAD = ~static_cast<Key>(0);
+
+    priority_queue<Key, vector<Key>, Later<TIES> > queue;
+    vector<Key> current;
+    size_t n;
+
+    // drops the stale entries in front
+    void Skip() {
+        while ( queue.top() != current[Id(queue.top())] ) {
+            queue.pop();
+        }
+    }
+
+public:
+    LazyQueue() : n(0) {}
+
+    size_t size() const { return n; }
+
+    void push(Key key) {
+        if ( Id(key) >= current.size() ) {
+            current.resize(Id(key) + 1, DEAD);
+        }
+        current[Id(key)] = key;
+        queue.push(key);
+        n++;
+    }
+
+    Key pop() {
+        Skip();
+        Key key = queue.top();
+        queue.pop();
+        current[Id(key)] = DEAD;
+        n--;
+        return key;
+    }
+
+    Key top() {
+        Skip();
+        return queue.top();
+    }
+
+    void decrease(Key key) {
+        current[Id(key)] = key;
+        queue.push(key);
+    }
+
+    void meld(const Key* keys, size_t k) {
+        for ( size_t i = 0; i < k; i++ ) {
+            push(keys[i]);
+        }
+    }
+};
+
+template <bool TIES>
+const Key LazyQueue<TIES>::DEAD;
+
+/* Generator
+ ******************************************************************************
+ *
+ * draws the operations of a run from its seed. it keeps the ids of the
+ * items in the heap in an array, with the position of each id, so a random
+ * item is found and a popped one removed in O(1), and reuses the ids of
+ * popped items; the key a pop returns tells it which item left.
+ *
+ */
+
+class Generator {
+private:
+    Workload work;
+    mt19937_64 random;
+    unsigned int total;
+    uint32_t counter;
+    vector<uint32_t> live;
+    vector<uint32_t> position;
+    vector<Key> keys;
+    vector<uint32_t> free;
+
+    uint32_t NewPriority() {
+        switch ( work.keys ) {
+        case ASCENDING:
+            return counter++;
+        case DESCENDING:
+            return ~counter++;
+        case FEW:
+            return static_cast<uint32_t>(random() % 16);
+        default:
+            return static_cast<uint32_t>(random());
+        }
+    }
+
+public:
+    explicit Generator(const Workload &w) :
+        work(w), random(w.seed), total(0), counter(0) {
+        for ( int i = 0; i < OPERATIONS; i++ ) {
+            total += work.weights[i];
+        }
+    }
+
+    size_t size() const { return live.size(); }
+
+    // the next operation, given that the heap holds size() items
+    Operation next() {
+        if ( live.empty() ) {
+            return INSERT;
+        }
+        unsigned int r = static_cast<unsigned int>(random() % total);
+        int op = 0;
+        while ( r >= work.weights[op] ) {
+            r -= work.weights[op++];
+        }
+        return static_cast<Operation>(op);
+    }
+
+    // a key for a new item
+    Key fresh() {
+        uint32_t id;
+        if ( free.empty() ) {
+            id = static_cast<uint32_t>(position.size());
+            position.push_back(0);
+            keys.push_back(0);
+        }
+        else {
+            id = free.back();
+            free.pop_back();
+        }
+        position[id] = static_cast<uint32_t>(live.size());
+        live.push_back(id);
+        keys[id] = MakeKey(NewPriority(), id);
+        return keys[id];
+    }
+
+    // lowers the key of a random item from old to key, and returns false
+    // if its priority is already 0
+    bool lower(Key &old, Key &key) {
+        uint32_t id = live[random() % live.size()];
+        uint32_t priority = Priority(keys[id]);
+        if ( priority == 0 ) {
+            return false;
+        }
+        old = keys[id];
+        key = keys[id] = MakeKey(static_cast<uint32_t>(random() % priority), id);
+        return true;
+    }
+
+    // records that the item of key has left the heap
+    void popped(Key key) {
+        uint32_t id = Id(key);
+        uint32_t last = live.back();
+        live[position[id]] = last;
+        position[last] = position[id];
+        live.pop_back();
+        free.push_back(id);
+    }
+};
+
+/* run, check
+ ******************************************************************************
+ *
+ * run times a workload on a new Queue and fills samples with the latency
+ * of every 64th operation, by kind; check replays it next to a std::set and
+ * returns whether every step agreed.
+ *
+ */
+
+template <class Queue>
+double run(const Workload &work, vector<vector<uint32_t> > &samples) {
+    Generator generator(work);
+    Queue queue;
+    vector<Key> batch(work.meld);
+    for ( size_t i = 0; i < work.n; i++ ) {
+        queue.push(generator.fresh());
+    }
+    samples.assign(OPERATIONS, vector<uint32_t>());
+    Clock::time_point start = Clock::now();
+    for ( size_t i = 0; i < work.ops; i++ ) {
+        Operation op = generator.next();
+        bool timed = i % 64 == 0;
+        Clock::time_point before;
+        if ( timed ) {
+            before = Clock::now();
+        }
+        switch ( op ) {
+        case INSERT:
+            queue.push(generator.fresh());
+            break;
+        case POP:
+            generator.popped(queue.pop());
+            break;
+        case DECREASE: {
+            Key old, key;
+            if ( generator.lower(old, key) ) {
+                queue.decrease(key);
+            }
+            break;
+        }
+        default:
+            for ( size_t j = 0; j < work.meld; j++ ) {
+                batch[j] = generator.fresh();
+            }
+            queue.meld(batch.data(), work.meld);
+        }
+        if ( timed ) {
+            samples[op].push_back(static_cast<uint32_t>(min<long long>(
+                chrono::duration_cast<chrono::nanoseconds>(Clock::now() - before).count(),
+                0xffffffffll)));
+        }
+    }
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <class Queue>
+bool check(const Workload &work, const char* engine) {
+    Generator generator(work);
+    Queue queue;
+    set<Key> reference;
+    vector<Key> batch(work.meld);
+    for ( size_t i = 0; i < work.n; i++ ) {
+        Key key = generator.fresh();
+        queue.push(key);
+        reference.insert(key);
+    }
+    for ( size_t i = 0; i < work.ops; i++ ) {
+        Operation op = generator.next();
+        Key expected = 0, got = 0;
+        switch ( op ) {
+        case INSERT:
+            expected = generator.fresh();
+            queue.push(expected);
+            reference.insert(expected);
+            break;
+        case POP:
+            expected = *reference.begin();
+            got = queue.pop();
+            if ( work.ties && Priority(got) == Priority(expected) &&
+                 reference.count(got) != 0 ) {
+                expected = got;
+            }
+            reference.erase(expected);
+            generator.popped(expected);
+            break;
+        case DECREASE: {
+            Key old;
+            if ( generator.lower(old, expected) ) {
+                reference.erase(old);
+                reference.insert(expected);
+                queue.decrease(expected);
+            }
+            break;
+        }
+        default:
+            for ( size_t j = 0; j < work.meld; j++ ) {
+                batch[j] = generator.fresh();
+                reference.insert(batch[j]);
+            }
+            queue.meld(batch.data(), work.meld);
+        }
+        const char* failure = NULL;
+        if ( op == POP && got != expected ) {
+            failure = "popped";
+        }
+        else if ( queue.size() != reference.size() ) {
+            failure = "size";
+            expected = reference.size();
+            got = queue.size();
+        }
+        else if ( !reference.empty() ) {
+            got = queue.top();
+            expected = *reference.begin();
+            if ( work.ties ? Priority(got) != Priority(expected) ||
+                             reference.count(got) == 0 :
+                             got != expected ) {
+                failure = "minimum";
+            }
+        }
+        if ( failure != NULL ) {
+            fprintf(stderr, "%s: step %zu (%s): %s %llu, expected %llu\n", engine,
+                    i, operation_names[op], failure,
+                    static_cast<unsigned long long>(got),
+                    static_cast<unsigned long long>(expected));
+            return false;
+        }
+    }
+    return true;
+}
+
+// the p-th percentile of samples, which it reorders
+uint32_t percentile(vector<uint32_t> &samples, double p) {
+    if ( samples.empty() ) {
+        return 0;
+    }
+    size_t k = min(samples.size() - 1, static_cast<size_t>(p * samples.size()));
+    nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k];
+}
+
+template <class Queue>
+bool measure(const Workload &work, const char* engine, const char* keys,
+             const char* mix, bool checking) {
+    vector<vector<uint32_t> > samples;
+    double elapsed = run<Queue>(work, samples);
+    bool passed = !checking || check<Queue>(work, engine);
+    printf("%s,%s,%zu,%zu,%s,%.1f,%.3f", engine, keys, work.n, work.ops, mix,
+           elapsed * 1e9 / work.ops, work.ops / elapsed / 1e6);
+    for ( int op = 0; op < OPERATIONS; op++ ) {
+        printf(",%u,%u", percentile(samples[op], 0.5), percentile(samples[op], 0.99));
+    }
+    printf(",%s\n", !checking ? "skipped" : passed ? "ok" : "FAILED");
+    fflush(stdout);
+    return passed;
+}
+
+// measures the engine named engine, ordering keys by Order<TIES>. returns
+// 0 if it passed, 1 if it failed the check and 2 if there is no such engine
+template <bool TIES>
+int measure(const string &engine, const Workload &work, const char* keys,
+            const char* mix, bool checking) {
+    typedef Order<TIES> Compare;
+    bool passed;
+    if ( engine == "fibheap" ) {
+        passed = measure<Engine<FibHeap<Key, void, Compare>, true> >(work,
+            "fibheap", keys, mix, checking);
+    }
+    else if ( engine == "compact" ) {
+        passed = measure<Engine<CompactFibHeap<Key, void, Compare>, false> >(work,
+            "compact", keys, mix, checking);
+    }
+    else if ( engine == "pairing" ) {
+        passed = measure<Engine<PairingHeap<Key, void, Compare>, true> >(work,
+            "pairing", keys, mix, checking);
+    }
+    else if ( engine == "dary4" ) {
+        passed = measure<Engine<DaryHeap<Key, 4, void, Compare>, false> >(work,
+            "dary4", keys, mix, checking);
+    }
+    else if ( engine == "std" ) {
+        passed = measure<LazyQueue<TIES> >(work, "std", keys, mix, checking);
+    }
+    else {
+        return 2;
+    }
+    return passed ? 0 : 1;
+}
+
+int usage() {
+    fprintf(stderr, "usage: stress [--size n] [--ops m] [--mix i:p:d:m] "
+                    "[--keys uniform|ascending|descending|few] [--ties] "
+                    "[--meld k] [--seed s] [--engines list] [--no-check]\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    Workload work = { 1000000, 1000000, { 50, 30, 15, 5 }, UNIFORM, false, 16, 1 };
+    string mix = "50:30:15:5";
+    string keys = "uniform";
+    string engines = "fibheap,compact,pairing,dary4,std";
+    bool checking = true;
+    for ( int i = 1; i < argc; i++ ) {
+        bool more = i + 1 < argc;
+        if ( strcmp(argv[i], "--size") == 0 && more ) {
+            work.n = strtoull(argv[++i], NULL, 10);
+        }
+        else if ( strcmp(argv[i], "--ops") == 0 && more ) {
+            work.ops = strtoull(argv[++i], NULL, 10);
+        }
+        else if ( strcmp(argv[i], "--mix") == 0 && more ) {
+            mix = argv[++i];
+            if ( sscanf(mix.c_str(), "%u:%u:%u:%u", &work.weights[INSERT],
+                        &work.weights[POP], &work.weights[DECREASE],
+                        &work.weights[MELD]) != 4 ||
+                 work.weights[INSERT] + work.weights[POP] +
+                 work.weights[DECREASE] + work.weights[MELD] == 0 ) {
+                return usage();
+            }
+        }
+        else if ( strcmp(argv[i], "--keys") == 0 && more ) {
+            keys = argv[++i];
+            if ( keys == "uniform" ) {
+                work.keys = UNIFORM;
+            }
+            else if ( keys == "ascending" ) {
+                work.keys = ASCENDING;
+            }
+            else if ( keys == "descending" ) {
+                work.keys = DESCENDING;
+            }
+            else if ( keys == "few" ) {
+                work.keys = FEW;
+            }
+            else {
+                return usage();
+            }
+        }
+        else if ( strcmp(argv[i], "--ties") == 0 ) {
+            work.ties = true;
+        }
+        else if ( strcmp(argv[i], "--meld") == 0 && more ) {
+            work.meld = strtoull(argv[++i], NULL, 10);
+        }
+        else if ( strcmp(argv[i], "--seed") == 0 && more ) {
+            work.seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if ( strcmp(argv[i], "--engines") == 0 && more ) {
+            engines = argv[++i];
+        }
+        else if ( strcmp(argv[i], "--no-check") == 0 ) {
+            checking = false;
+        }
+        else {
+            return usage();
+        }
+    }
+    if ( work.n + work.ops * (work.meld > 1 ? work.meld : 1) >= 0xffffffffull ) {
+        fprintf(stderr, "stress: more than 2^32 - 1 items\n");
+        return 2;
+    }
+
+    // the keys column names the distribution, and whether keys tie
+    string label = work.ties ? keys + "+ties" : keys;
+    printf("engine,keys,n,ops,mix,ns_per_op,mops,insert_p50,insert_p99,pop_p50,"
+           "pop_p99,decrease_p50,decrease_p99,meld_p50,meld_p99,check\n");
+    bool passed = true;
+    engines += ",";
+    for ( size_t start = 0, end; (end = engines.find(',', start)) != string::npos;
+          start = end + 1 ) {
+        string engine = engines.substr(start, end - start);
+        if ( engine.empty() ) {
+            continue;
+        }
+        int status = work.ties ?
+            measure<true>(engine, work, label.c_str(), mix.c_str(), checking) :
+            measure<false>(engine, work, label.c_str(), mix.c_str(), checking);
+        if ( status == 2 ) {
+            fprintf(stderr, "stress: unknown engine %s\n", engine.c_str());
+            return 2;
+        }
+        passed &= status == 0;
+    }
+    return passed ? 0 : 1;
+}
@@ -1,16 +1,157 @@
 //#define NDEBUG
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <ctime>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "CompactFibHeap.h"
+#include "DaryHeap.h"
+#include "DurableHeap.h"
+#include "Executor.h"
+#include "ExternalSort.h"
 #include "FibHeap.h"
+#include "Graph.h"
+#include "MultiQueue.h"
+#include "NodePool.h"
+#include "PairingHeap.h"
+#include "RadixHeap.h"
+#include "SoftHeap.h"
+#include "TimerWheel.h"
+#include "TopK.h"
 
 const int ARR_SIZE = 20000;
 const double denominator = 2.7818281828459;
 
 using namespace std;
 
+// DaryHeap<int, D, int> follows FibHeap<int, int> through insertions, bulk
+// insertions, decreases, erasures, extractions and a merge
+template <unsigned int D>
+void testDaryHeap() {
+    FibHeap<int, int> F;
+    DaryHeap<int, D, int> H, M;
+    FibHeap<int, int>::handle fh[ARR_SIZE];
+    typename DaryHeap<int, D, int>::handle hh[ARR_SIZE];
+    bool present[ARR_SIZE];
+    int fv, hv;
+    for ( int i = 0; i < ARR_SIZE; i++ ) {
+        int key = (i * 7919) % ARR_SIZE;
+        fh[i] = F.insert(key, i);
+        hh[i] = H.insert(key, i);
+        present[i] = true;
+    }
+    for ( int round = 0; round < 4; round++ ) {
+        for ( int i = 0; i < ARR_SIZE/8; i++ ) {
+            assert(F.extractMin(fv) == H.extractMin(hv) && fv == hv);
+            present[hv] = false;
+        }
+        for ( int i = round; i < ARR_SIZE; i += 11 ) {
+            if ( !present[i] ) {
+                continue;
+            }
+            if ( i % 3 ) {
+                F.decrease_key(fh[i], -1 - i - round * ARR_SIZE);
+                H.decrease_key(hh[i], -1 - i - round * ARR_SIZE);
+                assert(H.key(hh[i]) == -1 - i - round * ARR_SIZE);
+            }
+            else {
+                F.erase(fh[i]);
+                H.erase(hh[i]);
+                present[i] = false;
+            }
+        }
+        assert(F.size() == static_cast<int>(H.size()));
+    }
+    // keys beyond the others, merged in through a heap built from a range
+    vector<int> more(ARR_SIZE);
+    for ( int i = 0; i < ARR_SIZE; i++ ) {
+        more[i] = ARR_SIZE + rand() % ARR_SIZE;
+        F.insert(more[i], -1);
+    }
+    M.insert_range(more.begin(), more.end());
+    H.merge(std::move(M));
+    assert(M.empty() && F.size() == static_cast<int>(H.size()));
+    while ( H.size() ) {
+        int key = F.extractMin(fv);
+        assert(H.extractMin(hv) == key && (key >= ARR_SIZE || fv == hv));
+    }
+    typedef typename DaryHeap<int, D, int>::handle handle;
+    assert(H.top() == handle());
+}
+
+// std::allocator counting the chunks it hands out, under any rebinding
+int allocations = 0;
+
+template <class T>
+struct CountingAllocator : std::allocator<T> {
+    template <class U> struct rebind { typedef CountingAllocator<U> other; };
+    CountingAllocator() {}
+    template <class U> CountingAllocator(const CountingAllocator<U>&) {}
+    T* allocate(size_t n) {
+        allocations++;
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+// a payload holding a reference to a token, counting how often it is
+// assigned to rather than constructed
+int assignments = 0;
+
+struct Payload {
+    shared_ptr<int> token;
+    Payload(const shared_ptr<int> &t) noexcept : token(t) {}
+    Payload(const Payload &p) : token(p.token) {}
+    Payload(Payload &&p) noexcept : token(std::move(p.token)) {}
+    Payload& operator=(const Payload &p) {
+        assignments++;
+        token = p.token;
+        return *this;
+    }
+    Payload& operator=(Payload &&p) {
+        assignments++;
+        token = std::move(p.token);
+        return *this;
+    }
+};
+
+// a heap that keeps payloads in slots lets go of a payload as soon as its
+// node is extracted or erased, and builds the payload of a reused slot in
+// place
+template <class Heap>
+void testPayloadSlots() {
+    shared_ptr<int> token = make_shared<int>(0);
+    Heap H;
+    H.emplace(1, token);
+    typename Heap::handle h = H.emplace(2, token);
+    H.emplace(3, token);
+    assert(token.use_count() == 4);
+    assert(H.extractMin() == 1 && token.use_count() == 3);
+    H.erase(h);
+    assert(token.use_count() == 2);
+    assignments = 0;
+    H.emplace(4, token);
+    H.emplace(5, token);
+    assert(token.use_count() == 4 && assignments == 0);
+    while ( H.size() ) {
+        H.extractMin();
+    }
+    assert(token.use_count() == 1);
+}
+
 int main(int argc,char** argv) {
     srand(static_cast<unsigned int>(time(0)));
     int count = 0;
@@ -79,9 +220,1349 @@ int main(int argc,char** argv) {
     assert(H1.size() == 0 && H3.size() == 0 && H3.en_count() == 0);
     count++;
 
+    // HANDLE tests
+    /*
+     * decrease_key and erase act on the node named by the handle
+     */
+    {
+        FibHeap<double> D;
+        FibHeap<double>::handle handles[ARR_SIZE];
+        for ( int i = 0; i < ARR_SIZE; i++ ) {
+            handles[i] = D.insert(ARR_SIZE + i);
+        }
+        // consolidate so that decreased nodes have parents to be cut from
+        D.insert(-1);
+        D.extractMin();
+        for ( int i = 0; i < ARR_SIZE; i += 2 ) {
+            D.decrease_key(handles[i], i);
+        }
+        for ( int i = 1; i < ARR_SIZE; i += 4 ) {
+            D.erase(handles[i]);
+        }
+        assert(D.size() == ARR_SIZE - ARR_SIZE/4);
+        // a key may not be increased
+        bool thrown = false;
+        try {
+            D.decrease_key(handles[0], ARR_SIZE*3);
+        }
+        catch ( FibHeap<double>::KeyIncrease ) {
+            thrown = true;
+        }
+        assert(thrown && D.key(handles[0]) == 0);
+        // evens come out decreased first, then the odd keys that were kept
+        for ( int i = 0; i < ARR_SIZE; i += 2 ) {
+            assert(D.extractMin() == i);
+        }
+        for ( int i = 3; i < ARR_SIZE; i += 4 ) {
+            assert(D.extractMin() == ARR_SIZE + i);
+        }
+        assert(D.empty());
+        count++;
+    }
+
     // MERGing HEAPS
+    /*
+     * merge takes every node of the other heap and keeps its handles valid
+     */
+    {
+        FibHeap<double> M1, M2;
+        FibHeap<double>::handle moved;
+        for ( int i = 0; i < ARR_SIZE; i++ ) {
+            dbl_arr[i] = rand()/denominator;
+            if ( i % 2 ) {
+                M1.insert(dbl_arr[i]);
+            }
+            else {
+                moved = M2.insert(dbl_arr[i]);
+            }
+        }
+        M1.merge(std::move(M2));
+        assert(M1.size() == ARR_SIZE && M2.size() == 0 && M2.empty());
+        M1.decrease_key(moved, -1);
+        assert(M1.extractMin() == -1);
+        double previous = M1.extractMin();
+        while ( M1.size() ) {
+            double value = M1.extractMin();
+            assert(previous <= value);
+            previous = value;
+        }
+        // the emptied heap is still usable
+        M2.insert(1);
+        assert(M2.extractMin() == 1);
+        count++;
+    }
+
+    // STRING TESTS
+    /*
+     * keys with a destructor exercise node recycling through the pool and
+     * the destructor walk of the forest
+     */
+    {
+        FibHeap<string> S;
+        string previous;
+        for ( int i = 0; i < ARR_SIZE; i++ ) {
+            S.insert(to_string(rand()));
+        }
+        // popped nodes are recycled by later insertions
+        for ( int i = 0; i < ARR_SIZE/2; i++ ) {
+            S.extractMin();
+            S.insert(to_string(rand()));
+        }
+        for ( int i = 0; i < ARR_SIZE/2; i++ ) {
+            string value = S.extractMin();
+            assert( i == 0 || previous <= value );
+            previous = value;
+        }
+        assert(S.size() == ARR_SIZE/2);
+        count++;
+        // the remaining nodes are destroyed with the heap
+    }
+
+    // COMPARATOR TESTS
+    /*
+     * with std::greater the heap orders its keys from largest to smallest, and
+     * decrease_key moves a key towards the top by raising it
+     */
+    {
+        FibHeap<double, void, std::greater<double> > G;
+        FibHeap<double, void, std::greater<double> >::handle raised;
+        for ( int i = 0; i < ARR_SIZE; i++ ) {
+            dbl_arr[i] = rand()/denominator;
+            raised = G.insert(dbl_arr[i]);
+        }
+        G.decrease_key(raised, RAND_MAX);
+        assert(G.min() == RAND_MAX && G.extractMin() == RAND_MAX);
+        bool thrown = false;
+        try {
+            G.decrease_key(G.top(), -1);
+        }
+        catch ( FibHeap<double, void, std::greater<double> >::KeyIncrease ) {
+            thrown = true;
+        }
+        assert(thrown);
+        double previous = G.extractMin();
+        while ( G.size() ) {
+            double value = G.extractMin();
+            assert(previous >= value);
+            previous = value;
+        }
+        count++;
+    }
+
+    // PAYLOAD TESTS
+    /*
+     * every key carries a value built in place by emplace, and the value
+     * follows its key through decrease_key, extraction and merging
+     */
+    {
+        FibHeap<int, string> P, Q;
+        FibHeap<int, string>::handle h[ARR_SIZE];
+        for ( int i = 0; i < ARR_SIZE; i++ ) {
+            // the string is constructed from (count, char) inside the node
+            h[i] = P.emplace(i + ARR_SIZE, 1 + i % 5, 'a' + i % 26);
+        }
+        for ( int i = 0; i < ARR_SIZE; i += 3 ) {
+            P.decrease_key(h[i], i);
+            P.value(h[i]) += '!';
+        }
+        Q.insert(-1, "first");
+        P.merge(std::move(Q));
+        assert(P.key(P.top()) == -1 && P.value(P.top()) == "first");
+        string value;
+        assert(P.extractMin(value) == -1 && value == "first");
+        int previous = -1;
+        while ( P.size() ) {
+            int key = P.extractMin(value);
+            int i = key < ARR_SIZE ? key : key - ARR_SIZE;
+            assert(previous < key);
+            assert(value.substr(0, 1 + i % 5) ==
+                   string(1 + i % 5, 'a' + i % 26));
+            assert((value.size() == 2u + i % 5) == (key < ARR_SIZE));
+            previous = key;
+        }
+        count++;
+    }
+
+    // PAYLOAD SLOT TESTS
+    /*
+     * the array-based heaps release payloads when their slots are freed and
+     * construct them in place when the slots are reused
+     */
+    {
+        testPayloadSlots<CompactFibHeap<int, Payload> >();
+        testPayloadSlots<DaryHeap<int, 4, Payload> >();
+        testPayloadSlots<RadixHeap<int, Payload> >();
+        count++;
+    }
+
+    // COPY AND MOVE TESTS
+    /*
+     * a copy has the shape of its source, which is left untouched, and both
+     * produce the same sequence afterwards. moving transfers the nodes and
+     * their handles and leaves the source empty
+     */
+    {
+        FibHeap<string, int> S;
+        FibHeap<string, int>::handle h[ARR_SIZE];
+        for ( int i = 0; i < ARR_SIZE; i++ ) {
+            h[i] = S.insert(to_string(ARR_SIZE + rand() % ARR_SIZE), i);
+        }
+        // consolidation builds trees, and the decreases below cut and mark
+        // some of their nodes
+        for ( int i = 0; i < ARR_SIZE/10; i++ ) {
+            int value;
+            S.extractMin(value);
+            h[value] = FibHeap<string, int>::handle();
+        }
+        for ( int i = 0; i < ARR_SIZE; i += 3 ) {
+            if ( h[i] != FibHeap<string, int>::handle() ) {
+                S.decrease_key(h[i], "0" + to_string(i));
+            }
+        }
+        S.store("external");
+        const FibHeap<string, int> &source = S;
+        FibHeap<string, int> C(source);
+        assert(C.size() == S.size() && C.en_count() == 1 && S.en_count() == 1);
+        assert(C[0] == "external");
+
+        FibHeap<string, int> A;
+        A.insert("replaced");
+        A = C;
+        A = A;
+        FibHeap<string, int> M(std::move(A));
+        assert(A.empty() && A.en_count() == 0 && M.size() == S.size());
+        FibHeap<string, int> N;
+        N.insert("replaced");
+        N = std::move(M);
+        assert(M.empty() && N.size() == S.size());
+
+        while ( S.size() ) {
+            int sv, cv, nv;
+            string key = S.extractMin(sv);
+            assert(C.extractMin(cv) == key && N.extractMin(nv) == key);
+            assert(sv == cv && sv == nv);
+        }
+        assert(C.empty() && N.empty());
+
+        // the comparator is copied with the heap
+        FibHeap<int, void, std::greater<int> > G;
+        for ( int i = 0; i < 100; i++ ) {
+            G.insert(i);
+        }
+        FibHeap<int, void, std::greater<int> > G2(G);
+        assert(G2.extractMin() == 99 && G.extractMin() == 99);
+        count++;
+    }
+
+    // RANGE TESTS
+    /*
+     * a heap built from a range, by the constructor or by sequential or
+     * parallel bulk insertion into a non-empty heap, holds exactly the keys
+     * of that range
+     */
+    {
+        vector<int> keys(ARR_SIZE * 4);
+        for ( size_t i = 0; i < keys.size(); i++ ) {
+            keys[i] = rand();
+        }
+        FibHeap<int> R(keys.begin(), keys.end());
+        FibHeap<int> B, P;
+        B.insert(-1);
+        B.insert_range(keys.begin(), keys.end());
+        P.insert(-1);
+        P.insert_range_parallel(keys.begin(), keys.end(), 4);
+        // input iterators cannot be measured in advance
+        istringstream in("3 1 2");
+        FibHeap<int> I((istream_iterator<int>(in)), istream_iterator<int>());
+        assert(I.size() == 3 && I.extractMin() == 1);
+        assert(R.size() == ARR_SIZE * 4 && B.size() == ARR_SIZE * 4 + 1);
+        assert(P.size() == B.size());
+        assert(B.extractMin() == -1 && P.extractMin() == -1);
+        sort(keys.begin(), keys.end());
+        for ( size_t i = 0; i < keys.size(); i++ ) {
+            assert(R.extractMin() == keys[i]);
+            assert(B.extractMin() == keys[i] && P.extractMin() == keys[i]);
+        }
+        assert(R.empty() && B.empty() && P.empty());
+        count++;
+    }
+
+    // BATCH EXTRACTION TESTS
+    /*
+     * extract_k removes the same values, in the same order, as k calls of
+     * extractMin, and leaves a heap whose handles keep working
+     */
+    {
+        FibHeap<int, int> E, L;
+        FibHeap<int, int>::handle eh[ARR_SIZE], lh[ARR_SIZE];
+        bool present[ARR_SIZE];
+        for ( int i = 0; i < ARR_SIZE; i++ ) {
+            int key = (i * 7919) % ARR_SIZE;
+            eh[i] = E.insert(key, i);
+            lh[i] = L.insert(key, i);
+            present[i] = true;
+        }
+        vector<int> keys, values;
+        size_t k = 0;
+        while ( L.size() ) {
+            // batches of every size from 0 upwards, the last one too large
+            keys.clear();
+            values.clear();
+            size_t before = E.size();
+            size_t written = E.extract_k(k, back_inserter(keys),
+                                         back_inserter(values));
+            assert(written == min(k, before) && written == keys.size());
+            assert(written == values.size());
+            for ( size_t i = 0; i < written; i++ ) {
+                int value;
+                assert(L.extractMin(value) == keys[i] && value == values[i]);
+                present[value] = false;
+            }
+            assert(E.size() == L.size());
+            // decrease or erase some of the remaining nodes in both heaps
+            for ( int i = k % 7; i < ARR_SIZE; i += 97 ) {
+                if ( !present[i] ) {
+                    continue;
+                }
+                if ( k % 2 ) {
+                    E.decrease_key(eh[i], -1 - i);
+                    L.decrease_key(lh[i], -1 - i);
+                }
+                else {
+                    E.erase(eh[i]);
+                    L.erase(lh[i]);
+                    present[i] = false;
+                }
+            }
+            k++;
+        }
+        assert(E.empty() && E.extract_k(10, back_inserter(keys)) == 0);
+        count++;
+    }
+
+    // COMPACT HEAP TESTS
+    /*
+     * the index-based layout must behave exactly like the pointer-based one
+     * under the same mix of insertions, decreases, erasures and extractions,
+     * including after freed slots have been reused. keys are distinct, so
+     * both heaps extract the same node each time
+     */
+    {
+        FibHeap<int, int> F;
+        CompactFibHeap<int, int> C;
+        FibHeap<int, int>::handle fh[ARR_SIZE];
+        CompactFibHeap<int, int>::handle ch[ARR_SIZE];
+        bool present[ARR_SIZE];
+        int fv, cv;
+        for ( int round = 0; round < 2; round++ ) {
+            for ( int i = 0; i < ARR_SIZE; i++ ) {
+                // a permutation of 0..ARR_SIZE-1, since 7919 is prime
+                int key = (i * 7919 + round) % ARR_SIZE;
+                fh[i] = F.insert(key, i);
+                ch[i] = C.insert(key, i);
+                present[i] = true;
+            }
+            for ( int i = 0; i < ARR_SIZE/4; i++ ) {
+                assert(F.extractMin(fv) == C.extractMin(cv) && fv == cv);
+                present[cv] = false;
+            }
+            for ( int i = 0; i < ARR_SIZE; i += 7 ) {
+                if ( !present[i] ) {
+                    continue;
+                }
+                if ( i % 2 ) {
+                    F.decrease_key(fh[i], -1 - i);
+                    C.decrease_key(ch[i], -1 - i);
+                }
+                else {
+                    F.erase(fh[i]);
+                    C.erase(ch[i]);
+                    present[i] = false;
+                }
+            }
+            assert(F.size() == static_cast<int>(C.size()) && F.min() == C.min());
+            while ( static_cast<int>(C.size()) > ARR_SIZE/2 * round ) {
+                assert(F.extractMin(fv) == C.extractMin(cv) && fv == cv);
+            }
+        }
+        bool thrown = false;
+        try {
+            C.decrease_key(C.top(), C.min() + 1);
+        }
+        catch ( CompactFibHeap<int, int>::KeyIncrease ) {
+            thrown = true;
+        }
+        assert(thrown);
+        count++;
+    }
+
+    // NODE POOL TESTS
+    /*
+     * a pool that adopts another reuses both its free slots and its untouched
+     * ones before allocating again
+     */
+    {
+        typedef NodePool<int, CountingAllocator<int> > Pool;
+        Pool P, Q;
+        vector<int*> nodes;
+        for ( int i = 0; i < 10; i++ ) {
+            P.create(i);
+        }
+        for ( int i = 0; i < 100; i++ ) {
+            nodes.push_back(Q.create(i));
+        }
+        for ( int i = 0; i < 50; i++ ) {
+            Q.destroy(nodes[i]);
+        }
+        // P has 54 untouched slots, Q 50 free ones and 92 untouched
+        P.adopt(Q);
+        assert(P.size() == 60 && Q.size() == 0);
+        int before = allocations;
+        for ( int i = 0; i < 54 + 50 + 92; i++ ) {
+            P.create(i);
+        }
+        assert(allocations == before);
+        P.create(0);
+        assert(allocations == before + 1);
+        // three pools with free lists and untouched slots, adopted in turn
+        Pool pools[3];
+        for ( int k = 0; k < 3; k++ ) {
+            nodes.clear();
+            for ( int i = 0; i < 4; i++ ) {
+                nodes.push_back(pools[k].create(i));
+            }
+            for ( int i = 0; i < 4; i++ ) {
+                pools[k].destroy(nodes[i]);
+            }
+        }
+        pools[0].adopt(pools[1]);
+        pools[0].adopt(pools[2]);
+        before = allocations;
+        for ( int i = 0; i < 3 * 64; i++ ) {
+            pools[0].create(i);
+        }
+        assert(allocations == before && pools[0].size() == 3 * 64);
+        pools[0].create(0);
+        assert(allocations == before + 1);
+        count++;
+    }
+
+    // PAIRING HEAP TESTS
+    /*
+     * both pairing strategies follow FibHeap through the same operations,
+     * and copies, moves and merges keep the tree and its handles intact
+     */
+    {
+        typedef PairingHeap<int, int> Pairing;
+        Pairing::Pairing modes[2] = { Pairing::TWO_PASS, Pairing::MULTIPASS };
+        for ( int mode = 0; mode < 2; mode++ ) {
+            FibHeap<int, int> F;
+            Pairing P(modes[mode]), Q(modes[mode]);
+            FibHeap<int, int>::handle fh[ARR_SIZE];
+            Pairing::handle ph[ARR_SIZE];
+            bool present[ARR_SIZE];
+            for ( int i = 0; i < ARR_SIZE; i++ ) {
+                int key = (i * 7919) % ARR_SIZE;
+                fh[i] = F.insert(key, i);
+                // half the nodes arrive through a merge
+                ph[i] = i % 2 ? P.insert(key, i) : Q.insert(key, i);
+                present[i] = true;
+            }
+            P.merge(std::move(Q));
+            assert(Q.empty() && P.size() == ARR_SIZE);
+            int fv, pv;
+            for ( int round = 0; round < 4; round++ ) {
+                for ( int i = 0; i < ARR_SIZE/8; i++ ) {
+                    assert(F.extractMin(fv) == P.extractMin(pv) && fv == pv);
+                    present[pv] = false;
+                }
+                for ( int i = round; i < ARR_SIZE; i += 11 ) {
+                    if ( !present[i] ) {
+                        continue;
+                    }
+                    if ( i % 3 ) {
+                        F.decrease_key(fh[i], -1 - i - round * ARR_SIZE);
+                        P.decrease_key(ph[i], -1 - i - round * ARR_SIZE);
+                    }
+                    else {
+                        F.erase(fh[i]);
+                        P.erase(ph[i]);
+                        present[i] = false;
+                    }
+                }
+                assert(F.size() == static_cast<int>(P.size()));
+            }
+            Pairing C(P);
+            Pairing M;
+            M = std::move(P);
+            assert(P.empty() && C.size() == M.size());
+            // a batch through extract_k, with and without payloads
+            vector<int> mk, mv, ck;
+            assert(M.extract_k(100, back_inserter(mk), back_inserter(mv)) == 100);
+            assert(C.extract_k(100, back_inserter(ck)) == 100 && ck == mk);
+            for ( int i = 0; i < 100; i++ ) {
+                assert(F.extractMin(fv) == mk[i] && fv == mv[i]);
+            }
+            while ( M.size() ) {
+                int key = F.extractMin(fv);
+                assert(M.extractMin(pv) == key && fv == pv);
+                assert(C.extractMin(pv) == key && fv == pv);
+            }
+            assert(M.extract_k(5, back_inserter(mk)) == 0);
+        }
+        bool thrown = false;
+        PairingHeap<string> S;
+        try {
+            S.decrease_key(S.insert("b"), "c");
+        }
+        catch ( PairingHeap<string>::KeyIncrease ) {
+            thrown = true;
+        }
+        assert(thrown);
+        count++;
+    }
+
+    // D-ARY HEAP TESTS
+    /*
+     * the array heap agrees with FibHeap for each supported arity
+     */
+    testDaryHeap<2>();
+    testDaryHeap<4>();
+    testDaryHeap<8>();
+    count++;
+
+    // RADIX HEAP TESTS
+    /*
+     * under a monotone workload, where keys never go below the last minimum,
+     * the radix heap agrees with FibHeap, for signed and for unsigned keys.
+     * node i has keys of the form base * ARR_SIZE + i, so no two are equal
+     */
+    {
+        FibHeap<long long, int> F;
+        RadixHeap<long long, int> R;
+        RadixHeap<unsigned int> U;
+        FibHeap<long long, int>::handle fh[ARR_SIZE];
+        RadixHeap<long long, int>::handle rh[ARR_SIZE];
+        bool present[ARR_SIZE];
+        for ( int i = 0; i < ARR_SIZE; i++ ) {
+            long long key = (rand() % ARR_SIZE - ARR_SIZE/2) * ARR_SIZE + i;
+            fh[i] = F.insert(key, i);
+            rh[i] = R.insert(key, i);
+            U.insert(static_cast<unsigned int>(rand()));
+            present[i] = true;
+        }
+        vector<unsigned int> more(ARR_SIZE, RAND_MAX);
+        U.insert_range(more.begin(), more.end());
+        unsigned int previous = 0;
+        while ( U.size() ) {
+            unsigned int key = U.extractMin();
+            assert(key >= previous);
+            previous = key;
+        }
+        int fv, rv;
+        for ( int round = 0; F.size(); round++ ) {
+            assert(R.min() == F.min() && R.key(R.top()) == F.min());
+            long long key = F.extractMin(fv);
+            assert(R.extractMin(rv) == key && fv == rv);
+            present[rv] = false;
+            long long base = (key - rv) / ARR_SIZE;
+            // push, lower or remove a random node, never to or below key.
+            // nodes are only pushed for a while, so that the heap runs empty
+            int i = rand() % ARR_SIZE;
+            if ( !present[i] ) {
+                if ( round > ARR_SIZE * 2 ) {
+                    continue;
+                }
+                long long next = (base + 1 + rand() % 100) * ARR_SIZE + i;
+                fh[i] = F.insert(next, i);
+                rh[i] = R.insert(next, i);
+                present[i] = true;
+            }
+            else if ( i % 4 ) {
+                long long current = (R.key(rh[i]) - i) / ARR_SIZE;
+                if ( current <= base + 1 ) {
+                    continue;
+                }
+                long long lower = (base + 1 + (current - base - 1) / 2) * ARR_SIZE + i;
+                F.decrease_key(fh[i], lower);
+                R.decrease_key(rh[i], lower);
+            }
+            else if ( i % 4 == 0 ) {
+                F.erase(fh[i]);
+                R.erase(rh[i]);
+                present[i] = false;
+            }
+            assert(F.size() == static_cast<int>(R.size()));
+        }
+        // a peek does not raise the floor for later insertions, and among
+        // equal keys extractMin takes the node top named
+        RadixHeap<int, int> P;
+        P.insert(5, 0);
+        P.insert(10, 1);
+        assert(P.min() == 5 && P.key(P.top()) == 5);
+        P.insert(3, 2);
+        P.insert(10, 3);
+        assert(P.min() == 3 && P.extractMin() == 3 && P.extractMin() == 5);
+        RadixHeap<int, int>::handle h = P.top();
+        int tied = P.value(h);
+        assert(P.extractMin(rv) == 10 && rv == tied);
+        assert(P.extractMin(rv) == 10 && rv != tied && P.empty());
+        count++;
+    }
+
+    // MULTIQUEUE TESTS
+    /*
+     * concurrent producers and consumers lose and duplicate nothing; a single
+     * consumer in strict mode sees keys in order, and in relaxed mode sees
+     * them roughly in order
+     */
+    {
+        typedef MultiQueue<int, int> Queue;
+        const int THREADS = 4;
+        Queue::Mode modes[2] = { Queue::RELAXED, Queue::STRICT };
+        for ( int mode = 0; mode < 2; mode++ ) {
+            Queue Q(THREADS, 2, modes[mode]);
+            vector<int> seen(ARR_SIZE * THREADS, 0);
+            vector<thread> workers;
+            for ( int t = 0; t < THREADS; t++ ) {
+                workers.push_back(thread([&Q, &seen, t]() {
+                    int key, value;
+                    for ( int i = t; i < ARR_SIZE * THREADS; i += THREADS ) {
+                        Q.push(i, i);
+                        // pop about as often as pushing
+                        if ( i % 2 && Q.try_pop(key, value) ) {
+                            seen[value]++;
+                        }
+                    }
+                }));
+            }
+            for ( int t = 0; t < THREADS; t++ ) {
+                workers[t].join();
+            }
+            int key, value, popped = 0, inversions = 0, previous = -1;
+            while ( Q.try_pop(key, value) ) {
+                assert(key == value);
+                seen[value]++;
+                inversions += key < previous;
+                previous = key;
+                popped++;
+            }
+            assert(Q.empty() && !Q.try_pop(key));
+            for ( int i = 0; i < ARR_SIZE * THREADS; i++ ) {
+                assert(seen[i] == 1);
+            }
+            assert(modes[mode] == Queue::RELAXED || inversions == 0);
+            assert(inversions < popped / 2);
+        }
+        count++;
+    }
+
+    // EXECUTOR TESTS
+    /*
+     * a single worker runs queued tasks in priority order, after any
+     * reprioritization and without the cancelled ones; tasks of several
+     * workers, some submitted from other tasks, all run once and are timed;
+     * a task that throws is FAILED; deadlines work as priorities
+     */
+    {
+        vector<int> order;
+        atomic<bool> release(false);
+        {
+            Executor<int> E(1);
+            E.submit([&release]() {
+                while ( !release ) {
+                    this_thread::yield();
+                }
+            }, 0);
+            // the worker is now busy or about to be, so nothing below runs
+            // before release
+            vector<Executor<int>::task> tasks;
+            for ( int i = 0; i < 100; i++ ) {
+                tasks.push_back(E.submit([&order, i]() { order.push_back(i); },
+                                         (i * 37) % 100 + 1));
+            }
+            assert(E.reprioritize(tasks[50], 1000));
+            assert(E.reprioritize(tasks[60], -5));
+            assert(E.cancel(tasks[70]));
+            assert(!E.cancel(tasks[70]) && !E.reprioritize(tasks[70], 3));
+            assert(tasks[70].status() == Executor<int>::CANCELLED);
+            assert(tasks[80].status() == Executor<int>::QUEUED);
+            release = true;
+            E.wait();
+            assert(E.pending() == 0 && E.latency().count() == 100);
+            assert(tasks[80].status() == Executor<int>::DONE);
+            assert(!E.cancel(tasks[80]));
+        }
+        assert(order.size() == 99);
+        assert(order.front() == 60 && order.back() == 50);
+        for ( size_t i = 2; i + 1 < order.size(); i++ ) {
+            assert((order[i - 1] * 37) % 100 < (order[i] * 37) % 100);
+        }
+
+        atomic<int> runs(0);
+        Executor<double> E(4);
+        for ( int i = 0; i < ARR_SIZE; i++ ) {
+            E.submit([&E, &runs, i]() {
+                runs++;
+                if ( i % 4 == 0 ) {
+                    E.submit([&runs]() { runs++; }, -1.0 * i);
+                }
+            }, rand());
+        }
+        Executor<double>::task failed =
+            E.submit([]() { throw Executor<double>::Status(); }, 0);
+        E.wait();
+        assert(runs == ARR_SIZE + ARR_SIZE / 4);
+        assert(E.latency().count() == static_cast<unsigned>(runs) + 1);
+        assert(E.latency().percentile(0.5) <= E.latency().percentile(0.99));
+        assert(failed.status() == Executor<double>::FAILED && failed.error());
+
+        typedef chrono::steady_clock::time_point Deadline;
+        Deadline now = chrono::steady_clock::now();
+        vector<int> missed;
+        {
+            Executor<Deadline> D(1);
+            D.submit([&release]() {
+                while ( release ) {
+                    this_thread::yield();
+                }
+            }, now);
+            for ( int i = 0; i < 10; i++ ) {
+                D.submit([&missed, i]() { missed.push_back(i); },
+                         now + chrono::milliseconds(10 - i));
+            }
+            release = false;
+        }
+        for ( int i = 0; i < 10; i++ ) {
+            assert(missed[i] == 9 - i);
+        }
+        count++;
+    }
+
+    // TIMER WHEEL TESTS
+    /*
+     * timers near, far and beyond the wheel, half of them cancelled, fire
+     * once each, in deadline order, in the advance that reaches their
+     * deadline; timers added while firing fire too
+     */
+    {
+        typedef TimerWheel<int, FakeClock> Wheel;
+        FakeClock clock(1000);
+        Wheel W(clock);
+        vector<unsigned long long> deadline;
+        vector<int> fired;
+        vector<Wheel::handle> timers;
+        unsigned long long spans[3] = { 100, 100000, 1ULL << 30 };
+        for ( int i = 0; i < ARR_SIZE; i++ ) {
+            unsigned long long d = W.now() +
+                                   (unsigned long long)rand() * rand() % spans[i % 3];
+            deadline.push_back(d <= W.now() ? W.now() + 1 : d);
+            fired.push_back(0);
+            timers.push_back(W.add(d, i));
+            assert(W.active(timers[i]) && W.deadline(timers[i]) == deadline[i]);
+        }
+        int cancelled = 0;
+        for ( int i = 0; i < ARR_SIZE; i += 2 ) {
+            assert(W.cancel(timers[i]));
+            assert(!W.cancel(timers[i]) && !W.active(timers[i]));
+            fired[i] = -1;
+            cancelled++;
+        }
+        assert(W.size() == static_cast<size_t>(ARR_SIZE - cancelled));
+        assert(W.next_event() <= deadline[1] && W.next_event() > W.now());
+        unsigned long long previous = 0;
+        int added = 0;
+        while ( !W.empty() ) {
+            unsigned long long from = W.now();
+            clock.advance(rand() % 4 ? rand() % 1000 : (unsigned long long)rand() * 64);
+            W.poll([&](unsigned long long d, int &id) {
+                assert(d > from && d <= clock.now() && d >= previous);
+                previous = d;
+                if ( id >= ARR_SIZE ) {
+                    return;
+                }
+                assert(deadline[id] == d && fired[id] == 0);
+                fired[id]++;
+                if ( id % 7 == 0 ) {
+                    W.add(d + id % 5000, ARR_SIZE + id);
+                    added++;
+                }
+            });
+            assert(W.now() == clock.now());
+        }
+        for ( int i = 0; i < ARR_SIZE; i++ ) {
+            assert(fired[i] == (i % 2 ? 1 : -1));
+            assert(!W.active(timers[i]));
+        }
+        assert(added > 0 && W.next_event() == ~0ULL);
+        count++;
+    }
+
+    // EXTERNAL SORT TESTS
+    /*
+     * random records sorted through many small runs and several merge passes
+     * come out as std::sort orders them, through either engine and
+     * comparator; sorted input makes a single run; temporary runs are
+     * removed
+     */
+    {
+        const char* input = "tests_sort.in";
+        const char* output = "tests_sort.out";
+        vector<int> records;
+        {
+            RunWriter<int> writer(input, 100);
+            for ( int i = 0; i < ARR_SIZE * 5; i++ ) {
+                records.push_back(rand());
+                writer.write(records.back());
+            }
+        }
+        ExternalSort<int> S("tests_sort.run", 1000, 128, 4);
+        vector<string> runs = S.runs(input);
+        assert(runs.size() > 4 && runs.size() < records.size() / 1000);
+        assert(S.merge(runs, output) == records.size());
+        for ( size_t i = 0; i < runs.size(); i++ ) {
+            assert(fopen(runs[i].c_str(), "rb") == NULL);
+        }
+        sort(records.begin(), records.end());
+        vector<int> sorted;
+        {
+            RunReader<int> reader(output, 1000);
+            for ( const int* r; (r = reader.next()) != NULL; ) {
+                sorted.push_back(*r);
+            }
+        }
+        assert(sorted == records);
+
+        ExternalSort<int> T("tests_sort.run", 1000);
+        runs = T.runs(output);
+        assert(runs.size() == 1);
+        T.merge(runs, output);
+
+        typedef FibHeap<int, unsigned int, greater<int> > MaxHeap;
+        ExternalSort<int, greater<int>, MaxHeap> R("tests_sort.run", 500, 64, 8);
+        assert(R.sort(input, output) == records.size());
+        sorted.clear();
+        {
+            RunReader<int> reader(output, 64);
+            for ( const int* r; (r = reader.next()) != NULL; ) {
+                sorted.push_back(*r);
+            }
+        }
+        assert(equal(sorted.begin(), sorted.end(), records.rbegin()));
+
+        bool thrown = false;
+        try {
+            S.sort("tests_sort.missing", output);
+        }
+        catch ( IOError &e ) {
+            thrown = e.path == "tests_sort.missing";
+        }
+        assert(thrown);
+        remove(input);
+        remove(output);
+        count++;
+    }
+
+    // GRAPH TESTS
+    /*
+     * Dijkstra on every engine agrees with Bellman-Ford on a random graph,
+     * including from several sources and when stopped at a target; Prim's
+     * forest weighs what Kruskal's does; a DIMACS file loads, and a broken
+     * one is reported at the right line
+     */
+    {
+        typedef Graph<long long> G;
+        const int V = 2000;
+        vector<G::Edge> edges(1);
+        edges[0].from = 0;
+        edges[0].to = 1;
+        edges[0].weight = 1;
+        for ( int i = 0; i < V * 4; i++ ) {
+            G::Edge e = { G::vertex_type(rand() % V), G::vertex_type(rand() % V),
+                          rand() % 1000 };
+            edges.push_back(e);
+        }
+        G g(V, edges);
+        vector<long long> expected(V, -1);
+        expected[0] = 0;
+        for ( bool changed = true; changed; ) {
+            changed = false;
+            for ( size_t i = 0; i < edges.size(); i++ ) {
+                long long d = expected[edges[i].from] + edges[i].weight;
+                if ( expected[edges[i].from] >= 0 &&
+                     (expected[edges[i].to] < 0 || d < expected[edges[i].to]) ) {
+                    expected[edges[i].to] = d;
+                    changed = true;
+                }
+            }
+        }
+        ShortestPaths<long long> fib(g);
+        ShortestPaths<long long, PairingHeap<long long, unsigned int> > pairing(g);
+        ShortestPaths<long long, DaryHeap<long long, 4, unsigned int> > dary(g);
+        ShortestPaths<long long, RadixHeap<long long, unsigned int> > radix(g);
+        fib.run(0);
+        pairing.run(0);
+        dary.run(0);
+        radix.run(0);
+        for ( int v = 0; v < V; v++ ) {
+            assert(fib.settled(v) == (expected[v] >= 0));
+            if ( expected[v] >= 0 ) {
+                assert(fib.distance(v) == expected[v]);
+                assert(pairing.distance(v) == expected[v]);
+                assert(dary.distance(v) == expected[v]);
+                assert(radix.distance(v) == expected[v]);
+                // the path is as long as the distance
+                vector<G::vertex_type> path = fib.path(v);
+                assert(path.front() == 0 && path.back() == G::vertex_type(v));
+                long long length = 0;
+                for ( size_t i = 1; i < path.size(); i++ ) {
+                    long long best = -1;
+                    for ( const G::Arc* a = g.begin(path[i - 1]);
+                          a != g.end(path[i - 1]); ++a ) {
+                        if ( a->to == path[i] && (best < 0 || a->weight < best) ) {
+                            best = a->weight;
+                        }
+                    }
+                    length += best;
+                }
+                assert(length == expected[v]);
+            }
+        }
+
+        // the farthest vertex from 0, which stops the search last
+        int target = max_element(expected.begin(), expected.end()) - expected.begin();
+        fib.run(0, target);
+        assert(fib.settled(target) && fib.distance(target) == expected[target]);
+        assert(fib.settled() <= static_cast<size_t>(V));
+        G::vertex_type sources[3] = { 0, 5, 17 };
+        fib.run_sources(sources, sources + 3);
+        dary.run(5);
+        for ( int v = 0; v < V; v++ ) {
+            if ( fib.settled(v) && expected[v] >= 0 ) {
+                assert(fib.distance(v) <= expected[v]);
+            }
+            if ( dary.settled(v) ) {
+                assert(fib.distance(v) <= dary.distance(v));
+            }
+        }
+        assert(fib.distance(17) == 0 && fib.parent(17) == G::NONE);
+
+        G u(V, edges, true);
+        vector<G::vertex_type> parent;
+        long long forest = prim(u, parent);
+        long long forest_dary = prim<long long, DaryHeap<long long, 4, unsigned int> >(u, parent);
+        sort(edges.begin(), edges.end(), [](const G::Edge &a, const G::Edge &b) {
+            return a.weight < b.weight;
+        });
+        vector<int> leader(V);
+        for ( int v = 0; v < V; v++ ) {
+            leader[v] = v;
+        }
+        long long kruskal = 0;
+        for ( size_t i = 0; i < edges.size(); i++ ) {
+            int a = edges[i].from, b = edges[i].to;
+            while ( leader[a] != a ) {
+                a = leader[a] = leader[leader[a]];
+            }
+            while ( leader[b] != b ) {
+                b = leader[b] = leader[leader[b]];
+            }
+            if ( a != b ) {
+                leader[a] = b;
+                kruskal += edges[i].weight;
+            }
+        }
+        assert(forest == kruskal && forest_dary == kruskal);
+
+        FILE* file = fopen("tests_graph.gr", "w");
+        fprintf(file, "c a small graph\np sp 3 3\na 1 2 5\na 2 3 7\nc\na 1 3 20\n");
+        fclose(file);
+        G d = G::load_dimacs("tests_graph.gr");
+        assert(d.vertices() == 3 && d.arcs() == 3 && d.degree(0) == 2);
+        ShortestPaths<long long> small(d);
+        small.run(0);
+        assert(small.distance(2) == 12 && small.path(2).size() == 3);
+        file = fopen("tests_graph.gr", "w");
+        fprintf(file, "p sp 3 2\na 1 2 5\na 1 4 1\n");
+        fclose(file);
+        size_t line = 0;
+        try {
+            G::load_dimacs("tests_graph.gr");
+        }
+        catch ( G::FormatError &e ) {
+            line = e.line;
+        }
+        assert(line == 3);
+        // an arc count far beyond the file is only a hint, and a negative
+        // weight is refused
+        file = fopen("tests_graph.gr", "w");
+        fprintf(file, "p sp 5 99999999999999999\na 1 2 5\n");
+        fclose(file);
+        d = G::load_dimacs("tests_graph.gr");
+        assert(d.vertices() == 5 && d.arcs() == 1);
+        file = fopen("tests_graph.gr", "w");
+        fprintf(file, "p sp 3 2\na 1 2 5\na 2 3 -5\n");
+        fclose(file);
+        line = 0;
+        try {
+            G::load_dimacs("tests_graph.gr");
+        }
+        catch ( G::FormatError &e ) {
+            line = e.line;
+        }
+        assert(line == 3);
+        remove("tests_graph.gr");
+        count++;
+    }
+
+    // TOP-K TESTS
+    /*
+     * a TopK keeps the k greatest keys of a stream with their payloads,
+     * rejecting the rest; partial TopKs of several threads merge into the
+     * TopK of the whole stream, on either engine; std::greater keeps the
+     * least keys
+     */
+    {
+        const int K = 100;
+        vector<int> stream;
+        for ( int i = 0; i < ARR_SIZE * 4; i++ ) {
+            stream.push_back(rand());
+        }
+        vector<int> expected(stream);
+        sort(expected.begin(), expected.end(), greater<int>());
+        expected.resize(K);
+
+        TopK<int, int> T(K);
+        int kept = 0;
+        for ( size_t i = 0; i < stream.size(); i++ ) {
+            kept += T.offer(stream[i], -stream[i]);
+            assert(T.size() == min<size_t>(i + 1, K));
+        }
+        assert(T.full() && T.threshold() == expected[K - 1]);
+        assert(kept >= K && kept < ARR_SIZE);
+        assert(!T.offer(expected[K - 1], 0));
+        vector<pair<int, int> > items = T.take();
+        assert(T.empty() && items.size() == K);
+        for ( int i = 0; i < K; i++ ) {
+            assert(items[i].first == expected[i] && items[i].second == -expected[i]);
+        }
+
+        typedef TopK<int, void, less<int>, DaryHeap<int, 4> > DaryTopK;
+        const int THREADS = 4;
+        vector<DaryTopK> partial(THREADS, DaryTopK(K));
+        vector<TopK<int> > fib(THREADS, TopK<int>(K));
+        vector<thread> workers;
+        for ( int t = 0; t < THREADS; t++ ) {
+            workers.push_back(thread([&, t]() {
+                for ( size_t i = t; i < stream.size(); i += THREADS ) {
+                    partial[t].offer(stream[i]);
+                    fib[t].offer(stream[i]);
+                }
+            }));
+        }
+        for ( int t = 0; t < THREADS; t++ ) {
+            workers[t].join();
+        }
+        for ( int t = 1; t < THREADS; t++ ) {
+            partial[0].merge(move(partial[t]));
+            fib[0].merge(move(fib[t]));
+            assert(partial[t].empty() && fib[t].empty());
+        }
+        vector<pair<int, NoValue> > merged = partial[0].take();
+        vector<pair<int, NoValue> > fib_merged = fib[0].take();
+        assert(merged.size() == K && fib_merged.size() == K);
+        for ( int i = 0; i < K; i++ ) {
+            assert(merged[i].first == expected[i] && fib_merged[i].first == expected[i]);
+        }
+
+        TopK<int, void, greater<int> > least(3);
+        for ( size_t i = 0; i < stream.size(); i++ ) {
+            least.offer(stream[i]);
+        }
+        sort(stream.begin(), stream.end());
+        assert(least.threshold() == stream[2]);
+        vector<pair<int, NoValue> > smallest = least.take();
+        assert(smallest[0].first == stream[0] && smallest[2].first == stream[2]);
+        TopK<int> none(0);
+        assert(!none.offer(1) && none.empty());
+        count++;
+    }
+
+    // SOFT HEAP TESTS
+    /*
+     * a SoftHeap gives back every item once with its payload, and the key
+     * extracted at step i has rank below i + epsilon * n. an item extracted
+     * after a larger key must have been corrupted, which bounds corrupted()
+     * from below, and fewer than 2^r items are never corrupted; approximate_median
+     * lands within its bounds and soft_select agrees with std::nth_element,
+     * duplicates included
+     */
+    {
+        const int N = ARR_SIZE * 2;
+        vector<int> keys(N);
+        for ( int i = 0; i < N; i++ ) {
+            keys[i] = i;
+        }
+        random_shuffle(keys.begin(), keys.end());
+        const double epsilons[] = { 0.5, 0.1, 0.01 };
+        for ( int t = 0; t < 3; t++ ) {
+            SoftHeap<int, int> S(epsilons[t]);
+            for ( int i = 0; i < N; i++ ) {
+                S.insert(keys[i], -keys[i]);
+            }
+            assert(S.size() == N && S.epsilon() == epsilons[t]);
+            vector<bool> seen(N, false);
+            int largest = -1;
+            size_t overtaken = 0;
+            for ( int i = 0; i < N; i++ ) {
+                int value;
+                int key = S.extractMin(value);
+                assert(value == -key && !seen[key]);
+                assert(key < i + epsilons[t] * N + 1);
+                seen[key] = true;
+                if ( key < largest ) {
+                    overtaken++;
+                }
+                largest = max(largest, key);
+            }
+            assert(S.empty() && S.corrupted() >= overtaken);
+            assert(t > 0 || overtaken > 0);
+        }
+        // with epsilon = 0.01 nodes up to rank 9 hold a single item each
+        vector<int> small(511);
+        for ( int i = 0; i < 511; i++ ) {
+            small[i] = i;
+        }
+        random_shuffle(small.begin(), small.end());
+        SoftHeap<int> uncorrupted(0.01);
+        for ( int i = 0; i < 511; i++ ) {
+            uncorrupted.insert(small[i]);
+        }
+        for ( int i = 0; i < 511; i++ ) {
+            assert(uncorrupted.extractMin() == i);
+        }
+        assert(uncorrupted.corrupted() == 0);
+        SoftHeap<int> exact(0.5);
+        exact.insert(1);
+        assert(exact.min() == 1 && exact.extractMin() == 1 && exact.corrupted() == 0);
+
+        int median = approximate_median(keys.begin(), keys.end(), 0.1);
+        assert(median >= N / 2 - N / 20 - 1 && median <= N / 2 + N / 20);
+
+        vector<int> values(N);
+        for ( int i = 0; i < N; i++ ) {
+            values[i] = rand() % 1000;
+        }
+        const size_t ranks[] = { 0, 1, N / 3, N / 2, N - 1 };
+        for ( int i = 0; i < 5; i++ ) {
+            vector<int> selected(values), expected(values);
+            vector<int>::iterator kth = soft_select(selected.begin(), selected.end(), ranks[i]);
+            nth_element(expected.begin(), expected.begin() + ranks[i], expected.end());
+            assert(kth == selected.begin() + ranks[i] && *kth == expected[ranks[i]]);
+            assert(*max_element(selected.begin(), kth + 1) == *kth);
+            assert(*min_element(kth, selected.end()) == *kth);
+        }
+        vector<int> few(values.begin(), values.begin() + 10);
+        vector<int> sorted_few(few);
+        sort(sorted_few.begin(), sorted_few.end());
+        assert(*soft_select(few.begin(), few.end(), 4, greater<int>()) == sorted_few[5]);
+        count++;
+    }
+
+    // SNAPSHOT TESTS
+    /*
+     * a FibHeap saved and restored comes back with the same forest: the two
+     * give the same keys and payloads in the same order through further
+     * decreases and extractions, and a truncated file is refused; a
+     * DurableHeap reopened from its snapshot and journal holds the same items
+     * under the same ids as the heap that wrote them, even after a crash cut
+     * its last journal record short
+     */
+    {
+        FibHeap<int, int> F, R;
+        vector<FibHeap<int, int>::handle> live;
+        for ( int i = 0; i < ARR_SIZE; i++ ) {
+            live.push_back(F.insert(rand() % ARR_SIZE, i));
+        }
+        for ( int i = 0; i < ARR_SIZE / 4; i++ ) {
+            F.decrease_key(live[i * 3], F.key(live[i * 3]) - 1000);
+        }
+        for ( int i = 0; i < ARR_SIZE / 8; i++ ) {
+            F.extractMin();
+        }
+        FILE* file = fopen("tests_snapshot.bin", "wb");
+        F.save(file);
+        fclose(file);
+        vector<FibHeap<int, int>::handle> restored;
+        file = fopen("tests_snapshot.bin", "rb");
+        R.restore(file, back_inserter(restored));
+        fclose(file);
+        assert(R.size() == F.size() && restored.size() == size_t(F.size()));
+        for ( size_t i = 0; i < restored.size(); i += 7 ) {
+            R.decrease_key(restored[i], R.key(restored[i]) - 500);
+        }
+        FibHeap<int, int> G(F);
+        file = fopen("tests_snapshot.bin", "rb");
+        restored.clear();
+        FibHeap<int, int> S;
+        S.restore(file, back_inserter(restored));
+        fclose(file);
+        int a, b;
+        while ( !G.empty() ) {
+            assert(G.extractMin(a) == S.extractMin(b) && a == b);
+        }
+        assert(S.empty() && R.size() == F.size());
+
+        // cuts the last node short
+        file = fopen("tests_snapshot.bin", "rb");
+        vector<char> bytes;
+        for ( int c; (c = fgetc(file)) != EOF; ) {
+            bytes.push_back(char(c));
+        }
+        fclose(file);
+        file = fopen("tests_snapshot.bin", "wb");
+        fwrite(bytes.data(), 1, bytes.size() - 3, file);
+        fclose(file);
+        FibHeap<int, int> T;
+        T.insert(1, 1);
+        bool refused = false;
+        file = fopen("tests_snapshot.bin", "rb");
+        try {
+            T.restore(file);
+        }
+        catch ( FibHeap<int, int>::SnapshotError& ) {
+            refused = true;
+        }
+        fclose(file);
+        assert(refused && T.size() == 1 && T.extractMin() == 1);
+
+        // forests no heap could have built: a root of degree 100, one of
+        // degree 40 over 40 leaves, and a header claiming 2^32 - 1 nodes
+        // that are not there. each is refused before the heap changes
+        unsigned long long shapes[3][2] = { { 101, 100 }, { 41, 40 },
+                                            { 0xffffffffull, 0 } };
+        for ( int shape = 0; shape < 3; shape++ ) {
+            uint64_t header[5];
+            memcpy(header, bytes.data(), sizeof(header));
+            header[3] = shapes[shape][0];
+            header[4] = 1;
+            file = fopen("tests_snapshot.bin", "wb");
+            fwrite(header, sizeof(header), 1, file);
+            for ( unsigned int i = 0; shape < 2 && i < shapes[shape][0]; i++ ) {
+                int record[3] = { int(i), int(i), int(i ? 0 : shapes[shape][1] << 1) };
+                fwrite(record, sizeof(record), 1, file);
+            }
+            fclose(file);
+            refused = false;
+            file = fopen("tests_snapshot.bin", "rb");
+            try {
+                T.restore(file);
+            }
+            catch ( FibHeap<int, int>::SnapshotError& ) {
+                refused = true;
+            }
+            fclose(file);
+            assert(refused && T.empty());
+        }
+        remove("tests_snapshot.bin");
+
+        // the reference model: key and payload of every live id
+        remove("tests_durable.snapshot");
+        remove("tests_durable.journal");
+        vector<pair<int, int> > model;
+        vector<bool> present;
+        {
+            DurableHeap<int, int> D("tests_durable");
+            for ( int i = 0; i < ARR_SIZE; i++ ) {
+                int op = rand() % 8;
+                if ( op < 4 || D.empty() ) {
+                    int key = rand() % ARR_SIZE;
+                    DurableHeap<int, int>::id_type id = D.insert(key, i);
+                    if ( id >= model.size() ) {
+                        model.resize(id + 1);
+                        present.resize(id + 1);
+                    }
+                    assert(!present[id]);
+                    model[id] = make_pair(key, i);
+                    present[id] = true;
+                }
+                else if ( op < 6 ) {
+                    DurableHeap<int, int>::id_type id = D.top();
+                    int value;
+                    int key = D.extractMin(value);
+                    assert(present[id] && model[id] == make_pair(key, value));
+                    present[id] = false;
+                }
+                else {
+                    size_t id = rand() % model.size();
+                    if ( present[id] && op == 6 ) {
+                        D.decrease_key(id, model[id].first - 10);
+                        model[id].first -= 10;
+                    }
+                    else if ( present[id] ) {
+                        D.erase(id);
+                        present[id] = false;
+                    }
+                }
+                if ( i == ARR_SIZE / 2 ) {
+                    D.checkpoint();
+                    assert(D.journaled() == 0);
+                }
+            }
+        }
+        {
+            FILE* journal = fopen("tests_durable.journal", "ab");
+            fputs("torn", journal);
+            fclose(journal);
+        }
+        for ( int reopen = 0; reopen < 2; reopen++ ) {
+            DurableHeap<int, int> D("tests_durable");
+            size_t live_count = 0;
+            for ( size_t id = 0; id < model.size(); id++ ) {
+                assert(D.contains(id) == present[id]);
+                if ( present[id] ) {
+                    live_count++;
+                    assert(D.key(id) == model[id].first && D.value(id) == model[id].second);
+                }
+            }
+            assert(D.size() == live_count);
+            if ( reopen == 0 ) {
+                DurableHeap<int, int>::id_type id = D.insert(-1, -1);
+                if ( id >= model.size() ) {
+                    model.resize(id + 1);
+                    present.resize(id + 1);
+                }
+                model[id] = make_pair(-1, -1);
+                present[id] = true;
+                D.checkpoint();
+            }
+            else {
+                int value;
+                assert(D.extractMin(value) == -1 && value == -1);
+            }
+        }
+        // a slot count beyond the ids in the snapshot is refused rather
+        // than allocated
+        {
+            FILE* snapshot = fopen("tests_durable.snapshot", "r+b");
+            uint64_t slots = 0xffffffffull;
+            fseek(snapshot, 16, SEEK_SET);
+            fwrite(&slots, sizeof(slots), 1, snapshot);
+            fclose(snapshot);
+            bool refused = false;
+            try {
+                DurableHeap<int, int> D("tests_durable");
+            }
+            catch ( IOError& ) {
+                refused = true;
+            }
+            assert(refused);
+        }
+        remove("tests_durable.snapshot");
+        remove("tests_durable.journal");
+        count++;
+    }
 
     cout << count << " tests passed!" << endl;
-    cin.get();
     return 0;
 }
@@ -0,0 +1,404 @@
+/* polybench
+ ******************************************************************************
+ *
+ * benchmarks every Polynomial operation over a sweep of degrees, for dense
+ * and sparse operands.
+ *
+ *      polybench [--max-degree n] [--budget s] [--min-time s] [--json]
+ *                [--only op,op,...]
+ *
+ * degrees run 1, 3, 10, 30, ... up to --max-degree (default 10^6). an
+ * operation stops climbing the sweep once a single call at the next degree is
+ * predicted to take longer than --budget seconds (default 1), which keeps the
+ * quadratic operations finite.
+ * each measurement repeats the operation until --min-time seconds (default
+ * 0.1) have passed.
+ *
+ * sparse operands have about 1% nonzero coefficients, dense ones have all of
+ * them drawn uniformly from [-1, 1]. inputs are generated from a fixed seed so
+ * runs on different commits see the same polynomials.
+ *
+ * one record is written per (operation, shape, degree) as CSV, or as one JSON
+ * object per line with --json:
+ *
+ *      operation,shape,degree,iterations,ns_per_op,allocs_per_op,
+ *      bytes_per_op,error
+ *
+ * allocations are counted by replacing the global operator new. error is the
+ * largest deviation from a long double reference, scaled by the sum of the
+ * magnitudes of the terms involved so that cancellation does not dominate
+ * it; exact operations report 0.
+ *
+ * build:
+ *      g++ -O2 -std=c++11 -I../FibonacciHeap polybench.cpp polynomial.cpp \
+ *          polycache.cpp -o polybench
+ *
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "polynomial.h"
+
+using namespace std;
+
+/*************************
+ * allocation accounting
+ *************************/
+
+static unsigned long long allocations = 0;
+static unsigned long long allocated_bytes = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    allocated_bytes += size;
+    void* memory = malloc(size ? size : 1);
+    if ( !memory ) {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+/*********
+ * inputs
+ *********/
+
+mt19937_64 generator(12345);
+
+// a polynomial of exactly degree deg. sparse ones keep about 1% of the lower
+// coefficients and a leading coefficient of 1
+Polynomial randomPolynomial(int deg, bool sparse) {
+    uniform_real_distribution<double> value(-1, 1);
+    uniform_real_distribution<double> chance(0, 1);
+    Polynomial poly(deg);
+    for ( int i = 0; i < deg; i++ ) {
+        poly[i] = sparse ? (chance(generator) < 0.01 ? value(generator) : 0)
+                         : value(generator);
+    }
+    if ( !sparse ) {
+        double lead = value(generator);
+        poly[deg] = lead != 0 ? lead : 1;
+    }
+    return poly;
+}
+
+vector<long double> widen(Polynomial &poly) {
+    vector<long double> wide(poly.getDegree()+1);
+    for ( int i = 0; i <= poly.getDegree(); i++ ) {
+        wide[i] = poly[i];
+    }
+    return wide;
+}
+
+// coefficient i of a polynomial, 0 beyond its degree
+long double term(const vector<long double> &poly, int i) {
+    return i >= 0 && i < static_cast<int>(poly.size()) ? poly[i] : 0;
+}
+
+/************
+ * reference
+ ************/
+
+// largest scaled distance between computed and a long double convolution
+double productError(Polynomial &a, Polynomial &b, Polynomial &product) {
+    vector<long double> x = widen(a), y = widen(b), z = widen(product);
+    double error = 0;
+    for ( int k = 0; k < static_cast<int>(x.size() + y.size()) - 1; k++ ) {
+        long double exact = 0, scale = 0;
+        for ( int j = max(0, k - static_cast<int>(y.size()) + 1);
+              j <= min(k, static_cast<int>(x.size()) - 1); j++ ) {
+            exact += x[j] * y[k-j];
+            scale += fabsl(x[j] * y[k-j]);
+        }
+        if ( scale > 0 ) {
+            error = max(error, static_cast<double>(
+                fabsl(term(z, k) - exact) / scale));
+        }
+    }
+    return error;
+}
+
+// largest scaled coefficient of (a +/- b) - computed
+double sumError(Polynomial &a, Polynomial &b, Polynomial &sum, int sign) {
+    vector<long double> x = widen(a), y = widen(b), z = widen(sum);
+    double error = 0;
+    int size = static_cast<int>(max(x.size(), y.size()));
+    for ( int k = 0; k < size; k++ ) {
+        long double scale = fabsl(term(x, k)) + fabsl(term(y, k));
+        if ( scale > 0 ) {
+            error = max(error, static_cast<double>(
+                fabsl(term(z, k) - (term(x, k) + sign*term(y, k))) / scale));
+        }
+    }
+    return error;
+}
+
+// largest scaled coefficient of dividend - (quotient*divisor + remainder)
+double divisionError(Polynomial &dividend, Polynomial &divisor,
+                     Polynomial &quotient, Polynomial &remainder) {
+    vector<long double> a = widen(dividend), d = widen(divisor),
+                        q = widen(quotient), r = widen(remainder);
+    double error = 0;
+    for ( int k = 0; k < static_cast<int>(a.size()); k++ ) {
+        long double rebuilt = term(r, k), scale = fabsl(term(r, k)) +
+                                                  fabsl(a[k]);
+        for ( int j = 0; j < static_cast<int>(q.size()); j++ ) {
+            rebuilt += q[j] * term(d, k-j);
+            scale += fabsl(q[j] * term(d, k-j));
+        }
+        if ( scale > 0 ) {
+            error = max(error, static_cast<double>(
+                fabsl(a[k] - rebuilt) / scale));
+        }
+    }
+    return error;
+}
+
+// largest scaled distance of evaluate() from a long double Horner evaluation,
+// checked on the first 64 points to bound the cost at high degree
+double evaluationError(Polynomial &poly, const vector<double> &points,
+                       const vector<double> &values) {
+    vector<long double> c = widen(poly);
+    double error = 0;
+    for ( size_t j = 0; j < points.size() && j < 64; j++ ) {
+        long double exact = 0, scale = 0, power = 1;
+        for ( int i = static_cast<int>(c.size()) - 1; i >= 0; i-- ) {
+            exact = exact * points[j] + c[i];
+        }
+        for ( size_t i = 0; i < c.size(); i++ ) {
+            scale += fabsl(c[i] * power);
+            power *= points[j];
+        }
+        // values that underflow a double are not evaluation error
+        if ( scale > numeric_limits<double>::min() ) {
+            error = max(error, static_cast<double>(
+                fabsl(values[j] - exact) / scale));
+        }
+    }
+    return error;
+}
+
+/*************
+ * measurement
+ *************/
+
+struct Record {
+    string operation;
+    string shape;
+    int degree;
+    long iterations;
+    double seconds_per_op;
+    double seconds_per_call;
+    double allocs_per_op;
+    double bytes_per_op;
+    double error;
+};
+
+// repeats run() until min_time has passed and fills in the per-op figures
+void measure(Record &record, double min_time, const function<void()> &run) {
+    typedef chrono::steady_clock Clock;
+    unsigned long long first_allocations = allocations;
+    unsigned long long first_bytes = allocated_bytes;
+    long iterations = 0;
+    double elapsed = 0;
+    Clock::time_point start = Clock::now();
+    do {
+        run();
+        iterations++;
+        elapsed = chrono::duration<double>(Clock::now() - start).count();
+    } while ( elapsed < min_time );
+    record.iterations = iterations;
+    record.seconds_per_op = elapsed / iterations;
+    record.seconds_per_call = record.seconds_per_op;
+    record.allocs_per_op = static_cast<double>(allocations -
+                                               first_allocations) / iterations;
+    record.bytes_per_op = static_cast<double>(allocated_bytes -
+                                              first_bytes) / iterations;
+}
+
+void print(const Record &record, bool json) {
+    if ( json ) {
+        printf("{\"operation\":\"%s\",\"shape\":\"%s\",\"degree\":%d,"
+               "\"iterations\":%ld,\"ns_per_op\":%.1f,\"allocs_per_op\":%.2f,"
+               "\"bytes_per_op\":%.1f,\"error\":%.3e}\n",
+               record.operation.c_str(), record.shape.c_str(), record.degree,
+               record.iterations, record.seconds_per_op * 1e9,
+               record.allocs_per_op, record.bytes_per_op, record.error);
+    }
+    else {
+        printf("%s,%s,%d,%ld,%.1f,%.2f,%.1f,%.3e\n",
+               record.operation.c_str(), record.shape.c_str(), record.degree,
+               record.iterations, record.seconds_per_op * 1e9,
+               record.allocs_per_op, record.bytes_per_op, record.error);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    int max_degree = 1000000;
+    double budget = 1;
+    double min_time = 0.1;
+    bool json = false;
+    string only;
+    for ( int i = 1; i < argc; i++ ) {
+        if ( strcmp(argv[i], "--max-degree") == 0 && i+1 < argc ) {
+            max_degree = atoi(argv[++i]);
+        }
+        else if ( strcmp(argv[i], "--budget") == 0 && i+1 < argc ) {
+            budget = atof(argv[++i]);
+        }
+        else if ( strcmp(argv[i], "--min-time") == 0 && i+1 < argc ) {
+            min_time = atof(argv[++i]);
+        }
+        else if ( strcmp(argv[i], "--json") == 0 ) {
+            json = true;
+        }
+        else if ( strcmp(argv[i], "--only") == 0 && i+1 < argc ) {
+            only = string(",") + argv[++i] + ",";
+        }
+        else {
+            cerr << "usage: polybench [--max-degree n] [--budget s] "
+                    "[--min-time s] [--json] [--only op,op,...]" << endl;
+            return 2;
+        }
+    }
+
+    const char* operations[] = { "add", "subtract", "multiply", "divide",
+                                 "remainder", "equal", "set_degree",
+                                 "evaluate", "evaluate_block" };
+    const int OPERATIONS = sizeof(operations) / sizeof(operations[0]);
+
+    vector<int> degrees;
+    for ( long d = 1; d <= max_degree; d *= 10 ) {
+        degrees.push_back(static_cast<int>(d));
+        if ( d * 3 <= max_degree ) {
+            degrees.push_back(static_cast<int>(d * 3));
+        }
+    }
+
+    if ( !json ) {
+        printf("operation,shape,degree,iterations,ns_per_op,allocs_per_op,"
+               "bytes_per_op,error\n");
+    }
+    for ( int op = 0; op < OPERATIONS; op++ ) {
+        string name = operations[op];
+        if ( !only.empty() && only.find("," + name + ",") == string::npos ) {
+            continue;
+        }
+        for ( int shape = 0; shape < 2; shape++ ) {
+            bool sparse = shape == 1;
+            for ( size_t k = 0; k < degrees.size(); k++ ) {
+                int n = degrees[k];
+                Record record;
+                record.operation = name;
+                record.shape = sparse ? "sparse" : "dense";
+                record.degree = n;
+                record.error = 0;
+
+                // the dividend has twice the degree of the divisor so that
+                // the quotient and remainder are both of degree ~n
+                Polynomial a = randomPolynomial(name == "divide" ||
+                                   name == "remainder" ? 2*n : n, sparse);
+                Polynomial b = randomPolynomial(n, sparse);
+                Polynomial result;
+                vector<double> points(4096), values(4096);
+                uniform_real_distribution<double> point(-1, 1);
+                for ( size_t j = 0; j < points.size(); j++ ) {
+                    points[j] = point(generator);
+                }
+                volatile double sink = 0;
+
+                if ( name == "add" ) {
+                    measure(record, min_time, [&]() { result = a + b; });
+                    record.error = sumError(a, b, result, 1);
+                }
+                else if ( name == "subtract" ) {
+                    measure(record, min_time, [&]() { result = a - b; });
+                    record.error = sumError(a, b, result, -1);
+                }
+                else if ( name == "multiply" ) {
+                    measure(record, min_time, [&]() { result = a * b; });
+                    record.error = productError(a, b, result);
+                }
+                else if ( name == "divide" || name == "remainder" ) {
+                    if ( name == "divide" ) {
+                        measure(record, min_time, [&]() { result = a / b; });
+                    }
+                    else {
+                        measure(record, min_time, [&]() { result = a % b; });
+                    }
+                    Polynomial quotient = a / b, remainder = a % b;
+                    record.error = divisionError(a, b, quotient, remainder);
+                }
+                else if ( name == "equal" ) {
+                    Polynomial copy(a);
+                    measure(record, min_time, [&]() { sink = a == copy; });
+                }
+                else if ( name == "set_degree" ) {
+                    // grows a polynomial one degree at a time, the pattern
+                    // of repeated appends, and reports the cost per call
+                    measure(record, min_time, [&]() {
+                        Polynomial grown;
+                        for ( int d = 0; d <= n; d++ ) {
+                            grown.setDegree(d);
+                        }
+                    });
+                    record.iterations *= n + 1;
+                    record.seconds_per_op /= n + 1;
+                    record.allocs_per_op /= n + 1;
+                    record.bytes_per_op /= n + 1;
+                }
+                else if ( name == "evaluate" ) {
+                    size_t j = 0;
+                    measure(record, min_time, [&]() {
+                        sink = a.evaluate(points[j++ % points.size()]);
+                    });
+                    for ( j = 0; j < points.size(); j++ ) {
+                        values[j] = a.evaluate(points[j]);
+                    }
+                    record.error = evaluationError(a, points, values);
+                }
+                else {
+                    // cost per point of evaluating a block of 4096 points
+                    measure(record, min_time, [&]() {
+                        a.evaluate(points.data(), values.data(),
+                                   static_cast<int>(points.size()));
+                    });
+                    record.iterations *= points.size();
+                    record.seconds_per_op /= points.size();
+                    record.allocs_per_op /= points.size();
+                    record.bytes_per_op /= points.size();
+                    record.error = evaluationError(a, points, values);
+                }
+                (void)sink;
+                print(record, json);
+                // stop before a call predicted to exceed the budget,
+                // assuming the worst (quadratic) growth with degree
+                if ( k+1 < degrees.size() ) {
+                    double growth = static_cast<double>(degrees[k+1]) / n;
+                    if ( record.seconds_per_call * growth * growth > budget ) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
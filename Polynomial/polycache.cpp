@@ -0,0 +1,132 @@
+#include <iostream>
+#include "polycache.h"
+
+
+/****************
+ * constructor(s)
+ ****************/
+
+// create an empty cache holding at most cap entries (at least one)
+PolynomialCache::PolynomialCache(const int cap) {
+    capacity = cap > 0 ? cap : 1;
+    stats.hits = stats.misses = stats.evictions = 0;
+    stats.size = 0;
+    stats.capacity = capacity;
+}
+
+
+/*******************
+ * lookup and insert
+ *******************/
+
+// copies a cached product of left and right into product on a hit
+bool PolynomialCache::findProduct(const Polynomial &left,
+                                  const Polynomial &right,
+                                  Polynomial &product) {
+    Entry* entry = find(PRODUCT, left, right);
+    if ( entry ) {
+        product = entry->result;
+    }
+    return entry != NULL;
+}
+
+// copies a cached quotient and remainder of left by right into pair on a hit
+bool PolynomialCache::findDivision(const Polynomial &left,
+                                   const Polynomial &right,
+                                   EuclidPair &pair) {
+    Entry* entry = find(DIVISION, left, right);
+    if ( entry ) {
+        pair.quotient = entry->result;
+        pair.remainder = entry->remainder;
+    }
+    return entry != NULL;
+}
+
+void PolynomialCache::storeProduct(const Polynomial &left,
+                                   const Polynomial &right,
+                                   const Polynomial &product) {
+    store(PRODUCT, left, right).result = product;
+}
+
+void PolynomialCache::storeDivision(const Polynomial &left,
+                                    const Polynomial &right,
+                                    const EuclidPair &pair) {
+    Entry &entry = store(DIVISION, left, right);
+    entry.result = pair.quotient;
+    entry.remainder = pair.remainder;
+}
+
+// drops every entry and resets the counters
+void PolynomialCache::clear() {
+    entries.clear();
+    index.clear();
+    stats.hits = stats.misses = stats.evictions = 0;
+    stats.size = 0;
+}
+
+CacheStatistics PolynomialCache::statistics() {
+    return stats;
+}
+
+
+/*******************
+ * private functions
+ *******************/
+
+// combines the operation and both operand hashes. the operands are not
+// symmetric for division, and product entries are not folded together either
+// so that a hit never depends on the commutativity of rounding
+unsigned long long PolynomialCache::makeKey(Operation operation,
+                                            const Polynomial &left,
+                                            const Polynomial &right) {
+    unsigned long long key = left.hash();
+    key ^= right.hash() + 0x9E3779B97F4A7C15ULL + (key << 6) + (key >> 2);
+    return key * 2 + operation;
+}
+
+// returns the entry for this operation on these operands, or NULL.
+// the stored operands are compared in full to rule out hash collisions
+PolynomialCache::Entry* PolynomialCache::find(Operation operation,
+                                               const Polynomial &left,
+                                               const Polynomial &right) {
+    std::unordered_map<unsigned long long, Position>::iterator found =
+        index.find(makeKey(operation, left, right));
+    if ( found != index.end() ) {
+        Position position = found->second;
+        if ( position->left == left && position->right == right ) {
+            entries.splice(entries.begin(), entries, position);
+            stats.hits++;
+            return &*position;
+        }
+    }
+    stats.misses++;
+    return NULL;
+}
+
+// returns a fresh entry at the front of the recency list for the caller to
+// fill in, replacing a colliding entry or evicting the oldest one
+PolynomialCache::Entry& PolynomialCache::store(Operation operation,
+                                               const Polynomial &left,
+                                               const Polynomial &right) {
+    unsigned long long key = makeKey(operation, left, right);
+    std::unordered_map<unsigned long long, Position>::iterator found =
+        index.find(key);
+    if ( found != index.end() ) {
+        entries.erase(found->second);
+        index.erase(found);
+    }
+    else if ( static_cast<int>(entries.size()) >= capacity ) {
+        index.erase(entries.back().key);
+        entries.pop_back();
+        stats.evictions++;
+    }
+    entries.push_front(Entry());
+    Entry &entry = entries.front();
+    entry.operation = operation;
+    entry.key = key;
+    entry.left = left;
+    entry.right = right;
+    index[key] = entries.begin();
+    stats.size = static_cast<int>(entries.size());
+    return entry;
+}
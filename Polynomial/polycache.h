@@ -0,0 +1,72 @@
+#ifndef _POLYCACHE_H
+#define _POLYCACHE_H
+
+#include <list>
+#include <unordered_map>
+#include "polynomial.h"
+
+/* PolynomialCache
+ ******************************************************************************
+ *
+ * a bounded least-recently-used cache of polynomial products and Euclidean
+ * divisions. entries are keyed by the operation and the content hashes of both
+ * operands, and the operands themselves are kept so that a hash collision is
+ * reported as a miss rather than returning the wrong result
+ *
+ * Operations:
+ *
+ * -    lookup:
+ *          cache.findProduct(a, b, product); cache.findDivision(a, b, pair);
+ *
+ *          copies a cached result into the last argument and returns true, or
+ *          returns false and leaves the argument alone. a hit moves the entry
+ *          to the front of the recency list
+ *
+ * -    insertion:
+ *          cache.storeProduct(a, b, product); cache.storeDivision(a, b, pair);
+ *
+ *          records a result, evicting the least recently used entry when the
+ *          cache is at capacity
+ *
+ * -    statistics:
+ *          cache.statistics(); cache.clear();
+ *
+ *          hit, miss and eviction counts since construction or the last clear
+ *
+ */
+
+class PolynomialCache {
+private:
+    enum Operation { PRODUCT, DIVISION };
+    struct Entry {
+        Operation operation;
+        unsigned long long key;
+        Polynomial left;
+        Polynomial right;
+        Polynomial result;
+        Polynomial remainder;
+    };
+    typedef std::list<Entry>::iterator Position;
+
+    int capacity;
+    std::list<Entry> entries;
+    std::unordered_map<unsigned long long, Position> index;
+    CacheStatistics stats;
+
+    unsigned long long makeKey(Operation, const Polynomial &,
+                               const Polynomial &);
+    Entry* find(Operation, const Polynomial &, const Polynomial &);
+    Entry& store(Operation, const Polynomial &, const Polynomial &);
+public:
+    PolynomialCache(const int);
+    bool findProduct(const Polynomial &, const Polynomial &, Polynomial &);
+    bool findDivision(const Polynomial &, const Polynomial &, EuclidPair &);
+    void storeProduct(const Polynomial &, const Polynomial &,
+                      const Polynomial &);
+    void storeDivision(const Polynomial &, const Polynomial &,
+                       const EuclidPair &);
+    void clear();
+    CacheStatistics statistics();
+};
+
+#endif
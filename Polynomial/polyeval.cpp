@@ -0,0 +1,282 @@
+/* polyeval
+ ******************************************************************************
+ *
+ * evaluates one polynomial at a stream of points.
+ *
+ *      polyeval [-r] [-i index] [-j threads] polynomial [input [output]]
+ *
+ * the polynomial file is either text in the format of operator<< (the first
+ * line is used) or a binary collection written by PolynomialWriter, in which
+ * case -i selects the polynomial (default 0). points are read from input, or
+ * stdin when it is missing or "-", and p(x) is written to output, or stdout.
+ *
+ * points are whitespace separated decimal numbers and results are written one
+ * per line with full precision. with -r both are raw native doubles instead,
+ * which avoids the cost of formatting entirely. raw input whose length is not
+ * a multiple of a double is malformed, like text that is not a number.
+ *
+ * input is consumed in large blocks. while one block is evaluated by -j
+ * threads (default: all hardware threads) the next block is being read, so
+ * on fast storage the tool is limited by I/O rather than by arithmetic.
+ *
+ * build:
+ *      g++ -O3 -march=native -std=c++11 -pthread -I../FibonacciHeap \
+ *          polyeval.cpp polynomial.cpp polycache.cpp polyio.cpp -o polyeval
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "polyio.h"
+
+using namespace std;
+
+// points per block in raw mode, bytes per block in text mode
+const int RAW_BLOCK = 1 << 22;
+const int TEXT_BLOCK = 1 << 25;
+
+class PointReader {
+private:
+    FILE* in;
+    bool raw;
+    bool done;
+    vector<char> text;
+    size_t carried;
+public:
+    class BadInput {
+    };
+    class ReadError {
+    };
+
+    PointReader(FILE* file, bool binary) :
+        in(file), raw(binary), done(false), carried(0) {
+        if ( !raw ) {
+            text.resize(TEXT_BLOCK + 1);
+        }
+    }
+
+    // replaces points with the next block of input, empty at the end.
+    // throws BadInput and ReadError exceptions
+    void read(vector<double> &points) {
+        points.clear();
+        if ( raw ) {
+            // read as bytes so that a trailing partial record is noticed
+            points.resize(RAW_BLOCK);
+            size_t got = fread(points.data(), 1, RAW_BLOCK * sizeof(double),
+                               in);
+            if ( ferror(in) ) {
+                throw ReadError();
+            }
+            if ( got % sizeof(double) != 0 ) {
+                throw BadInput();
+            }
+            points.resize(got / sizeof(double));
+            return;
+        }
+        while ( points.empty() && !done ) {
+            size_t got = fread(&text[carried], 1, TEXT_BLOCK - carried, in);
+            if ( ferror(in) ) {
+                throw ReadError();
+            }
+            size_t filled = carried + got;
+            done = got == 0;
+            text[filled] = '\0';
+            // only parse up to the last separator so no number is split
+            // between blocks
+            size_t end = filled;
+            if ( !done ) {
+                while ( end > 0 && !isspace(static_cast<unsigned char>(text[end-1])) ) {
+                    end--;
+                }
+                if ( end == 0 && filled == static_cast<size_t>(TEXT_BLOCK) ) {
+                    throw BadInput();
+                }
+            }
+            char* next = &text[0];
+            char* stop = next + end;
+            while ( true ) {
+                while ( next < stop && isspace(static_cast<unsigned char>(*next)) ) {
+                    next++;
+                }
+                if ( next >= stop ) {
+                    break;
+                }
+                char* start = next;
+                points.push_back(strtod(start, &next));
+                if ( next == start ) {
+                    throw BadInput();
+                }
+            }
+            carried = filled - end;
+            memmove(&text[0], &text[end], carried);
+        }
+    }
+};
+
+// reads the polynomial from a binary collection or the first text line
+bool loadPolynomial(const char* path, int index, Polynomial &poly) {
+    char magic[sizeof(PolynomialFile::MAGIC)] = { 0 };
+    ifstream file(path, ios::binary);
+    if ( !file ) {
+        return false;
+    }
+    file.read(magic, sizeof(magic));
+    if ( file && memcmp(magic, PolynomialFile::MAGIC, sizeof(magic)) == 0 ) {
+        file.close();
+        PolynomialFile collection(path);
+        poly = collection.load(index);
+        return true;
+    }
+    file.clear();
+    file.seekg(0);
+    return static_cast<bool>(file >> poly);
+}
+
+// evaluates points[first, last) and, unless raw, formats the results
+void evaluateSlice(Polynomial* poly, const vector<double>* points,
+                   vector<double>* results, int first, int last, bool raw,
+                   string* formatted) {
+    poly->evaluate(points->data() + first, results->data() + first,
+                   last - first);
+    if ( !raw ) {
+        char number[32];
+        formatted->clear();
+        for ( int i = first; i < last; i++ ) {
+            int length = snprintf(number, sizeof(number), "%.17g\n",
+                                  (*results)[i]);
+            formatted->append(number, length);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    bool raw = false;
+    int index = 0;
+    int threads = static_cast<int>(thread::hardware_concurrency());
+    int arg = 1;
+    for ( ; arg < argc && argv[arg][0] == '-' && argv[arg][1] != '\0'; arg++ ) {
+        if ( strcmp(argv[arg], "-r") == 0 ) {
+            raw = true;
+        }
+        else if ( strcmp(argv[arg], "-i") == 0 && arg+1 < argc ) {
+            index = atoi(argv[++arg]);
+        }
+        else if ( strcmp(argv[arg], "-j") == 0 && arg+1 < argc ) {
+            threads = atoi(argv[++arg]);
+        }
+        else {
+            break;
+        }
+    }
+    if ( arg >= argc || argc - arg > 3 ) {
+        cerr << "usage: polyeval [-r] [-i index] [-j threads] polynomial "
+                "[input [output]]" << endl;
+        return 2;
+    }
+    if ( threads < 1 ) {
+        threads = 1;
+    }
+
+    Polynomial poly;
+    try {
+        if ( !loadPolynomial(argv[arg], index, poly) ) {
+            cerr << "polyeval: cannot read polynomial from " << argv[arg]
+                 << endl;
+            return 1;
+        }
+    }
+    catch ( ... ) {
+        cerr << "polyeval: cannot read polynomial " << index << " from "
+             << argv[arg] << endl;
+        return 1;
+    }
+
+    FILE* in = stdin;
+    FILE* out = stdout;
+    if ( arg+1 < argc && strcmp(argv[arg+1], "-") != 0 ) {
+        in = fopen(argv[arg+1], "rb");
+    }
+    if ( arg+2 < argc && strcmp(argv[arg+2], "-") != 0 ) {
+        out = fopen(argv[arg+2], "wb");
+    }
+    if ( !in || !out ) {
+        cerr << "polyeval: cannot open input or output" << endl;
+        return 1;
+    }
+    setvbuf(in, NULL, _IOFBF, 1 << 20);
+    setvbuf(out, NULL, _IOFBF, 1 << 20);
+
+    PointReader reader(in, raw);
+    vector<double> current, next, results;
+    vector<string> formatted(threads);
+    bool failed = false;
+    bool unreadable = false;
+    // cleared by the first short write, which ends the run
+    bool written = true;
+    try {
+        reader.read(current);
+        while ( !current.empty() && written ) {
+            // read the next block while this one is evaluated and written
+            thread prefetch([&]() {
+                try {
+                    reader.read(next);
+                }
+                catch ( PointReader::BadInput ) {
+                    next.clear();
+                    failed = true;
+                }
+                catch ( PointReader::ReadError ) {
+                    next.clear();
+                    unreadable = true;
+                }
+            });
+
+            int count = static_cast<int>(current.size());
+            int slice = (count + threads - 1) / threads;
+            results.resize(count);
+            vector<thread> workers;
+            for ( int t = 0; t < threads && t*slice < count; t++ ) {
+                workers.push_back(thread(evaluateSlice, &poly, &current,
+                    &results, t*slice, min(count, (t+1)*slice), raw,
+                    &formatted[t]));
+            }
+            for ( size_t t = 0; t < workers.size(); t++ ) {
+                workers[t].join();
+                if ( raw ) {
+                    continue;
+                }
+                written = fwrite(formatted[t].data(), 1, formatted[t].size(),
+                                 out) == formatted[t].size() && written;
+            }
+            if ( raw ) {
+                written = fwrite(results.data(), sizeof(double), count, out) ==
+                          static_cast<size_t>(count);
+            }
+
+            prefetch.join();
+            current.swap(next);
+        }
+    }
+    catch ( PointReader::BadInput ) {
+        failed = true;
+    }
+    catch ( PointReader::ReadError ) {
+        unreadable = true;
+    }
+    if ( !written || unreadable || fflush(out) != 0 || ferror(out) ||
+         ferror(in) ) {
+        cerr << "polyeval: I/O error" << endl;
+        return 1;
+    }
+    if ( failed ) {
+        cerr << "polyeval: malformed input" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,388 @@
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <climits>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "polyio.h"
+
+
+const char PolynomialFile::MAGIC[8] = { 'P', 'O', 'L', 'Y', 'B', 'I', 'N', 0 };
+
+// size of the blocks readPolynomials() pulls from a stream
+const size_t TEXT_BLOCK = 1 << 20;
+
+
+/****************
+ * PolynomialView
+ ****************/
+
+// create a view of the zero polynomial
+PolynomialView::PolynomialView() : degree(-1), coefficients(NULL) {}
+
+// create a view of deg+1 coefficients stored elsewhere, degree 0 first
+PolynomialView::PolynomialView(const int deg, const double* data) :
+    degree(deg), coefficients(data) {}
+
+// reads the coefficient of degree index.
+// throws OutOfRange exception
+double PolynomialView::operator[](int index) const {
+    if ( index >= 0 && index <= degree ) {
+        return coefficients[index];
+    }
+    else {
+        throw Polynomial::OutOfRange();
+    }
+}
+
+// evaluate the viewed polynomial at a point via Horner's method
+double PolynomialView::evaluate(const double point) const {
+    if ( degree < 0 ) {
+        return 0;
+    }
+    double result = coefficients[degree];
+    for ( int i = degree - 1; i >= 0; i-- ) {
+        result *= point;
+        result += coefficients[i];
+    }
+    return result;
+}
+
+// evaluate the viewed polynomial at count points, see evaluateMany()
+void PolynomialView::evaluate(const double* points, double* results,
+                              int count) const {
+    evaluateMany(coefficients, degree, points, results, count);
+}
+
+// copies the viewed coefficients into a polynomial that owns them
+Polynomial PolynomialView::toPolynomial() const {
+    return Polynomial(degree, coefficients, degree+1);
+}
+
+
+/****************
+ * PolynomialFile
+ ****************/
+
+// maps a binary collection into memory and validates its header and index.
+// throws FileError, BadFormat exceptions
+PolynomialFile::PolynomialFile(const char* path) :
+    fd(-1), mapping(NULL), length(0), count(0), index(NULL) {
+    struct stat info;
+    uint32_t version, order;
+    uint64_t index_offset;
+
+    fd = open(path, O_RDONLY);
+    if ( fd < 0 ) {
+        throw FileError();
+    }
+    if ( fstat(fd, &info) != 0 ) {
+        ::close(fd);
+        throw FileError();
+    }
+    length = static_cast<size_t>(info.st_size);
+    if ( length < static_cast<size_t>(HEADER_SIZE) ) {
+        ::close(fd);
+        throw BadFormat();
+    }
+    void* address = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    if ( address == MAP_FAILED ) {
+        ::close(fd);
+        throw FileError();
+    }
+    mapping = static_cast<const char*>(address);
+
+    std::memcpy(&version, mapping + 8, sizeof(version));
+    std::memcpy(&order, mapping + 12, sizeof(order));
+    std::memcpy(&count, mapping + 16, sizeof(count));
+    std::memcpy(&index_offset, mapping + 24, sizeof(index_offset));
+    if ( std::memcmp(mapping, MAGIC, sizeof(MAGIC)) != 0 ||
+         version != VERSION || order != ENDIAN_MARK ||
+         index_offset < static_cast<uint64_t>(HEADER_SIZE) ||
+         index_offset % sizeof(double) != 0 || index_offset > length ||
+         count > (length - index_offset) / sizeof(IndexEntry) ) {
+        munmap(const_cast<char*>(mapping), length);
+        ::close(fd);
+        throw BadFormat();
+    }
+    index = reinterpret_cast<const IndexEntry*>(mapping + index_offset);
+}
+
+PolynomialFile::~PolynomialFile() {
+    munmap(const_cast<char*>(mapping), length);
+    ::close(fd);
+}
+
+// returns min{# polynomials in the file, INT_MAX}
+int PolynomialFile::size() const {
+    return count < static_cast<uint64_t>(INT_MAX) ?
+           static_cast<int>(count) : INT_MAX;
+}
+
+// views the i-th polynomial in place.
+// throws OutOfRange, BadFormat exceptions
+PolynomialView PolynomialFile::operator[](int i) const {
+    if ( i < 0 || static_cast<uint64_t>(i) >= count ) {
+        throw Polynomial::OutOfRange();
+    }
+    const IndexEntry &entry = index[i];
+    uint64_t end = reinterpret_cast<const char*>(index) - mapping;
+    if ( entry.degree < -1 || entry.degree >= INT_MAX ||
+         entry.offset < static_cast<uint64_t>(HEADER_SIZE) ||
+         entry.offset % sizeof(double) != 0 || entry.offset > end ||
+         static_cast<uint64_t>(entry.degree+1) >
+             (end - entry.offset) / sizeof(double) ) {
+        throw BadFormat();
+    }
+    return PolynomialView(static_cast<int>(entry.degree),
+        reinterpret_cast<const double*>(mapping + entry.offset));
+}
+
+// copies the i-th polynomial out of the file
+Polynomial PolynomialFile::load(int i) const {
+    return (*this)[i].toPolynomial();
+}
+
+
+/******************
+ * PolynomialWriter
+ ******************/
+
+// opens path for writing. when append is set and path already holds a
+// collection, new polynomials are added after the existing ones.
+// throws PolynomialFile::FileError, PolynomialFile::BadFormat exceptions
+PolynomialWriter::PolynomialWriter(const char* path, bool append) :
+    file(NULL), offset(PolynomialFile::HEADER_SIZE) {
+    if ( append ) {
+        file = std::fopen(path, "r+b");
+    }
+    if ( file ) {
+        std::setvbuf(file, NULL, _IOFBF, TEXT_BLOCK);
+        char header[PolynomialFile::HEADER_SIZE];
+        uint32_t version, order;
+        uint64_t existing;
+        if ( std::fread(header, 1, sizeof(header), file) != sizeof(header) ) {
+            std::fclose(file);
+            throw PolynomialFile::BadFormat();
+        }
+        std::memcpy(&version, header + 8, sizeof(version));
+        std::memcpy(&order, header + 12, sizeof(order));
+        std::memcpy(&existing, header + 16, sizeof(existing));
+        std::memcpy(&offset, header + 24, sizeof(offset));
+        if ( std::memcmp(header, PolynomialFile::MAGIC,
+                         sizeof(PolynomialFile::MAGIC)) != 0 ||
+             version != PolynomialFile::VERSION ||
+             order != PolynomialFile::ENDIAN_MARK ) {
+            std::fclose(file);
+            throw PolynomialFile::BadFormat();
+        }
+        // the old index is read into memory and left in place: new
+        // coefficients go after it, and close() writes the extended index
+        // after them and the header last, so until then the file still
+        // holds the old collection. the old index stays behind as 16 unused
+        // bytes per polynomial, which keeps the coefficients aligned
+        struct stat status;
+        if ( fstat(fileno(file), &status) != 0 || offset % sizeof(double) != 0 ||
+             offset < static_cast<uint64_t>(PolynomialFile::HEADER_SIZE) ||
+             offset > static_cast<uint64_t>(status.st_size) ||
+             existing > (status.st_size - offset) /
+                        sizeof(PolynomialFile::IndexEntry) ) {
+            std::fclose(file);
+            throw PolynomialFile::BadFormat();
+        }
+        index.resize(existing);
+        if ( fseeko(file, static_cast<off_t>(offset), SEEK_SET) != 0 ||
+             std::fread(index.data(), sizeof(PolynomialFile::IndexEntry),
+                        existing, file) != existing ) {
+            std::fclose(file);
+            throw PolynomialFile::BadFormat();
+        }
+        offset += sizeof(PolynomialFile::IndexEntry) * existing;
+        if ( fseeko(file, static_cast<off_t>(offset), SEEK_SET) != 0 ) {
+            std::fclose(file);
+            throw PolynomialFile::FileError();
+        }
+    }
+    else {
+        file = std::fopen(path, "w+b");
+        if ( !file ) {
+            throw PolynomialFile::FileError();
+        }
+        std::setvbuf(file, NULL, _IOFBF, TEXT_BLOCK);
+        // placeholder header, completed by close()
+        char header[PolynomialFile::HEADER_SIZE] = { 0 };
+        offset = 0;
+        writeBytes(header, sizeof(header));
+    }
+}
+
+// closes the file if close() has not been called. errors are swallowed here,
+// call close() directly to observe them
+PolynomialWriter::~PolynomialWriter() {
+    try {
+        close();
+    }
+    catch ( PolynomialFile::FileError ) {
+    }
+}
+
+// appends the coefficients of a polynomial.
+// throws PolynomialFile::FileError exception
+void PolynomialWriter::write(const Polynomial &poly) {
+    write(PolynomialView(poly.degree, poly.coefficients));
+}
+
+void PolynomialWriter::write(const PolynomialView &poly) {
+    if ( !file ) {
+        throw PolynomialFile::FileError();
+    }
+    PolynomialFile::IndexEntry entry;
+    entry.offset = offset;
+    entry.degree = poly.getDegree();
+    writeBytes(poly.data(), sizeof(double) * (poly.getDegree()+1));
+    index.push_back(entry);
+}
+
+// writes the index after the last coefficients and flushes it to disk, then
+// writes the header, which is what makes the new polynomials part of the file.
+// throws PolynomialFile::FileError exception
+void PolynomialWriter::close() {
+    if ( !file ) {
+        return;
+    }
+    uint64_t index_offset = offset;
+    uint64_t entries = index.size();
+    writeBytes(index.data(), sizeof(PolynomialFile::IndexEntry) * index.size());
+
+    uint32_t version = PolynomialFile::VERSION;
+    uint32_t order = PolynomialFile::ENDIAN_MARK;
+    char header[PolynomialFile::HEADER_SIZE];
+    std::memcpy(header, PolynomialFile::MAGIC, sizeof(PolynomialFile::MAGIC));
+    std::memcpy(header + 8, &version, sizeof(version));
+    std::memcpy(header + 12, &order, sizeof(order));
+    std::memcpy(header + 16, &entries, sizeof(entries));
+    std::memcpy(header + 24, &index_offset, sizeof(index_offset));
+    bool ok = std::fflush(file) == 0 && fsync(fileno(file)) == 0 &&
+              fseeko(file, 0, SEEK_SET) == 0 &&
+              std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    ok = std::fclose(file) == 0 && ok;
+    file = NULL;
+    if ( !ok ) {
+        throw PolynomialFile::FileError();
+    }
+}
+
+// returns min{# polynomials written, INT_MAX}, including appended-to ones
+int PolynomialWriter::count() const {
+    return index.size() < static_cast<size_t>(INT_MAX) ?
+           static_cast<int>(index.size()) : INT_MAX;
+}
+
+void PolynomialWriter::writeBytes(const void* bytes, size_t size) {
+    if ( size > 0 && std::fwrite(bytes, 1, size, file) != size ) {
+        throw PolynomialFile::FileError();
+    }
+    offset += size;
+}
+
+
+/**************
+ * text parsing
+ **************/
+
+// parses one line written by operator<< starting at begin into poly and
+// returns the start of the next line, or NULL if the line is malformed.
+// the text must be followed by a newline or a zero byte no later than end
+const char* parsePolynomial(const char* begin, const char* end,
+                            Polynomial &poly) {
+    const char* newline = static_cast<const char*>(
+        std::memchr(begin, '\n', end - begin));
+    const char* stop = newline ? newline : end;
+    char* next;
+    long deg = std::strtol(begin, &next, 10);
+    if ( next == begin || next > stop || deg < -1 || deg >= INT_MAX ) {
+        return NULL;
+    }
+    poly.setDegree(static_cast<int>(deg));
+    poly.hashed = false;
+    for ( int i = 0; i <= poly.degree; i++ ) {
+        const char* start = next;
+        poly.coefficients[i] = std::strtod(start, &next);
+        // strtod skips newlines, so a short line runs past stop
+        if ( next == start || next > stop ) {
+            return NULL;
+        }
+    }
+    while ( next < stop && std::isspace(static_cast<unsigned char>(*next)) ) {
+        next++;
+    }
+    if ( next != stop ) {
+        return NULL;
+    }
+    return newline ? newline + 1 : end;
+}
+
+// reads a line written by operator<<. sets failbit if it is malformed
+std::istream& operator>>(std::istream &in, Polynomial &poly) {
+    std::string line;
+    if ( std::getline(in, line) &&
+         !parsePolynomial(line.c_str(), line.c_str() + line.size(), poly) ) {
+        in.setstate(std::ios::failbit);
+    }
+    return in;
+}
+
+// appends every polynomial in the stream to list, reading in large blocks
+// rather than line by line. blank lines are skipped. stops and sets failbit at
+// the first malformed line
+void readPolynomials(std::istream &in, std::vector<Polynomial> &list) {
+    std::vector<char> buffer(TEXT_BLOCK + 1);
+    size_t filled = 0;
+    bool done = false;
+    while ( !done ) {
+        in.read(&buffer[filled], buffer.size() - 1 - filled);
+        filled += static_cast<size_t>(in.gcount());
+        done = !in;
+        buffer[filled] = '\0';
+
+        const char* line = &buffer[0];
+        const char* end = line + filled;
+        while ( line < end ) {
+            const char* newline = static_cast<const char*>(
+                std::memchr(line, '\n', end - line));
+            if ( !newline && !done ) {
+                break;
+            }
+            const char* blank = line;
+            while ( blank < end && blank != newline &&
+                    std::isspace(static_cast<unsigned char>(*blank)) ) {
+                blank++;
+            }
+            if ( blank == end || blank == newline ) {
+                line = newline ? newline + 1 : end;
+                continue;
+            }
+            list.push_back(Polynomial());
+            line = parsePolynomial(line, end, list.back());
+            if ( !line ) {
+                list.pop_back();
+                in.clear();
+                in.setstate(std::ios::failbit);
+                return;
+            }
+        }
+
+        // keep the incomplete last line, growing the buffer if one line does
+        // not fit in it
+        size_t rest = end - line;
+        std::memmove(&buffer[0], line, rest);
+        filled = rest;
+        if ( filled == buffer.size() - 1 ) {
+            buffer.resize(buffer.size() * 2);
+        }
+    }
+    in.clear(in.rdstate() & ~std::ios::failbit);
+}
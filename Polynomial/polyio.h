@@ -0,0 +1,131 @@
+#ifndef _POLYIO_H
+#define _POLYIO_H
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include "polynomial.h"
+
+/* Polynomial input/output
+ ******************************************************************************
+ *
+ * a versioned binary format for large collections of polynomials, a reader
+ * that maps such a file into memory and a fast parser for the text written by
+ * operator<<.
+ *
+ * Binary layout (native byte order, all offsets in bytes):
+ *
+ *      0   char[8]     magic "POLYBIN" followed by a zero byte
+ *      8   uint32      format version, currently 1
+ *     12   uint32      0x01020304 as written, to detect foreign byte order
+ *     16   uint64      number of polynomials
+ *     24   uint64      offset of the index
+ *     32   double[]    coefficients of every polynomial, degree 0 first
+ *      .   index       one { uint64 offset, int64 degree } per polynomial
+ *
+ * the index is written last so that a collection can be appended to without
+ * knowing its final size. coefficients are always 8-byte aligned, which lets
+ * a mapped file be read through PolynomialView without copying
+ *
+ * Operations:
+ *
+ * -    writing:
+ *          PolynomialWriter w("file", append); w.write(poly); w.close();
+ *
+ *          streams polynomials to a new file, or to the end of an existing
+ *          one. the header and index are written by close() (or the
+ *          destructor), so a new file is only valid after that point. an
+ *          appended-to file keeps its old contents until the header is
+ *          rewritten, the last step of close(), so an append cut short
+ *          leaves the collection as it was
+ *
+ * -    reading:
+ *          PolynomialFile f("file"); f.size(); f[i]; f.load(i);
+ *
+ *          maps the file read-only. operator[] returns a view of the i-th
+ *          polynomial that points into the mapping, load() copies it into a
+ *          Polynomial. views are invalid once the file object is destroyed
+ *
+ * -    text:
+ *          parsePolynomial(begin, end, poly); readPolynomials(in, list);
+ *
+ *          parses lines in the format of operator<<. the first parses a
+ *          single line in place, the second reads a whole stream in large
+ *          blocks
+ *
+ */
+
+class PolynomialView {
+private:
+    int degree;
+    const double* coefficients;
+public:
+    PolynomialView();
+    PolynomialView(const int, const double*);
+    int getDegree() const { return degree; }
+    const double* data() const { return coefficients; }
+    double operator[](int) const;
+    double evaluate(const double) const;
+    void evaluate(const double*, double*, int) const;
+    Polynomial toPolynomial() const;
+};
+
+class PolynomialFile {
+private:
+    struct IndexEntry {
+        uint64_t offset;
+        int64_t degree;
+    };
+
+    int fd;
+    const char* mapping;
+    size_t length;
+    uint64_t count;
+    const IndexEntry* index;
+
+    // not copyable, the mapping has a single owner
+    PolynomialFile(const PolynomialFile &);
+    PolynomialFile& operator=(const PolynomialFile &);
+public:
+    PolynomialFile(const char*);
+    ~PolynomialFile();
+    // exception classes
+    class FileError {
+    };
+    class BadFormat {
+    };
+    int size() const;
+    PolynomialView operator[](int) const;
+    Polynomial load(int) const;
+
+    static const char MAGIC[8];
+    static const uint32_t VERSION = 1;
+    static const uint32_t ENDIAN_MARK = 0x01020304;
+    static const int HEADER_SIZE = 32;
+
+    friend class PolynomialWriter;
+};
+
+class PolynomialWriter {
+private:
+    std::FILE* file;
+    uint64_t offset;
+    std::vector<PolynomialFile::IndexEntry> index;
+
+    PolynomialWriter(const PolynomialWriter &);
+    PolynomialWriter& operator=(const PolynomialWriter &);
+    void writeBytes(const void*, size_t);
+public:
+    PolynomialWriter(const char*, bool append = false);
+    ~PolynomialWriter();
+    void write(const Polynomial &);
+    void write(const PolynomialView &);
+    void close();
+    int count() const;
+};
+
+const char* parsePolynomial(const char*, const char*, Polynomial &);
+void readPolynomials(std::istream &, std::vector<Polynomial> &);
+
+#endif
@@ -1,11 +1,18 @@
 #include <new>
+#include <cstring>
 #include <cmath>
 #include <cstdlib>
 #include <algorithm>
 #include <limits>
 #include <iostream>
 #include "polynomial.h"
+#include "polycache.h"
 #include "FibHeap.h"
+#include "Instrumentation.h"
+
+
+// memoization of operator* and EuclideanDivision, disabled until enableCache()
+PolynomialCache* Polynomial::cache = NULL;
 
 
 /*********************
@@ -17,11 +24,13 @@ Polynomial::Polynomial() {
     degree = -1;
     memory_scale = 0;
     coefficients = NULL;
+    hashed = false;
 }
 
 // create a polynomial of degree deg an int.
 // throws NoMemory exception
 Polynomial::Polynomial(const int deg) {
+    hashed = false;
     if ( deg >= 0 ) {
         degree = deg;
         memory_scale = 1;
@@ -30,6 +39,9 @@ Polynomial::Polynomial(const int deg) {
         }
         try {
             coefficients = new double[memory_scale*BASE];
+            INSTRUMENT_COUNT(ALLOCATIONS, 1);
+            INSTRUMENT_COUNT(BYTES_ALLOCATED,
+                             sizeof(double)*memory_scale*BASE);
         }
         catch( std::bad_alloc ) {
             throw NoMemory();
@@ -51,7 +63,8 @@ Polynomial::Polynomial(const int deg) {
 
 // create a polynomial of degree deg with predetermined coefficients
 // throws NoMemory, OutOfRange exceptions
-Polynomial::Polynomial(const int deg, double *arr, int size) {
+Polynomial::Polynomial(const int deg, const double *arr, int size) {
+    hashed = false;
     if ( size > deg ) {
         if ( deg >= 0 ) {
             degree = deg;
@@ -61,6 +74,9 @@ Polynomial::Polynomial(const int deg, double *arr, int size) {
             }
             try {
                 coefficients = new double[memory_scale*BASE];
+                INSTRUMENT_COUNT(ALLOCATIONS, 1);
+                INSTRUMENT_COUNT(BYTES_ALLOCATED,
+                                 sizeof(double)*memory_scale*BASE);
             }
             catch( std::bad_alloc ) {
                 throw NoMemory();
@@ -86,9 +102,14 @@ Polynomial::Polynomial(const int deg, double *arr, int size) {
 Polynomial::Polynomial(const Polynomial &original) {
     degree = original.degree;
     memory_scale = original.memory_scale;
+    hashed = original.hashed;
+    content_hash = original.content_hash;
     if ( degree >= 0 ) {
         try {
             coefficients = new double[memory_scale*BASE];
+            INSTRUMENT_COUNT(ALLOCATIONS, 1);
+            INSTRUMENT_COUNT(BYTES_ALLOCATED,
+                             sizeof(double)*memory_scale*BASE);
         }
         catch( std::bad_alloc ) {
             throw NoMemory();
@@ -104,8 +125,9 @@ Polynomial::Polynomial(const Polynomial &original) {
 
 // deallocate memory for coefficients when points to NULL
 Polynomial::~Polynomial() {
-    if ( !coefficients ) {
+    if ( coefficients ) {
         delete [] coefficients;
+        INSTRUMENT_COUNT(DEALLOCATIONS, 1);
         coefficients = NULL;
     }
 }
@@ -118,11 +140,14 @@ Polynomial::~Polynomial() {
 // assigns a polynomial to another one.
 // this function modifies the caller only if it is not equal to the argument
 Polynomial& Polynomial::operator=(const Polynomial &right) {
+    INSTRUMENT_TIME(ASSIGN);
     if ( *this != right ) {
         this->setDegree(right.degree);
         for ( int i = 0; i <= this->degree; i++ ) {
             this->coefficients[i] = right.coefficients[i];
         }
+        hashed = right.hashed;
+        content_hash = right.content_hash;
     }
     return *this;
 }
@@ -131,6 +156,8 @@ Polynomial& Polynomial::operator=(const Polynomial &right) {
 // if the caller is the zero polynomial the sum is equal to the argument;
 // else if the argument is not the zero polynomial the sum must be computed
 Polynomial& Polynomial::operator+=(const Polynomial &right) {
+    INSTRUMENT_TIME(ADD);
+    hashed = false;
     if ( this->degree == -1 ) {
         *this = right;
     }
@@ -185,6 +212,8 @@ Polynomial& Polynomial::operator+=(const Polynomial &right) {
 
 // multiplies two polynomials and assigns value to the caller.
 Polynomial& Polynomial::operator*=(const Polynomial &right) {
+    INSTRUMENT_TIME(MULTIPLY);
+    hashed = false;
     // the zero polynomial dominates multiplication
     if ( this->degree == -1 || right.degree == -1 ) {
         this->setDegree(-1);
@@ -239,7 +268,7 @@ Polynomial& Polynomial::operator*=(const Polynomial &right) {
         else if ( pos.size() > 0 ) {
             sum = pos.extractMin();
         }
-        else if ( neg->n > 0 ) {
+        else if ( neg.size() > 0 ) {
             sum = -neg.extractMin();
         }
         else {
@@ -254,6 +283,7 @@ Polynomial& Polynomial::operator*=(const Polynomial &right) {
 // value to caller.
 // this can be improved by providing scalar multiplcation
 Polynomial& Polynomial::operator-=(const Polynomial &right) {
+    INSTRUMENT_TIME(SUBTRACT);
     Polynomial negative(0);
     negative[0] = -1;
     return *this += negative *= right;
@@ -262,6 +292,7 @@ Polynomial& Polynomial::operator-=(const Polynomial &right) {
 // divides two polynomials and assigns quotient to caller
 // // throws DivideByZero exception
 Polynomial& Polynomial::operator/=(const Polynomial &right) {
+    INSTRUMENT_TIME(DIVIDE);
     // the zero polynomial dominates division
     if ( this->degree == -1 ) {
         return *this;
@@ -275,6 +306,7 @@ Polynomial& Polynomial::operator/=(const Polynomial &right) {
 // divides two polynomials and assigns remainder to caller
 // throws DivideByZero exception
 Polynomial& Polynomial::operator%=(const Polynomial &right) {
+    INSTRUMENT_TIME(REMAINDER);
     if ( this->degree == -1 ) {
         return *this;
     }
@@ -290,10 +322,18 @@ Polynomial Polynomial::operator+(const Polynomial &right) {
     return result += right;
 }
 
-// multiplies two polynomials
+// multiplies two polynomials.
+// the product is looked up in and recorded to the cache when it is enabled
 Polynomial Polynomial::operator*(const Polynomial &right) {
     Polynomial result(*this);
-    return result *= right;
+    if ( cache && cache->findProduct(*this, right, result) ) {
+        return result;
+    }
+    result *= right;
+    if ( cache ) {
+        cache->storeProduct(*this, right, result);
+    }
+    return result;
 }
 
 // subtracts two polynomials
@@ -317,8 +357,10 @@ Polynomial Polynomial::operator%(const Polynomial &right) {
 // accesses and/or mutates coefficient of degree index.
 // throws OutOfRange exception when an attempt is made to access a section of
 // memory that is not part of the array or contains garbage
+// the cached hash is discarded since the caller may write through the reference
 double& Polynomial::operator[](int index) {
     if ( index >= 0 && index <= degree ) {
+        hashed = false;
         return coefficients[index];
     }
     else {
@@ -371,7 +413,10 @@ std::ostream& operator<<(std::ostream &out, Polynomial &poly) {
 // changes the degree and adjusts the coefficients accordingly
 // throws NoMemory exception
 void Polynomial::setDegree(int deg) {
+    INSTRUMENT_TIME(SET_DEGREE);
+    INSTRUMENT_COUNT(SET_DEGREE_CALLS, 1);
     if ( deg != degree ) {
+        hashed = false;
         double* temp = coefficients;
         int old_scale = memory_scale;
         if ( degree == -1 ) {
@@ -385,9 +430,13 @@ void Polynomial::setDegree(int deg) {
             memory_scale /= 2;
         }
         if ( memory_scale != old_scale ) {
+            INSTRUMENT_COUNT(SET_DEGREE_REALLOCATIONS, 1);
             if ( memory_scale > 0 ) {
                 try {
                     coefficients = new double[memory_scale*BASE];
+                    INSTRUMENT_COUNT(ALLOCATIONS, 1);
+                    INSTRUMENT_COUNT(BYTES_ALLOCATED,
+                                     sizeof(double)*memory_scale*BASE);
                 }
                 catch (std::bad_alloc) {
                     throw NoMemory();
@@ -410,17 +459,23 @@ void Polynomial::setDegree(int deg) {
             else {
                 coefficients = NULL;
             }
-            if ( !temp ) {
+            if ( temp ) {
                 delete [] temp;
+                INSTRUMENT_COUNT(DEALLOCATIONS, 1);
             }
         }
         degree = deg;
     }
 }
 
-// DEPRECATED: sets coefficient of the term with degree index to value
+// DEPRECATED: sets coefficient of the term with degree index to value.
+// a cached hash is updated in place rather than discarded
 void Polynomial::setCoefficient(int index, double value) {
     if ( index >= 0 && index <= degree ) {
+        if ( hashed ) {
+            content_hash += hashTerm(index, value) -
+                            hashTerm(index, coefficients[index]);
+        }
         coefficients[index] = value;
         if ( index == degree && value == 0 ) {
             do {
@@ -453,10 +508,29 @@ double Polynomial::getCoefficient(int index) {
  * miscellaneous and private functions
  *************************************/
 
+// hashes the degree and each valid coefficient. terms are hashed
+// independently and summed so that setCoefficient() can replace one term
+// without rehashing the rest. the result is cached until the next mutation
+unsigned long long Polynomial::hash() const {
+    if ( !hashed ) {
+        content_hash = mix(static_cast<unsigned long long>(degree));
+        for ( int i = 0; i <= degree; i++ ) {
+            content_hash += hashTerm(i, coefficients[i]);
+        }
+        hashed = true;
+    }
+    return content_hash;
+}
+
 // evaluate polynomial at a point via Horner's method,
 // i.e., ax^3 + bx^2 + cx + d = ((ax + b)x + c)x + d .
-// this method reduces error in evaluating a polynomial at a real point
+// this method reduces error in evaluating a polynomial at a real point.
+// the zero polynomial evaluates to 0
 double Polynomial::evaluate(const double point) {
+    INSTRUMENT_TIME(EVALUATE);
+    if ( this->degree == -1 ) {
+        return 0;
+    }
     double result = this->coefficients[this->degree];
     for ( int i = this->degree - 1; i >= 0; i-- ) {
         result *= point;
@@ -465,17 +539,28 @@ double Polynomial::evaluate(const double point) {
     return result;
 }
 
+// evaluate polynomial at count points, writing p(points[j]) to results[j]
+void Polynomial::evaluate(const double* points, double* results, int count) {
+    INSTRUMENT_TIME(EVALUATE);
+    evaluateMany(this->coefficients, this->degree, points, results, count);
+}
+
 // divides two polynomials to obtain a Euclid pair.
-// this function is private because no check is made for the zero polynomial
+// this function is private because no check is made for the zero polynomial.
+// the pair is looked up in and recorded to the cache when it is enabled; the
+// intermediate products use *= so they do not crowd the cache
 EuclidPair Polynomial::EuclideanDivision(const Polynomial &left,
                                          const Polynomial &right) {
+    INSTRUMENT_TIME(EUCLIDEAN_DIVISION);
+    EuclidPair result;
+    if ( cache && cache->findDivision(left, right, result) ) {
+        return result;
+    }
     // if the dividend has a lesser degree than the divisor then we know that
     // left = 0*right + left, with the remainder having a lesser degree than
     // the divisor
-    EuclidPair result;
     if ( left.degree < right.degree ) {
         result.remainder = left;
-        return result;
     }
     else {
         int index = left.degree - right.degree;
@@ -485,15 +570,19 @@ EuclidPair Polynomial::EuclideanDivision(const Polynomial &left,
         while ( dividend.degree >= divisor.degree ) {
             result.quotient[index] = 
                 dividend[dividend.degree]/divisor[divisor.degree];
-            divisor = result.quotient.subterm(index) * divisor;
-            dividend = dividend - divisor;
+            divisor = result.quotient.subterm(index);
+            divisor *= right;
+            dividend -= divisor;
             divisor = right;
             // if ( dividend.degree - divisor.degree == index ) error;
             index = dividend.degree - divisor.degree;
         }
         result.remainder = dividend;
-        return result;
     }
+    if ( cache ) {
+        cache->storeDivision(left, right, result);
+    }
+    return result;
 }
 
 // creates a polynomial identical to a single term of the caller,
@@ -512,3 +601,92 @@ void Polynomial::simplify() {
     }
     this->setDegree(index);
 }
+
+// hash of the term of degree index with coefficient value. -0.0 is hashed as
+// 0.0 since the two compare equal
+unsigned long long Polynomial::hashTerm(int index, double value) {
+    unsigned long long bits = 0;
+    if ( value != 0 ) {
+        std::memcpy(&bits, &value, sizeof(bits));
+    }
+    return mix(bits ^ (static_cast<unsigned long long>(index) + 1) *
+                      0x9E3779B97F4A7C15ULL);
+}
+
+// 64-bit finalizer from splitmix64
+unsigned long long Polynomial::mix(unsigned long long x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+
+/**************
+ * memoization
+ **************/
+
+// starts caching the last capacity products and divisions, discarding any
+// previous cache
+void Polynomial::enableCache(int capacity) {
+    delete cache;
+    cache = new PolynomialCache(capacity);
+}
+
+// stops caching and releases every cached polynomial
+void Polynomial::disableCache() {
+    delete cache;
+    cache = NULL;
+}
+
+// counters of the current cache, all zero when caching is disabled
+CacheStatistics Polynomial::cacheStatistics() {
+    if ( cache ) {
+        return cache->statistics();
+    }
+    CacheStatistics none = { 0, 0, 0, 0, 0 };
+    return none;
+}
+
+// raises a polynomial to a nonnegative integer power by repeated squaring.
+// every multiplication goes through operator* and therefore the cache
+Polynomial pow(const Polynomial &base, unsigned int exponent) {
+    Polynomial result(0), square(base);
+    while ( exponent > 0 ) {
+        if ( exponent & 1 ) {
+            result = result * square;
+        }
+        exponent >>= 1;
+        if ( exponent > 0 ) {
+            square = square * square;
+        }
+    }
+    return result;
+}
+
+// Horner's method over many points. the points are taken in chunks small
+// enough that the partial results stay in L1 cache, and for each coefficient
+// the loop runs across the whole chunk so that it vectorizes. every point sees
+// the same sequence of operations as evaluate(double). the zero polynomial
+// (degree -1) evaluates to 0 everywhere
+void evaluateMany(const double* coefficients, int degree,
+                  const double* points, double* results, int count) {
+    const int CHUNK = 512;
+    for ( int start = 0; start < count; start += CHUNK ) {
+        int n = std::min(CHUNK, count - start);
+        const double* x = points + start;
+        double* r = results + start;
+        double lead = degree >= 0 ? coefficients[degree] : 0;
+        for ( int j = 0; j < n; j++ ) {
+            r[j] = lead;
+        }
+        for ( int i = degree - 1; i >= 0; i-- ) {
+            double c = coefficients[i];
+            for ( int j = 0; j < n; j++ ) {
+                r[j] = r[j] * x[j] + c;
+            }
+        }
+    }
+}
@@ -95,27 +95,81 @@
  *          match on each valid coefficient. the <=, >=, <, > operators only
  *          test the degree of the polynomials
  *
+ * -    evaluation:
+ *          poly.evaluate(x); poly.evaluate(points, results, n);
+ *
+ *          evaluates the polynomial at one point, or at n points at once. the
+ *          second form runs Horner's method across a block of points so that
+ *          the inner loop vectorizes; evaluateMany() is the same kernel over
+ *          a bare coefficient array
+ *
+ * -    text input/output:
+ *          out << poly; in >> poly;
+ *
+ *          a polynomial is written as one line, its degree, a tab, then each
+ *          coefficient from degree 0 up preceded by a space. operator>> reads
+ *          that line back. binary collections are handled in polyio.h
+ *
+ * -    hashing:
+ *          polynomial.hash();
+ *
+ *          a 64-bit hash of the degree and valid coefficients. the value is
+ *          cached on the object and discarded by any mutation, except
+ *          setCoefficient() which updates it in place
+ *
+ * -    memoization:
+ *          Polynomial::enableCache(n); Polynomial::cacheStatistics();
+ *          Polynomial::disableCache();
+ *
+ *          keeps the last n products (operator*) and Euclidean divisions
+ *          (operator/, operator%) in a least-recently-used cache keyed by the
+ *          operands' hashes. the compound operators *=, /=, %= see the cache
+ *          only through division. hit, miss and eviction counts are reported
+ *          by cacheStatistics()
+ *
+ * -    exponentiation:
+ *          pow(poly, k);
+ *
+ *          binary exponentiation built on operator*, so repeated powers of the
+ *          same polynomial are served from the cache when it is enabled.
+ *          pow(poly, 0) is the constant polynomial 1
+ *
  */
 
 
 const int BASE = 25;
 
 struct EuclidPair;
+class PolynomialCache;
+
+// counters reported by Polynomial::cacheStatistics()
+struct CacheStatistics {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    int size;
+    int capacity;
+};
 
 class Polynomial {
 private:
     int degree;
     int memory_scale;
     double* coefficients;
+    mutable bool hashed;
+    mutable unsigned long long content_hash;
+    static PolynomialCache* cache;
 protected:
     EuclidPair EuclideanDivision(const Polynomial &, const Polynomial &);
     Polynomial subterm(int);
     void simplify();
+    static unsigned long long hashTerm(int, double);
+    static unsigned long long mix(unsigned long long);
 public:
     // {con,de}structor(s)
     Polynomial();
     Polynomial(const int);
-    Polynomial(const int, double*, const int);
+    Polynomial(const int, const double*, const int);
     Polynomial(const Polynomial &);
     ~Polynomial();
     // exception classes
@@ -138,6 +192,10 @@ public:
     Polynomial operator/(const Polynomial &);
     Polynomial operator%(const Polynomial &);
     friend std::ostream& operator<<(std::ostream &, Polynomial &);
+    friend std::istream& operator>>(std::istream &, Polynomial &);
+    friend const char* parsePolynomial(const char*, const char*,
+                                       Polynomial &);
+    friend class PolynomialWriter;
     double& operator[](int);
     bool operator==(const Polynomial &);
     bool operator!=(const Polynomial &);
@@ -156,8 +214,17 @@ public:
     double getCoefficient(int);
     // miscellaneous functions
     double evaluate(const double);
+    void evaluate(const double*, double*, int);
+    unsigned long long hash() const;
+    // memoization of products and divisions
+    static void enableCache(int);
+    static void disableCache();
+    static CacheStatistics cacheStatistics();
 };
 
+Polynomial pow(const Polynomial &, unsigned int);
+void evaluateMany(const double*, int, const double*, double*, int);
+
 struct EuclidPair {
     Polynomial quotient;
     Polynomial remainder;
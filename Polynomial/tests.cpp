@@ -0,0 +1,410 @@
+//#define NDEBUG
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "FibHeap.h"
+#include "Instrumentation.h"
+#include "polyio.h"
+#include "polynomial.h"
+
+/* build:
+ *      g++ -std=c++11 -I../FibonacciHeap tests.cpp polynomial.cpp \
+ *          polycache.cpp polyio.cpp -o tests
+ *
+ * built with -DINSTRUMENTATION as well, the counters are checked too
+ */
+
+using namespace std;
+
+// a polynomial of degree deg whose coefficients are small multiples of 1/4,
+// which operator<< prints exactly
+Polynomial samplePolynomial(int deg, int seed) {
+    vector<double> coefficients(deg + 1);
+    for ( int i = 0; i <= deg; i++ ) {
+        coefficients[i] = ((seed * 31 + i * 17) % 41 - 20) / 4.0;
+    }
+    if ( deg >= 0 && coefficients[deg] == 0 ) {
+        coefficients[deg] = 1;
+    }
+    return Polynomial(deg, coefficients.data(), deg + 1);
+}
+
+bool equal(Polynomial &a, Polynomial b) {
+    return a.getDegree() == b.getDegree() && a == b;
+}
+
+// a polynomial with the coefficients of p that has never been hashed, since a
+// copy would carry over the cached hash of p
+Polynomial rebuilt(Polynomial &p) {
+    vector<double> coefficients(p.getDegree() + 1);
+    for ( int i = 0; i <= p.getDegree(); i++ ) {
+        coefficients[i] = p.getCoefficient(i);
+    }
+    return Polynomial(p.getDegree(), coefficients.data(), p.getDegree() + 1);
+}
+
+// the content hash of Polynomial, restated so that a collision can be built:
+// mix(degree) plus mix(bits of c_i ^ (i+1)*golden) over the coefficients
+const unsigned long long GOLDEN = 0x9E3779B97F4A7C15ULL;
+
+unsigned long long mix(unsigned long long x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+unsigned long long unshift(unsigned long long x, int shift) {
+    unsigned long long y = x;
+    for ( int i = 0; i < 64 / shift + 1; i++ ) {
+        y = x ^ (y >> shift);
+    }
+    return y;
+}
+
+// inverse of an odd number modulo 2^64 by Newton's iteration
+unsigned long long inverse(unsigned long long m) {
+    unsigned long long x = m;
+    for ( int i = 0; i < 5; i++ ) {
+        x *= 2 - m * x;
+    }
+    return x;
+}
+
+unsigned long long unmix(unsigned long long x) {
+    x = unshift(x, 31);
+    x *= inverse(0x94D049BB133111EBULL);
+    x = unshift(x, 27);
+    x *= inverse(0xBF58476D1CE4E5B9ULL);
+    return unshift(x, 30);
+}
+
+unsigned long long termHash(int index, double value) {
+    unsigned long long bits = 0;
+    if ( value != 0 ) {
+        memcpy(&bits, &value, sizeof(bits));
+    }
+    return mix(bits ^ (index + 1) * GOLDEN);
+}
+
+// a linear polynomial other than b with the same hash as b
+Polynomial collision(Polynomial &b) {
+    unsigned long long sum = termHash(0, b.getCoefficient(0)) +
+                             termHash(1, b.getCoefficient(1));
+    for ( double c0 = b.getCoefficient(0) + 1; ; c0++ ) {
+        unsigned long long bits = unmix(sum - termHash(0, c0)) ^ 2 * GOLDEN;
+        double c1;
+        memcpy(&c1, &bits, sizeof(c1));
+        // keeps the products with it far from overflow and underflow
+        if ( fabs(c1) > 1e-100 && fabs(c1) < 1e100 ) {
+            double coefficients[] = { c0, c1 };
+            return Polynomial(1, coefficients, 2);
+        }
+    }
+}
+
+int main() {
+    int count = 0;
+    const char* path = "tests_polyio.bin";
+    vector<Polynomial> written;
+    int degrees[] = { 0, 3, 12, 100, -1, 7 };
+    for ( int i = 0; i < 6; i++ ) {
+        written.push_back(samplePolynomial(degrees[i], i));
+    }
+
+    // WRITE TESTS
+    /*
+     * a new collection read back through the mapping
+     */
+    {
+        PolynomialWriter writer(path);
+        for ( int i = 0; i < 3; i++ ) {
+            writer.write(written[i]);
+        }
+        assert(writer.count() == 3);
+        writer.close();
+        PolynomialFile file(path);
+        assert(file.size() == 3);
+        for ( int i = 0; i < 3; i++ ) {
+            assert(equal(written[i], file.load(i)));
+            assert(file[i].getDegree() == written[i].getDegree());
+        }
+        count++;
+    }
+
+    // APPEND TESTS
+    /*
+     * an append cut short before close() leaves the old collection, and a
+     * completed one extends it
+     */
+    {
+        pid_t child = fork();
+        if ( child == 0 ) {
+            // writes more than the writer buffers, so that coefficients
+            // reach the file, then exits without closing the writer
+            PolynomialWriter writer(path, true);
+            Polynomial large = samplePolynomial(1 << 18, 9);
+            writer.write(large);
+            _exit(0);
+        }
+        int status;
+        assert(child > 0 && waitpid(child, &status, 0) == child);
+        {
+            PolynomialFile file(path);
+            assert(file.size() == 3);
+            for ( int i = 0; i < 3; i++ ) {
+                assert(equal(written[i], file.load(i)));
+            }
+        }
+        {
+            PolynomialWriter writer(path, true);
+            assert(writer.count() == 3);
+            for ( int i = 3; i < 6; i++ ) {
+                writer.write(written[i]);
+            }
+            writer.close();
+        }
+        PolynomialFile file(path);
+        assert(file.size() == 6);
+        for ( int i = 0; i < 6; i++ ) {
+            assert(equal(written[i], file.load(i)));
+        }
+        count++;
+    }
+
+    // TEXT TESTS
+    /*
+     * the output of operator<< parsed back, by readPolynomials and line by
+     * line by parsePolynomial
+     */
+    {
+        PolynomialFile file(path);
+        stringstream text;
+        for ( int i = 0; i < file.size(); i++ ) {
+            Polynomial poly = file.load(i);
+            text << poly;
+        }
+        string lines = text.str();
+        vector<Polynomial> parsed;
+        readPolynomials(text, parsed);
+        assert(parsed.size() == written.size());
+        for ( size_t i = 0; i < parsed.size(); i++ ) {
+            assert(equal(written[i], parsed[i]));
+        }
+        const char* begin = lines.c_str();
+        const char* end = begin + lines.size();
+        for ( size_t i = 0; i < written.size(); i++ ) {
+            Polynomial poly;
+            begin = parsePolynomial(begin, end, poly);
+            assert(begin != NULL && equal(written[i], poly));
+        }
+        assert(begin == end);
+        count++;
+    }
+    remove(path);
+
+    // POWER TESTS
+    /*
+     * pow against repeated multiplication, with the cache disabled
+     */
+    {
+        Polynomial p = samplePolynomial(3, 1);
+        Polynomial product(0);
+        for ( unsigned int k = 0; k <= 6; k++ ) {
+            assert(equal(product, pow(p, k)));
+            product *= p;
+        }
+        Polynomial one = pow(p, 0);
+        assert(one.getDegree() == 0 && one.getCoefficient(0) == 1);
+        count++;
+    }
+
+    // HASH TESTS
+    /*
+     * every mutator leaves the hash equal to that of a polynomial built from
+     * the same coefficients, whether it discards the cached hash or updates
+     * it in place
+     */
+    {
+        Polynomial p = samplePolynomial(5, 2);
+        unsigned long long before = p.hash();
+        assert(before == rebuilt(p).hash());
+        p[2] += 1;
+        assert(p.hash() != before && p.hash() == rebuilt(p).hash());
+        before = p.hash();
+        p += samplePolynomial(7, 3);
+        assert(p.hash() != before && p.hash() == rebuilt(p).hash());
+        before = p.hash();
+        p *= samplePolynomial(2, 4);
+        assert(p.hash() != before && p.hash() == rebuilt(p).hash());
+        before = p.hash();
+        p.setDegree(12);
+        assert(p.hash() != before && p.hash() == rebuilt(p).hash());
+        // in place, then with the leading coefficient and the two zeros
+        // below it removed
+        double coefficients[] = { 1, 2, 3, 0, 0, 4 };
+        Polynomial q(5, coefficients, 6);
+        before = q.hash();
+        q.setCoefficient(1, 7.5);
+        assert(q.hash() != before && q.hash() == rebuilt(q).hash());
+        before = q.hash();
+        q.setCoefficient(5, 0);
+        assert(q.getDegree() == 2);
+        assert(q.hash() != before && q.hash() == rebuilt(q).hash());
+        count++;
+    }
+
+    // CACHE TESTS
+    /*
+     * hits, misses and evictions of repeated powers, and a product whose key
+     * collides with a cached one
+     */
+    {
+        Polynomial p = samplePolynomial(4, 5);
+        Polynomial expected = pow(p, 8);
+        // pow(p, 8) takes three squarings and one product with 1
+        Polynomial::enableCache(8);
+        assert(equal(expected, pow(p, 8)));
+        CacheStatistics statistics = Polynomial::cacheStatistics();
+        assert(statistics.hits == 0 && statistics.misses == 4);
+        assert(statistics.evictions == 0 && statistics.size == 4);
+        assert(equal(expected, pow(p, 8)));
+        statistics = Polynomial::cacheStatistics();
+        assert(statistics.hits == 4 && statistics.misses == 4);
+        assert(statistics.evictions == 0 && statistics.size == 4);
+        // with room for two products each one is evicted before it is
+        // needed again
+        Polynomial::enableCache(2);
+        assert(equal(expected, pow(p, 8)));
+        assert(equal(expected, pow(p, 8)));
+        statistics = Polynomial::cacheStatistics();
+        assert(statistics.hits == 0 && statistics.misses == 8);
+        assert(statistics.evictions == 6 && statistics.size == 2);
+        assert(statistics.capacity == 2);
+
+        Polynomial a = samplePolynomial(2, 6);
+        Polynomial b = samplePolynomial(1, 7);
+        Polynomial c = collision(b);
+        assert(c != b && c.hash() == b.hash());
+        Polynomial::enableCache(8);
+        Polynomial ab = a * b;
+        Polynomial ac = a * c;
+        statistics = Polynomial::cacheStatistics();
+        assert(statistics.hits == 0 && statistics.misses == 2);
+        expected = a;
+        expected *= c;
+        assert(equal(expected, ac));
+        Polynomial::disableCache();
+        statistics = Polynomial::cacheStatistics();
+        assert(statistics.capacity == 0);
+        count++;
+    }
+
+    // EVALUATION TESTS
+    /*
+     * evaluateMany and the block form of evaluate give the same bits as
+     * evaluate(double), across chunks of 512 points and for the zero
+     * polynomial
+     */
+    {
+        vector<double> points(1300), results(1300), many(1300);
+        for ( size_t j = 0; j < points.size(); j++ ) {
+            points[j] = -2.0 + j * 0.0031;
+        }
+        Polynomial polys[] = { samplePolynomial(20, 8), Polynomial() };
+        for ( int k = 0; k < 2; k++ ) {
+            Polynomial &p = polys[k];
+            vector<double> coefficients(p.getDegree() + 1);
+            for ( int i = 0; i <= p.getDegree(); i++ ) {
+                coefficients[i] = p.getCoefficient(i);
+            }
+            evaluateMany(coefficients.data(), p.getDegree(), points.data(),
+                         many.data(), static_cast<int>(points.size()));
+            p.evaluate(points.data(), results.data(),
+                       static_cast<int>(points.size()));
+            for ( size_t j = 0; j < points.size(); j++ ) {
+                double single = p.evaluate(points[j]);
+                assert(memcmp(&single, &many[j], sizeof(double)) == 0);
+                assert(memcmp(&single, &results[j], sizeof(double)) == 0);
+            }
+        }
+        assert(many[0] == 0 && many[1299] == 0);
+        count++;
+    }
+
+#ifdef INSTRUMENTATION
+    // INSTRUMENTATION TESTS
+    /*
+     * the counters after a known sequence of heap operations and of degree
+     * changes, and the same counters read back from dump()
+     */
+    {
+        typedef Instrumentation I;
+        I::reset();
+        FibHeap<int> heap;
+        vector<FibHeap<int>::handle> handles;
+        for ( int i = 1; i <= 9; i++ ) {
+            handles.push_back(heap.insert(i));
+        }
+        // leaves 2..9 as a single tree, in which 9 is not a root
+        assert(heap.extractMin() == 1);
+        heap.decrease_key(handles[8], 0);
+        assert(heap.extractMin() == 0);
+        assert(heap.extractMin() == 2);
+        assert(I::count(I::HEAP_INSERTS) == 9);
+        assert(I::count(I::HEAP_EXTRACTS) == 3);
+        assert(I::count(I::LINKS) > 0);
+        assert(I::count(I::CUTS) > 0);
+        assert(I::count(I::CONSOLIDATE_PASSES) > 0);
+
+        // BASE coefficients fit the first block, then it doubles twice and
+        // halves twice
+        Polynomial p(0);
+        I::reset();
+        p.setDegree(BASE + 5);
+        p.setDegree(2 * BASE + 10);
+        p.setDegree(2 * BASE + 20);
+        p.setDegree(10);
+        assert(I::count(I::SET_DEGREE_CALLS) == 4);
+        assert(I::count(I::SET_DEGREE_REALLOCATIONS) == 3);
+        assert(I::count(I::ALLOCATIONS) == 3);
+        assert(I::count(I::DEALLOCATIONS) == 3);
+        assert(I::calls(I::SET_DEGREE) == 4);
+
+        stringstream out;
+        I::dump(out);
+        string json = out.str();
+        assert(json.compare(0, 15, "{\"enabled\":true") == 0);
+        assert(json.compare(json.size() - 2, 2, "}}") == 0);
+        const char* names[] = {
+            "allocations", "bytes_allocated", "deallocations",
+            "set_degree_calls", "set_degree_reallocations", "heap_inserts",
+            "heap_extracts", "consolidate_passes", "links", "cuts"
+        };
+        for ( int i = 0; i < I::COUNTERS; i++ ) {
+            string key = string("\"") + names[i] + "\":";
+            size_t at = json.find(key);
+            assert(at != string::npos);
+            unsigned long long value =
+                strtoull(json.c_str() + at + key.size(), NULL, 10);
+            assert(value == I::count(static_cast<I::Counter>(i)));
+        }
+        assert(json.find("\"set_degree\":{\"calls\":4,") != string::npos);
+        count++;
+    }
+#endif
+
+    cout << count << " tests passed!" << endl;
+    return 0;
+}